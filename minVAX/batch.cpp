@@ -0,0 +1,312 @@
+// batch.C
+//
+// Batch mode (--batch list-file): run every object file named in the
+// list on the fast engine, spread over a pool of worker threads.
+//
+// Each program gets its own FastCpu and its own output buffer, so the
+// workers share nothing but the job table.  The jobs start out split
+// into one contiguous range per worker; a worker that runs out steals
+// the back half of another worker's range.  The main thread writes the
+// buffers to stdout in list order as they complete.
+//
+// The arch Clock is process-wide, so the RTL model cannot run more than
+// one machine at a time; batch jobs always use the fast engine.
+//
+// The output goes out in list order, so a program that never halts
+// would hold up every later one while its trace filled memory; each job
+// stops after --limit instructions (default 1000000), halting with
+// "instruction limit" as --lanes does.
+
+#include "includes.h"
+
+#include <pthread.h>
+#include <unistd.h>
+
+struct BatchJob {
+	char *objfile;			// object file to run
+	char *text;				// everything the run printed
+	size_t length;			// ... and its length
+	bool ok;				// did the object file load?
+	bool finished;			// has a worker completed it?
+};
+
+struct WorkQueue {
+	pthread_mutex_t lock;	// guards head and tail
+	long head;				// next job the owner runs
+	long tail;				// one past the last job; thieves take from here
+};
+
+struct Batch {
+	BatchJob *job;			// the jobs, in list order
+	long jobs;
+	WorkQueue *queue;		// one range of jobs per worker
+	int workers;
+	long steals;			// successful steals, for --stats
+
+	pthread_mutex_t lock;	// guards job[].finished and steals
+	pthread_cond_t finished;	// signalled as each job completes
+};
+
+struct Worker {
+	Batch *batch;
+	int self;				// index of this worker's queue
+};
+
+//
+// take_job() - pop the next job off the front of the worker's own range.
+//
+
+static bool take_job( WorkQueue &q, long &j ) {
+	bool found = false;
+
+	pthread_mutex_lock( &q.lock );
+	if( q.head < q.tail ) {
+		j = q.head++;
+		found = true;
+	}
+	pthread_mutex_unlock( &q.lock );
+
+	return found;
+}
+
+//
+// steal_jobs() - take the back half of the first non-empty range after
+// our own.  The first stolen job is returned in j and the rest become
+// our range.  Only one queue lock is held at a time.
+//
+
+static bool steal_jobs( Batch &b, int self, long &j ) {
+	for( int k = 1; k < b.workers; k++ ) {
+		WorkQueue &victim = b.queue[( self + k ) % b.workers];
+		long first = 0, last = 0;
+
+		pthread_mutex_lock( &victim.lock );
+		if( victim.head < victim.tail ) {
+			last = victim.tail;
+			first = last - ( last - victim.head + 1 ) / 2;
+			victim.tail = first;
+		}
+		pthread_mutex_unlock( &victim.lock );
+
+		if( first == last )
+			continue;
+
+		WorkQueue &own = b.queue[self];
+
+		pthread_mutex_lock( &own.lock );
+		own.head = first + 1;
+		own.tail = last;
+		pthread_mutex_unlock( &own.lock );
+
+		pthread_mutex_lock( &b.lock );
+		b.steals++;
+		pthread_mutex_unlock( &b.lock );
+
+		j = first;
+		return true;
+	}
+
+	return false;
+}
+
+//
+// run_job() - run one program on a fresh machine, capturing its output.
+//
+
+static void run_job( Batch &b, BatchJob &job ) {
+	FastCpu *cpu = new FastCpu;
+
+	job.text = NULL;
+	job.length = 0;
+	cpu->trace.out = open_memstream( &job.text, &job.length );
+	if( cpu->trace.out == NULL ) {
+		perror( "open_memstream" );
+		job.ok = false;
+	}
+	else {
+		if( flight_size > 0 )
+			trace_open_ring( cpu->trace, flight_size );
+		if( fold_trace )
+			trace_open_fold( cpu->trace );
+		job.ok = fast_run( *cpu, job.objfile, lane_limit );
+		fclose( cpu->trace.out );
+	}
+	delete cpu;
+
+	pthread_mutex_lock( &b.lock );
+	job.finished = true;
+	pthread_cond_broadcast( &b.finished );
+	pthread_mutex_unlock( &b.lock );
+}
+
+//
+// batch_worker() - thread body: run our own jobs, then steal until
+// every range is empty.
+//
+
+static void *batch_worker( void *arg ) {
+	Worker *w = (Worker *)arg;
+	Batch &b = *w->batch;
+	long j;
+
+	for( ;; ) {
+		if( !take_job( b.queue[w->self], j ) && !steal_jobs( b, w->self, j ) )
+			break;
+		run_job( b, b.job[j] );
+	}
+
+	return NULL;
+}
+
+//
+// read_list() - collect the object file names from the list file, one
+// per line, into a new[]'d array of strdup()'d names.  Blank lines and
+// lines starting with '#' are skipped.  Returns the number of names.
+//
+
+long read_list( char *listfile, char **&objfile ) {
+	FILE *fp;
+	char line[1024];
+	long count = 0, size = 16;
+
+	fp = fopen( listfile, "r" );
+	if( fp == NULL ) {
+		fprintf( stderr, "Cannot open list file %s\n", listfile );
+		exit( 1 );
+	}
+
+	objfile = new char *[size];
+
+	while( fgets( line, sizeof( line ), fp ) != NULL ) {
+		char *p = line;
+		char *end;
+
+		while( *p == ' ' || *p == '\t' )
+			p++;
+		end = p + strlen( p );
+		while( end > p && ( end[-1] == '\n' || end[-1] == '\r' ||
+		       end[-1] == ' ' || end[-1] == '\t' ) )
+			*--end = '\0';
+
+		if( *p == '\0' || *p == '#' )
+			continue;
+
+		if( count == size ) {
+			char **bigger = new char *[size * 2];
+
+			for( long i = 0; i < count; i++ )
+				bigger[i] = objfile[i];
+			delete [] objfile;
+			objfile = bigger;
+			size *= 2;
+		}
+
+		objfile[count++] = strdup( p );
+	}
+
+	fclose( fp );
+
+	return count;
+}
+
+//
+// run_batch() - run every program in the list file and print their
+// output in list order.  Returns the number of programs that could not
+// be loaded.
+//
+
+int run_batch( char *listfile ) {
+	Batch b;
+	char **objfile;
+	pthread_t *thread;
+	Worker *worker;
+	int failed = 0;
+	double start;
+
+	b.jobs = read_list( listfile, objfile );
+	b.job = new BatchJob[b.jobs];
+	for( long i = 0; i < b.jobs; i++ ) {
+		b.job[i].objfile = objfile[i];
+		b.job[i].text = NULL;
+		b.job[i].length = 0;
+		b.job[i].ok = false;
+		b.job[i].finished = false;
+	}
+	delete [] objfile;
+
+	b.workers = batch_threads;
+	if( b.workers <= 0 )
+		b.workers = (int)sysconf( _SC_NPROCESSORS_ONLN );
+	if( b.workers > b.jobs )
+		b.workers = (int)b.jobs;
+	if( b.workers < 1 )
+		b.workers = 1;
+	b.steals = 0;
+
+	pthread_mutex_init( &b.lock, NULL );
+	pthread_cond_init( &b.finished, NULL );
+
+	b.queue = new WorkQueue[b.workers];
+	for( int i = 0; i < b.workers; i++ ) {
+		pthread_mutex_init( &b.queue[i].lock, NULL );
+		b.queue[i].head = b.jobs * i / b.workers;
+		b.queue[i].tail = b.jobs * ( i + 1 ) / b.workers;
+	}
+
+	start = host_seconds();
+
+	thread = new pthread_t[b.workers];
+	worker = new Worker[b.workers];
+	for( int i = 0; i < b.workers; i++ ) {
+		worker[i].batch = &b;
+		worker[i].self = i;
+		if( pthread_create( &thread[i], NULL, batch_worker, &worker[i] ) != 0 ) {
+			perror( "pthread_create" );
+			exit( 1 );
+		}
+	}
+
+	// Write each program's output as soon as it and everything before
+	// it in the list has finished.
+
+	for( long i = 0; i < b.jobs; i++ ) {
+		BatchJob &job = b.job[i];
+
+		pthread_mutex_lock( &b.lock );
+		while( !job.finished )
+			pthread_cond_wait( &b.finished, &b.lock );
+		pthread_mutex_unlock( &b.lock );
+
+		printf( "==> %s <==\n", job.objfile );
+		if( job.text != NULL )
+			fwrite( job.text, 1, job.length, stdout );
+		printf( "\n" );
+
+		if( !job.ok )
+			failed++;
+		free( job.text );
+		free( job.objfile );
+	}
+
+	for( int i = 0; i < b.workers; i++ )
+		pthread_join( thread[i], NULL );
+
+	if( show_stats ) {
+		fflush( stdout );
+		fprintf( stderr, "Batch: %ld programs, %d failed, %d threads, "
+			"%ld steals, %.3f s host time\n", b.jobs, failed, b.workers,
+			b.steals, host_seconds() - start );
+	}
+
+	for( int i = 0; i < b.workers; i++ )
+		pthread_mutex_destroy( &b.queue[i].lock );
+	pthread_cond_destroy( &b.finished );
+	pthread_mutex_destroy( &b.lock );
+
+	delete [] worker;
+	delete [] thread;
+	delete [] b.queue;
+	delete [] b.job;
+
+	return failed;
+}
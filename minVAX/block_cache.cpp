@@ -0,0 +1,106 @@
+// block_cache.C
+//
+// Basic-block translation cache for the minVAX fast engine.  See
+// block_cache.h.
+
+#include "includes.h"
+
+//
+// block_cache_reset() - empty the cache and clear its statistics.
+//
+
+void block_cache_reset( BlockCache &bc ) {
+	for( unsigned int i = 0; i < BLOCK_CACHE_SIZE; i++ ) {
+		bc.block[i].valid = false;
+		bc.covered[i] = 0;
+	}
+
+	bc.translations = 0;
+	bc.runs = 0;
+	bc.chained = 0;
+	bc.invalidations = 0;
+}
+
+//
+// ends_block() - does op code opc end a basic block?  JMP, BEZ and BLT
+// may change PC; HLT stops the machine.
+//
+
+static bool ends_block( long opc ) {
+	return ( opc >= 7 && opc <= 9 ) || opc == 15;
+}
+
+//
+// block_cache_lookup() - return the block starting at pc, translating it
+// from mem on a miss.
+//
+
+Block *block_cache_lookup( BlockCache &bc, long pc, const unsigned char *mem ) {
+	Block *b = &bc.block[pc % BLOCK_CACHE_SIZE];
+	long addr = pc;
+
+	if( b->valid )
+		return b;
+
+	bc.translations++;
+
+	b->valid = true;
+	b->entry = pc;
+	b->count = 0;
+	b->next[0] = b->next[1] = NULL;
+	b->jit = NULL;
+	b->jitTried = false;
+
+	// Stop at the top of memory; PC wraps (and the machine halts) there.
+	do {
+		DecodedInstr *di = &b->op[b->count++];
+
+		decode_instr( di, addr, mem[addr], mem );
+		addr += di->length;
+	} while( !ends_block( b->op[b->count - 1].opc ) &&
+		b->count < (int)BLOCK_MAX_INSTRS && addr < (long)BLOCK_CACHE_SIZE );
+
+	b->bytes = addr - pc;
+
+	for( int i = 0; i < b->bytes; i++ )
+		bc.covered[( pc + i ) % BLOCK_CACHE_SIZE]++;
+
+	return b;
+}
+
+//
+// block_cache_invalidate() - a store to addr changes a byte that every
+// block translated from it depends on.
+//
+// Only blocks starting up to 2 * BLOCK_MAX_INSTRS bytes before addr can
+// cover it, so only those entries are checked.
+//
+
+void block_cache_invalidate( BlockCache &bc, long addr ) {
+	if( bc.covered[addr % BLOCK_CACHE_SIZE] == 0 )
+		return;
+
+	for( unsigned int back = 0; back < 2 * BLOCK_MAX_INSTRS; back++ ) {
+		Block &b = bc.block[( addr - back ) & ( BLOCK_CACHE_SIZE - 1 )];
+
+		if( !b.valid || (long)back >= b.bytes )
+			continue;
+
+		b.valid = false;
+		bc.invalidations++;
+
+		for( int i = 0; i < b.bytes; i++ )
+			bc.covered[( b.entry + i ) % BLOCK_CACHE_SIZE]--;
+	}
+}
+
+//
+// block_cache_report() - print the translation statistics on out.
+//
+
+void block_cache_report( FILE *out, BlockCache &bc, long instructions ) {
+	fprintf( out, "Block cache: %ld translations, %ld block runs, %ld chained, "
+		"%ld invalidations (%.1f instructions/block)\n",
+		bc.translations, bc.runs, bc.chained, bc.invalidations,
+		bc.runs ? (double)instructions / bc.runs : 0.0 );
+}
@@ -0,0 +1,46 @@
+// block_cache.h
+//
+// Basic-block translation cache for the minVAX fast engine.
+//
+// A block is the run of instructions starting at an entry address and
+// ending at the first JMP, BEZ, BLT or HLT (or after BLOCK_MAX_INSTRS
+// instructions, or at the top of memory).  It is translated once into
+// a sequence of micro-ops -- the predecoded instruction with its
+// immediate byte and the fast_instr<IR>() handler specialized for it --
+// and cached by entry address.  Each block remembers the block it went
+// to on each way out, so a loop runs from block to block without going
+// back to the cache.
+//
+// A store into any byte a block was translated from invalidates it.
+
+#ifndef _BLOCK_CACHE_H
+#define _BLOCK_CACHE_H
+
+const unsigned int BLOCK_CACHE_SIZE( 256 );	// one block per entry address
+const unsigned int BLOCK_MAX_INSTRS( 16 );	// longest block translated
+
+// Host code for a block, from jit_compile(); returns true if the last
+// instruction took a branch.
+typedef bool (*JitCode)( FastCpu *cpu );
+
+struct Block {
+	bool valid;					// does this entry hold a translation?
+	long entry;					// address of the first instruction
+	int bytes;					// bytes translated, immediates included
+	int count;					// instructions in the block
+	DecodedInstr op[BLOCK_MAX_INSTRS];	// the micro-ops, in order
+	Block *next[2];				// chained successor: fall through, taken
+	JitCode jit;				// host code, NULL to interpret
+	bool jitTried;				// has jit_compile() seen this block?
+};
+
+struct BlockCache {
+	Block block[BLOCK_CACHE_SIZE];
+	unsigned char covered[BLOCK_CACHE_SIZE];	// blocks translated from each byte
+	long translations;
+	long runs;					// blocks executed
+	long chained;				// ... entered through a chain
+	long invalidations;
+};
+
+#endif
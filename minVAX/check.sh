@@ -0,0 +1,101 @@
+#!/bin/sh
+#
+# check.sh - run the test programs on every engine and compare them
+#
+# Each program (Accept.obj and tests/*.obj by default) runs on the RTL
+# model with --cosim, and its trace must match the .out captured next to
+# it.  The fast engine must print the same trace with translated blocks
+# and the JIT, with --no-jit and with --no-blocks.  Without a trace,
+# --lanes and --variants (on the program saved before its first
+# instruction) must stop it in the same state, after the instructions
+# and cycles the fast engine reported.
+#
+# The arch library's own lines (its banner and simulated time) are left
+# out of the comparison; its cycle count is not the model's.  A trace is
+# cut off at MAXLINES lines, so a program that no longer halts fails
+# instead of filling the disk.
+#
+# usage: check.sh [object-file...]
+#
+
+MINVAX=./minVAX
+MAXLINES=10000
+TMP=${TMPDIR:-/tmp}/minvax-check.$$
+mkdir $TMP || exit 1
+trap 'rm -rf $TMP' 0
+
+if [ $# -eq 0 ]; then
+	set -- Accept.obj tests/*.obj
+fi
+
+checked=0
+failed=0
+
+#
+# fail() - report a difference for the current program.
+#
+
+fail() {
+	echo "$obj: $1"
+	failed=`expr $failed + 1`
+}
+
+for obj in "$@"; do
+	echo $obj
+done > $TMP/list
+$MINVAX --lanes $TMP/list > $TMP/lanes
+echo R0=00 > $TMP/variants
+
+for obj in "$@"; do
+	checked=`expr $checked + 1`
+	sed -e 1,3d -e '/^Simulated time /,$d' ${obj%.obj}.out > $TMP/expect
+
+	# the RTL model, checked instruction by instruction
+
+	$MINVAX --mode=rtl --cosim $obj | head -$MAXLINES > $TMP/rtl
+	if ! grep '^Co-simulation: .*, no differences$' $TMP/rtl > /dev/null; then
+		fail "--mode=rtl --cosim did not finish clean"
+		sed -n '/^Co-simulation: /,/^$/p' $TMP/rtl
+		continue
+	fi
+	sed -e 1,3d -e '/^Co-simulation: /,$d' $TMP/rtl > $TMP/got
+	if ! cmp -s $TMP/expect $TMP/got; then
+		fail "--mode=rtl trace differs from ${obj%.obj}.out"
+		diff $TMP/expect $TMP/got | head -10
+	fi
+
+	# the fast engine, traced
+
+	summary=
+	for flags in "" --no-jit --no-blocks; do
+		$MINVAX --mode=fast $flags $obj | head -$MAXLINES > $TMP/fast
+		sed '/^Fast engine: /,$d' $TMP/fast > $TMP/got
+		if ! cmp -s $TMP/expect $TMP/got; then
+			fail "--mode=fast $flags trace differs from ${obj%.obj}.out"
+			diff $TMP/expect $TMP/got | head -10
+		fi
+		got=`sed -n 's/^Fast engine: //p' $TMP/fast`
+		if [ -z "$summary" ]; then
+			summary=$got
+		elif [ "$got" != "$summary" ]; then
+			fail "--mode=fast $flags: $got, not $summary"
+		fi
+	done
+
+	# and untraced: the same end state from every engine
+
+	state=`sed -n "s|^$obj: ||p" $TMP/lanes`
+	case "$state" in
+	"$summary, "*)	;;
+	*)		fail "--lanes: $state, not $summary" ;;
+	esac
+	$MINVAX --save=$TMP/snapshot $obj > /dev/null
+	got=`$MINVAX --restore=$TMP/snapshot --variants=$TMP/variants |
+		sed 's/^R0=00: //'`
+	if [ "$got" != "$state" ]; then
+		fail "--variants: $got, not $state"
+	fi
+done
+
+echo "$checked programs checked, $failed differences"
+[ $failed -eq 0 ]
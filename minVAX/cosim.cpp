@@ -0,0 +1,154 @@
+// cosim.C
+//
+// --cosim: the fast engine run in lockstep with the RTL model and
+// compared with it as it goes.  See cosim.h.
+
+#include "includes.h"
+
+//
+// cosim_start() - load objfile into a new fast engine machine, with its
+// trace off, and into the shadow of the RTL model's memory, and attach
+// them to cpu.  Returns false if the object file could not be loaded.
+//
+
+bool cosim_start( CoSim &cs, CpuContext &cpu, char *objfile ) {
+	cs.fast = new FastCpu;
+	fast_reset( *cs.fast );
+	trace_off( cs.fast->trace );
+
+	if( !fast_load( *cs.fast, objfile ) ) {
+		delete cs.fast;
+		cs.fast = NULL;
+		return false;
+	}
+
+	memcpy( cs.mem, cs.fast->mem, sizeof( cs.mem ) );
+
+	cs.every = cosim_every;
+	cs.instructions = 0;
+	cs.checks = 0;
+	cs.readMismatch = false;
+	cs.readAddr = 0;
+	cs.readValue = 0;
+	cs.diverged = false;
+
+	cpu.cosim = &cs;
+
+	return true;
+}
+
+//
+// cosim_cycles() - the RTL model's cycles as the fast engine charges
+// them: with the ticks --overlap saved, and without those cache misses
+// and mispredicted branches stalled for.
+//
+
+static long cosim_cycles( const CpuContext &cpu ) {
+	return cpu.cycles + cpu.overlapped -
+		( ( cpu.cache != NULL ) ? cpu.cache->stalls : 0 ) -
+		( ( cpu.predictor != NULL ) ? cpu.predictor->cycles : 0 );
+}
+
+//
+// cosim_matches() - do the two machines agree?
+//
+
+static bool cosim_matches( CpuContext &cpu, const CoSim &cs ) {
+	const FastCpu &f = *cs.fast;
+
+	return !cs.readMismatch &&
+	       cpu.r0.value() == f.r0 && cpu.r1.value() == f.r1 &&
+	       cpu.pc.value() == f.pc && cpu.done == f.done &&
+	       cosim_cycles( cpu ) == f.cycles &&
+	       memcmp( cs.mem, f.mem, sizeof( cs.mem ) ) == 0;
+}
+
+//
+// cosim_step() - the RTL model has retired an instruction: step the
+// fast engine through the same one, and compare the two if this
+// instruction is sampled or a read has already gone wrong.  Returns
+// false, and marks the run diverged, if they differ.
+//
+
+bool cosim_step( CpuContext &cpu ) {
+	CoSim &cs = *cpu.cosim;
+
+	cs.instructions++;
+	fast_step( *cs.fast );
+
+	if( cs.instructions % cs.every != 0 && !cs.readMismatch )
+		return true;
+
+	cs.checks++;
+	if( cosim_matches( cpu, cs ) )
+		return true;
+
+	cs.diverged = true;
+	return false;
+}
+
+//
+// cosim_diff() - one line of the diff, if a and b differ.
+//
+
+static void cosim_diff( FILE *out, const char *name, long a, long b ) {
+	if( a != b )
+		fprintf( out, "  %-10s %10lx %10lx\n", name, a, b );
+}
+
+//
+// cosim_done() - the RTL run is over.  Bring the fast engine to the same
+// point (the PC overflow stop is not a retired instruction), compare the
+// final states, and print the result: a summary line, or which
+// instruction the machines went apart at and everything that differs.
+// Frees the fast engine machine.
+//
+
+void cosim_done( FILE *out, CpuContext &cpu ) {
+	CoSim &cs = *cpu.cosim;
+	const FastCpu &f = *cs.fast;
+
+	if( !cs.diverged && ( !cs.fast->done || cs.instructions % cs.every != 0 ) ) {
+		if( !cs.fast->done )
+			fast_step( *cs.fast );
+
+		cs.checks++;
+		cs.diverged = !cosim_matches( cpu, cs );
+	}
+
+	if( !cs.diverged )
+		fprintf( out, "\nCo-simulation: %ld instructions, %ld compared with"
+			" the fast engine, no differences\n", cs.instructions, cs.checks );
+	else {
+		fprintf( out, "\nCo-simulation: the fast engine differs after"
+			" instruction %ld (PC %02lx, IR %02lx)\n", cs.instructions,
+			cpu.savedPC, cpu.savedIR );
+		if( cs.every > 1 )
+			fprintf( out, "  (compared 1 in %ld, so it went wrong after"
+				" instruction %ld)\n", cs.every,
+				( cs.instructions - 1 ) / cs.every * cs.every );
+
+		fprintf( out, "  %-10s %10s %10s\n", "", "RTL", "fast" );
+		cosim_diff( out, "R0", cpu.r0.value(), f.r0 );
+		cosim_diff( out, "R1", cpu.r1.value(), f.r1 );
+		cosim_diff( out, "PC", cpu.pc.value(), f.pc );
+		cosim_diff( out, "done", cpu.done, f.done );
+		cosim_diff( out, "cycles", cosim_cycles( cpu ), f.cycles );
+
+		for( unsigned int i = 0; i < FAST_MEM_SIZE; i++ ) {
+			char name[16];
+
+			sprintf( name, "mem[%02x]", i );
+			cosim_diff( out, name, cs.mem[i], f.mem[i] );
+		}
+
+		if( cs.readMismatch )
+			fprintf( out, "  the RTL model read %02lx at %02lx, where its"
+				" stores leave %02x\n", cs.readValue, cs.readAddr,
+				cs.mem[cs.readAddr] );
+	}
+
+	delete cs.fast;
+	cs.fast = NULL;
+	cpu.cosim = NULL;
+}
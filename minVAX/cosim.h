@@ -0,0 +1,59 @@
+// cosim.h
+//
+// Co-simulation for --cosim: the RTL model runs with a fast engine
+// machine next to it, stepped one fast_step() per RTL instruction, and
+// after every instruction (or 1 in N with --cosim=N) the two are
+// compared: R0, R1, PC, done, the cycle count and all of memory.  The
+// first difference stops the run with a diff of the two machines.
+//
+// The arch Memory cannot be read except through its MAR, so the RTL
+// side's memory is a shadow: the object file as load_object() reads it,
+// plus every byte store_to_mem() writes.  Every read fetch_into() makes
+// is checked against the shadow, so the shadow cannot drift from the
+// real thing unnoticed.
+//
+// A fast_step() and a 256-byte compare are a few percent of the host
+// time of one RTL instruction, so even checking every instruction costs
+// little; sampling brings it down to the cost of the fast_step().
+
+#ifndef _COSIM_H
+#define _COSIM_H
+
+struct CoSim {
+	FastCpu *fast;				// the reference machine
+	unsigned char mem[FAST_MEM_SIZE];	// the RTL model's memory, shadowed
+
+	long every;					// compare after every Nth instruction
+	long instructions;			// RTL instructions retired
+	long checks;				// comparisons made
+
+	bool readMismatch;			// a read disagreed with the shadow
+	long readAddr;				// where
+	long readValue;				// what the RTL model read there
+
+	bool diverged;				// the machines differ; the run stopped
+};
+
+//
+// cosim_store() - the RTL model wrote value to memory at addr.
+//
+
+inline void cosim_store( CoSim &cs, long addr, long value ) {
+	cs.mem[addr & ( FAST_MEM_SIZE - 1 )] = value;
+}
+
+//
+// cosim_read() - the RTL model read value from memory at addr; note the
+// first read that does not match the shadow.
+//
+
+inline void cosim_read( CoSim &cs, long addr, long value ) {
+	addr &= FAST_MEM_SIZE - 1;
+	if( cs.mem[addr] != value && !cs.readMismatch ) {
+		cs.readMismatch = true;
+		cs.readAddr = addr;
+		cs.readValue = value;
+	}
+}
+
+#endif
@@ -0,0 +1,40 @@
+// cpu_context.C
+//
+// Construction of a minVAX machine for the RTL model.  See
+// cpu_context.h.
+
+#include "includes.h"
+
+//
+// CpuContext() - build the components of one machine, in their
+// power-on state.  make_connections() still has to wire them up.
+//
+
+CpuContext::CpuContext() :
+	abus( "ADDRBUS", ADDR_BITS ),
+	dbus( "DATABUS", DATA_BITS ),
+	aux( "AUX", DATA_BITS ),
+	ir( "IR", DATA_BITS ),
+	addr( "ADDR", ADDR_BITS ),
+	r0( "R0", DATA_BITS ),
+	r1( "R1", DATA_BITS ),
+	pc( "PC", ADDR_BITS ),
+	m( "Memory", ADDR_BITS, DATA_BITS ),
+	alu( "Adder", DATA_BITS ),
+	done( false ),
+	immediate( -1 ),
+	savedPC( 0 ),
+	savedIR( 0 ),
+	cycles( 0 ),
+	reads( 0 ),
+	writes( 0 ),
+	fetchStarted( false ),
+	overlapped( 0 ),
+	latency( NULL ),
+	cosim( NULL ),
+	schedule( NULL ),
+	cache( NULL ),
+	predictor( NULL ) {
+
+	decode_cache_reset( decode_cache );
+}
@@ -0,0 +1,75 @@
+// cpu_context.h
+//
+// The state of one simulated minVAX machine for the RTL model: its
+// buses, registers, memory and ALU, and the runtime control variables
+// that used to be globals.  rtl_instr(), decode_am(), fetch_into(),
+// make_connections() and run_simulation() all work on the CpuContext
+// they are given, so a process can hold any number of machines.
+//
+// The arch Clock is still shared: every component in the process moves
+// on each Clock::tick(), and the simulated time printed at exit is the
+// total for all machines.  Machines must therefore be stepped from one
+// thread at a time.  Each machine counts the ticks it issues itself,
+// through cpu_tick(), along with its memory reads and writes.
+
+#ifndef _CPU_CONTEXT_H
+#define _CPU_CONTEXT_H
+
+struct CoSim;				// --cosim state; see cosim.h
+struct TickSchedule;		// --compact transfers; see tick_schedule.h
+struct MemCache;			// --cache model; see mem_cache.h
+struct Predictor;			// --predict branch predictor; see predictor.h
+
+struct CpuContext {
+	CpuContext();
+
+	// Buses
+	Bus abus;				// bus to carry memory addresses
+	Bus dbus;				// bus to carry data and instructions
+
+	// Registers
+	StorageObject aux;		// auxiliary register
+	StorageObject ir;		// instruction register
+	StorageObject addr;		// address register
+	Counter r0;				// R0 register
+	Counter r1;				// R1 register
+	Counter pc;				// program counter
+
+	// Other components
+	Memory m;				// primary memory
+	BusALU alu;				// arithmetic logic unit
+
+	// Runtime control variables
+	bool done;				// is the simulation over?
+	long immediate;			// immediate value for address modes that use it
+	long savedPC;			// used for printing trace output
+	long savedIR;			// used for printing trace output
+	DecodeCache decode_cache;	// predecoded instructions, keyed by PC
+	TraceWriter trace;		// buffered trace output
+
+	// Counters for --counts
+	long cycles;			// clock ticks this machine has issued
+	long reads;				// memory reads (fetch_into())
+	long writes;			// memory writes
+
+	// --overlap
+	bool fetchStarted;		// the last tick did the next fetch's MAR <- PC
+	long overlapped;		// ticks saved by overlapping
+
+	LatencyStats *latency;	// --latency host time histograms, or NULL
+	CoSim *cosim;			// --cosim fast engine and memory shadow, or NULL
+	TickSchedule *schedule;	// --compact recorded transfers, or NULL
+	MemCache *cache;		// --cache, --icache, --dcache model, or NULL
+	Predictor *predictor;	// --predict branch predictor, or NULL
+};
+
+//
+// cpu_tick() - Clock::tick(), counted against this machine.
+//
+
+inline void cpu_tick( CpuContext &cpu ) {
+	Clock::tick();
+	cpu.cycles++;
+}
+
+#endif
@@ -0,0 +1,102 @@
+// decode_cache.C
+//
+// Predecoded instruction cache for minVAX.  See decode_cache.h.
+
+#include "includes.h"
+
+//
+// decode_cache_reset() - empty the cache and clear its statistics.
+//
+
+void decode_cache_reset( DecodeCache &dc ) {
+	for( unsigned int i = 0; i < DECODE_CACHE_SIZE; i++ )
+		dc.entry[i].valid = false;
+
+	dc.hits = 0;
+	dc.misses = 0;
+	dc.invalidations = 0;
+}
+
+//
+// decode_cache_lookup() - return the decoded instruction at pc, filling
+// the entry from decode_table[] on a miss.
+//
+// mem is the flat memory of the fast engine, used to fill in the
+// immediate byte; the RTL model passes NULL and fills imm in itself once
+// decode_am() has fetched it.
+//
+
+DecodedInstr *decode_cache_lookup( DecodeCache &dc, long pc, long ir,
+	const unsigned char *mem ) {
+
+	DecodedInstr *di = &dc.entry[pc % DECODE_CACHE_SIZE];
+
+	if( di->valid && di->ir == ir ) {
+		dc.hits++;
+		return di;
+	}
+
+	dc.misses++;
+	decode_instr( di, pc, ir, mem );
+
+	return di;
+}
+
+//
+// decode_instr() - fill di with instruction byte ir at pc, from
+// decode_table[].
+//
+
+void decode_instr( DecodedInstr *di, long pc, long ir,
+	const unsigned char *mem ) {
+
+	const DecodeEntry &e = decode_table[ir & 0xff];
+
+	di->valid = true;
+	di->ir = ir;
+	di->opc = e.opc;
+	di->am = e.am;
+	di->ra = e.ra;
+	di->length = e.length;
+
+	if( di->length == 2 && mem != NULL )
+		di->imm = mem[( pc + 1 ) % DECODE_CACHE_SIZE];
+	else
+		di->imm = -1;
+
+	di->handler = e.rtl;
+	di->fastHandler = e.fast;
+}
+
+//
+// decode_cache_invalidate() - a store to addr changes the instruction
+// byte at addr, or the immediate byte of an instruction at addr - 1.
+//
+
+void decode_cache_invalidate( DecodeCache &dc, long addr ) {
+	DecodedInstr &at = dc.entry[addr % DECODE_CACHE_SIZE];
+	DecodedInstr &before = dc.entry[( addr - 1 ) & ( DECODE_CACHE_SIZE - 1 )];
+
+	if( at.valid ) {
+		at.valid = false;
+		dc.invalidations++;
+	}
+
+	if( before.valid && before.length == 2 ) {
+		before.valid = false;
+		dc.invalidations++;
+	}
+}
+
+//
+// decode_cache_report() - print the hit rate on out.
+//
+
+void decode_cache_report( FILE *out, DecodeCache &dc ) {
+	long lookups = dc.hits + dc.misses;
+
+	fprintf( out, "Decode cache: %ld lookups, %ld hits, %ld misses, "
+		"%ld invalidations (%.1f%% hit rate)\n",
+		lookups, dc.hits, dc.misses, dc.invalidations,
+		lookups ? 100.0 * dc.hits / lookups : 0.0 );
+}
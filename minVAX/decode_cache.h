@@ -0,0 +1,34 @@
+// decode_cache.h
+//
+// Predecoded instruction cache for minVAX.
+//
+// Entries are keyed by the address of the instruction.  Each one holds
+// the decoded fields of the instruction byte, its length, its immediate
+// byte and the handlers that execute it, copied from decode_table[], so a
+// loop body is looked up only once.  Stores into memory invalidate the entries they overlap.
+
+#ifndef _DECODE_CACHE_H
+#define _DECODE_CACHE_H
+
+const unsigned int DECODE_CACHE_SIZE( 256 );	// one entry per address
+
+struct DecodedInstr {
+	bool valid;					// does this entry hold a decoded instruction?
+	long ir;					// instruction byte it was decoded from
+	long opc;					// op code, bits 7:4
+	long am;					// address mode, bits 3:1
+	long ra;					// register, bit 0
+	int length;					// 1, or 2 if an immediate byte follows
+	long imm;					// immediate byte, -1 if not known yet
+	RtlHandler handler;			// RTL handler for the instruction byte
+	FastHandler fastHandler;	// fast engine handler for the instruction byte
+};
+
+struct DecodeCache {
+	DecodedInstr entry[DECODE_CACHE_SIZE];
+	long hits;
+	long misses;
+	long invalidations;
+};
+
+#endif
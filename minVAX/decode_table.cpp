@@ -0,0 +1,31 @@
+// decode_table.C
+//
+// The 256-entry decode and dispatch table for minVAX.  See decode_table.h.
+
+#include "includes.h"
+
+//
+// Instruction class of each op code, for the dispatch loops.  See
+// dispatch.h.
+//
+
+const unsigned char instr_class[16] = {
+	INSTR_PLAIN, INSTR_CHECKED, INSTR_CHECKED, INSTR_CHECKED,
+	INSTR_CHECKED, INSTR_CHECKED, INSTR_CHECKED, INSTR_CHECKED,
+	INSTR_CHECKED, INSTR_CHECKED, INSTR_CHECKED, INSTR_PLAIN,
+	INSTR_PLAIN, INSTR_PLAIN, INSTR_PLAIN, INSTR_HALT
+};
+
+//
+// decode_table[] - one entry per instruction byte, filled in entirely at
+// compile time from Decode<IR>.
+//
+
+#define DECODE_ENTRY( n ) \
+	{ Decode<n>::opc, Decode<n>::am, Decode<n>::ra, Decode<n>::length, \
+	  Decode<n>::status, Decode<n>::trace, Decode<n>::reads, \
+	  Decode<n>::writes, &rtl_instr<n>, &fast_instr<n> },
+
+const DecodeEntry decode_table[256] = {
+	DECODE_EACH( DECODE_ENTRY )
+};
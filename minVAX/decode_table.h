@@ -0,0 +1,122 @@
+// decode_table.h
+//
+// Compile-time decoder for minVAX.
+//
+// The instruction byte has only 256 values, so every (opc, am, ra)
+// combination is decoded once, by the compiler.  Decode<IR> holds the
+// fields and properties of instruction byte IR as constants;
+// rtl_instr<IR>() and fast_instr<IR>() are the RTL and fast engine
+// handlers specialized for it; decode_table[] holds one entry per
+// instruction byte, with pointers to both handlers.
+//
+// Address modes that are invalid for an op code (am 0, 1 or 4 with op
+// codes 5-10) are rejected by the handlers generated for those bytes, so
+// nothing checks for them at run time.
+
+#ifndef _DECODE_TABLE_H
+#define _DECODE_TABLE_H
+
+struct CpuContext;
+struct FastCpu;
+struct DecodedInstr;
+
+// How the trace line of an instruction ends.
+enum TraceKind {
+	TRACE_NONE,		// DMP and HLT print their own line
+	TRACE_PLAIN,	// NOP
+	TRACE_REG,		// Rn=xx
+	TRACE_BRANCH,	// BRANCH TAKEN / BRANCH NOT TAKEN
+	TRACE_STORE		// MEM[ea]=xx
+};
+
+// What the decoder makes of an instruction byte.
+enum DecodeStatus {
+	DECODE_OK,
+	DECODE_INVALID_AM,	// address mode not allowed for the op code
+	DECODE_UNKNOWN_AM	// address mode 7
+};
+
+//
+// Decode<IR> - fields of instruction byte IR, known at compile time.
+//
+// instr format: opcode = bits 7:4, address mode = bits 3:1, ra = bit 0
+//
+
+template<int IR>
+struct Decode {
+	static const int opc = ( IR >> 4 ) & 0xf;
+	static const int am = ( IR >> 1 ) & 0x7;
+	static const int ra = IR & 0x1;
+
+	// Op codes 1-9 use the address mode; 1-4 need the data it points
+	// to, 5-9 the effective address itself.
+	static const bool usesAm = ( opc > 0 && opc < 10 );
+	static const bool dataNeeded = ( opc < 5 );
+
+	static const int status =
+		( opc > 4 && opc < 11 && ( am == 0 || am == 1 || am == 4 ) )
+			? DECODE_INVALID_AM
+			: ( usesAm && am == 7 ) ? DECODE_UNKNOWN_AM : DECODE_OK;
+
+	// Address modes 2-6 read an immediate byte after the instruction.
+	static const int length = ( usesAm && am > 1 && am < 7 ) ? 2 : 1;
+
+	// Memory reads and writes the RTL model makes: the instruction byte,
+	// the immediate byte, the data a displacement, absolute or PC
+	// relative mode fetches, and LDR's load or STR's store.  The op code
+	// routine runs even when the address mode is invalid or unknown.
+	static const int reads = 1 + ( length - 1 ) +
+		( ( usesAm && dataNeeded && am > 1 && am < 7 && am != 4 ) ? 1 : 0 ) +
+		( opc == 5 ? 1 : 0 );
+	static const int writes = ( opc == 6 ) ? 1 : 0;
+
+	static const int trace =
+		( opc == 14 || opc == 15 ) ? TRACE_NONE
+		: ( opc == 0 || opc == 10 ) ? TRACE_PLAIN
+		: ( opc == 6 ) ? TRACE_STORE
+		: ( opc > 6 && opc < 10 ) ? TRACE_BRANCH
+		: TRACE_REG;
+};
+
+// Handlers specialized for one instruction byte.  Both return true if a
+// branch was taken.  They are defined (and instantiated for all 256
+// bytes) in execute.cpp and fast_engine.cpp.
+typedef bool (*RtlHandler)( CpuContext &cpu, DecodedInstr *di );
+typedef bool (*FastHandler)( FastCpu &cpu, DecodedInstr *di );
+
+template<int IR> bool rtl_instr( CpuContext &cpu, DecodedInstr *di );
+template<int IR> bool fast_instr( FastCpu &cpu, DecodedInstr *di );
+
+struct DecodeEntry {
+	unsigned char opc;
+	unsigned char am;
+	unsigned char ra;
+	unsigned char length;		// 1, or 2 if an immediate byte follows
+	unsigned char status;		// DecodeStatus
+	unsigned char trace;		// TraceKind
+	unsigned char reads;		// memory reads, including the fetch
+	unsigned char writes;		// memory writes
+	RtlHandler rtl;				// RTL handler
+	FastHandler fast;			// fast engine handler
+};
+
+extern const DecodeEntry decode_table[256];
+extern const char *const op_mnemonics[16];	// mnemonic for each op code
+
+//
+// DECODE_EACH( T ) - expand T( n ) for every instruction byte n.
+//
+
+#define DECODE_EACH_4( T, n ) \
+	T( (n) ) T( (n) + 1 ) T( (n) + 2 ) T( (n) + 3 )
+#define DECODE_EACH_16( T, n ) \
+	DECODE_EACH_4( T, (n) ) DECODE_EACH_4( T, (n) + 4 ) \
+	DECODE_EACH_4( T, (n) + 8 ) DECODE_EACH_4( T, (n) + 12 )
+#define DECODE_EACH_64( T, n ) \
+	DECODE_EACH_16( T, (n) ) DECODE_EACH_16( T, (n) + 16 ) \
+	DECODE_EACH_16( T, (n) + 32 ) DECODE_EACH_16( T, (n) + 48 )
+#define DECODE_EACH( T ) \
+	DECODE_EACH_64( T, 0 ) DECODE_EACH_64( T, 64 ) \
+	DECODE_EACH_64( T, 128 ) DECODE_EACH_64( T, 192 )
+
+#endif
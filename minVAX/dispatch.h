@@ -0,0 +1,59 @@
+// dispatch.h
+//
+// Dispatch for the fetch-execute loops of run_simulation() and
+// run_fast().
+//
+// Each loop is written once with these macros and compiled either as a
+// direct-threaded interpreter (GCC computed gotos: the code for every
+// instruction class ends with its own fetch and indirect jump to the
+// next one, so the branch predictor sees one jump per class instead of a
+// single shared one) or as a portable loop around a switch.  Define
+// NO_THREADED_DISPATCH to get the switch with GCC as well.
+//
+// The loop using them supplies FETCH(), which fetches the next
+// instruction and sets di, and a dispatch[] table of labels
+// (INSTR_LABELS) when threaded.
+//
+//   INSTR( c )   start the code for instruction class c
+//   NEXT()       go on with the next instruction
+
+#ifndef _DISPATCH_H
+#define _DISPATCH_H
+
+#if defined( __GNUC__ ) && !defined( NO_THREADED_DISPATCH )
+#define THREADED_DISPATCH
+#endif
+
+//
+// Instruction classes, by op code.
+//
+//   INSTR_PLAIN    can never stop the machine (NOP, CLR, CMP, INC, DMP)
+//   INSTR_CHECKED  may stop it on an invalid or unknown address mode
+//   INSTR_HALT     HLT
+//
+
+enum InstrClass { INSTR_PLAIN, INSTR_CHECKED, INSTR_HALT };
+
+extern const unsigned char instr_class[16];
+
+#ifdef THREADED_DISPATCH
+
+#define INSTR( c )	L_##c:
+#define NEXT()		FETCH(); goto *dispatch[di->opc]
+
+// label of the code for each op code, in the order of instr_class[]
+#define INSTR_LABELS { \
+	&&L_INSTR_PLAIN, &&L_INSTR_CHECKED, &&L_INSTR_CHECKED, \
+	&&L_INSTR_CHECKED, &&L_INSTR_CHECKED, &&L_INSTR_CHECKED, \
+	&&L_INSTR_CHECKED, &&L_INSTR_CHECKED, &&L_INSTR_CHECKED, \
+	&&L_INSTR_CHECKED, &&L_INSTR_CHECKED, &&L_INSTR_PLAIN, \
+	&&L_INSTR_PLAIN, &&L_INSTR_PLAIN, &&L_INSTR_PLAIN, &&L_INSTR_HALT }
+
+#else
+
+#define INSTR( c )	case c:
+#define NEXT()		continue
+
+#endif
+
+#endif
@@ -21,19 +21,14 @@
 // Code 1
 //
 
-void add_to_ra( Counter &ra ) {
-	alu.OP1().pullFrom( ra );
-	alu.OP2().pullFrom( addr );
-	alu.perform( BusALU::op_add );
-	
+void add_to_ra( CpuContext &cpu, Counter &ra ) {
 	// Get the result from ALU into AUX.
-	aux.latchFrom( alu.OUT() );
-	Clock::tick();
+	alu_transfer( cpu, BusALU::op_add, ra, cpu.addr, cpu.aux );
+	cpu_tick( cpu );
 	
 	// Get the value from AUX into RA.
-	dbus.IN().pullFrom( aux );
-	ra.latchFrom( dbus.OUT() );
-	Clock::tick();
+	transfer( cpu, cpu.dbus, cpu.aux, ra );
+	cpu_tick( cpu );
 }
 
 //
@@ -46,19 +41,14 @@ void add_to_ra( Counter &ra ) {
 // Code 2
 //
 
-void and_to_ra( Counter &ra ) {
-	alu.OP1().pullFrom( ra );
-	alu.OP2().pullFrom( addr );
-	alu.perform( BusALU::op_and );
-	
+void and_to_ra( CpuContext &cpu, Counter &ra ) {
 	// Get the result from ALU into AUX.
-	aux.latchFrom( alu.OUT() );
-	Clock::tick();
+	alu_transfer( cpu, BusALU::op_and, ra, cpu.addr, cpu.aux );
+	cpu_tick( cpu );
 	
 	// Get the value from AUX into RA.
-	dbus.IN().pullFrom( aux );
-	ra.latchFrom( dbus.OUT() );
-	Clock::tick();
+	transfer( cpu, cpu.dbus, cpu.aux, ra );
+	cpu_tick( cpu );
 }
 
 //
@@ -72,19 +62,14 @@ void and_to_ra( Counter &ra ) {
 // Code 3
 //
 
-void shift_right_arithmetic( Counter &ra ) {
-	alu.OP1().pullFrom( ra );
-	alu.OP2().pullFrom( addr );
-	alu.perform( BusALU::op_rashift );
-	
+void shift_right_arithmetic( CpuContext &cpu, Counter &ra ) {
 	// Get the result from ALU into AUX.
-	aux.latchFrom( alu.OUT() );
-	Clock::tick();
+	alu_transfer( cpu, BusALU::op_rashift, ra, cpu.addr, cpu.aux );
+	cpu_tick( cpu );
 	
 	// Get the value from AUX into RA.
-	dbus.IN().pullFrom( aux );
-	ra.latchFrom( dbus.OUT() );
-	Clock::tick();
+	transfer( cpu, cpu.dbus, cpu.aux, ra );
+	cpu_tick( cpu );
 }
 
 //
@@ -98,20 +83,14 @@ void shift_right_arithmetic( Counter &ra ) {
 // Code 4
 //
 
-void shift_left_logical( Counter &ra ) {
-	alu.OP1().pullFrom( ra );
-	alu.OP2().pullFrom( addr );
-	
-	alu.perform( BusALU::op_lshift );
-	
+void shift_left_logical( CpuContext &cpu, Counter &ra ) {
 	// Get the result from ALU into AUX.
-	aux.latchFrom( alu.OUT() );
-	Clock::tick();
+	alu_transfer( cpu, BusALU::op_lshift, ra, cpu.addr, cpu.aux );
+	cpu_tick( cpu );
 	
 	// Get the value from AUX into RA.
-	dbus.IN().pullFrom( aux );
-	ra.latchFrom( dbus.OUT() );
-	Clock::tick();
+	transfer( cpu, cpu.dbus, cpu.aux, ra );
+	cpu_tick( cpu );
 }
 
 //
@@ -126,15 +105,14 @@ void shift_left_logical( Counter &ra ) {
 // Code 5
 //
 
-void load_to_ra( Counter &ra ) {
+void load_to_ra( CpuContext &cpu, Counter &ra ) {
 	// Get the value in memory specified by ADDR into AUX.
 	// AUX <- Mem[ADDR]
-	fetch_into( addr, abus, aux );
+	fetch_into( cpu, cpu.addr, cpu.abus, cpu.aux );
 	
 	// RA <- AUX
-	dbus.IN().pullFrom( aux );
-	ra.latchFrom( dbus.OUT() );
-	Clock::tick();
+	transfer( cpu, cpu.dbus, cpu.aux, ra );
+	cpu_tick( cpu );
 }
 
 //
@@ -149,19 +127,24 @@ void load_to_ra( Counter &ra ) {
 // Code 6
 //
 
-void store_to_mem( Counter &ra ) {
+void store_to_mem( CpuContext &cpu, Counter &ra ) {
 	// MAR <- ADDR, AUX <- RA
-	abus.IN().pullFrom( addr );
-	m.MAR().latchFrom( abus.OUT() );
-	
-	dbus.IN().pullFrom( ra );
-	aux.latchFrom( dbus.OUT() );
-	Clock::tick();
-	
-	// Mem[MAR] <- AUX
-	m.WRITE().pullFrom( aux );
-	m.write();
-	Clock::tick();
+	transfer( cpu, cpu.abus, cpu.addr, cpu.m.MAR() );
+	transfer( cpu, cpu.dbus, ra, cpu.aux );
+	cpu_tick( cpu );
+	
+	// Mem[MAR] <- AUX, after any cache miss
+	if( cpu.cache != NULL )
+		cache_write( cpu );
+	memory_write( cpu, cpu.aux );
+	cpu.writes++;
+	cpu_tick( cpu );
+
+	if( cpu.cosim != NULL )
+		cosim_store( *cpu.cosim, cpu.addr.value(), cpu.aux.value() );
+
+	// The store may have overwritten a predecoded instruction.
+	decode_cache_invalidate( cpu.decode_cache, cpu.addr.value() );
 }
 
 //
@@ -174,11 +157,10 @@ void store_to_mem( Counter &ra ) {
 // Code 7
 //
 
-bool jump() {
+bool jump( CpuContext &cpu ) {
 	// PC <- ADDR
-	abus.IN().pullFrom( addr );
-	pc.latchFrom( abus.OUT() );
-	Clock::tick();
+	transfer( cpu, cpu.abus, cpu.addr, cpu.pc );
+	cpu_tick( cpu );
 	
 	// True for branch was taken.
 	return true;
@@ -194,10 +176,10 @@ bool jump() {
 // Code 8
 //
 
-bool branch_if_ra_equals_zero( Counter &ra ) {
+bool branch_if_ra_equals_zero( CpuContext &cpu, Counter &ra ) {
 	// if RA == 0 then PC = EA
 	if( ra.value() == 0 ) {
-		jump();
+		jump( cpu );
 		
 		// True for branch was taken.
 		return true;
@@ -217,10 +199,10 @@ bool branch_if_ra_equals_zero( Counter &ra ) {
 // Code 9
 //
 
-bool branch_if_ra_less_than_zero( Counter &ra ) {
+bool branch_if_ra_less_than_zero( CpuContext &cpu, Counter &ra ) {
 	// if RA < 0 then PC = EA
 	if( ra( ADDR_BITS - 1 ) == 1 ) {
-		jump();
+		jump( cpu );
 		
 		// True for branch was taken.
 		return true;
@@ -239,9 +221,9 @@ bool branch_if_ra_less_than_zero( Counter &ra ) {
 // Code 11
 //
 
-void clear_ra( Counter &ra ) {
-	ra.clear();
-	Clock::tick();
+void clear_ra( CpuContext &cpu, Counter &ra ) {
+	register_clear( cpu, ra );
+	cpu_tick( cpu );
 }
 
 //
@@ -253,19 +235,14 @@ void clear_ra( Counter &ra ) {
 // Code 12
 //
 
-void complement_ra( Counter &ra ) {
-	alu.OP1().pullFrom( ra );
-	alu.OP2().pullFrom( addr );
-	alu.perform( BusALU::op_not );
-	
+void complement_ra( CpuContext &cpu, Counter &ra ) {
 	// Get the result from ALU into AUX.
-	aux.latchFrom( alu.OUT() );
-	Clock::tick();
+	alu_transfer( cpu, BusALU::op_not, ra, cpu.addr, cpu.aux );
+	cpu_tick( cpu );
 	
 	// Get the value from AUX into RA.
-	dbus.IN().pullFrom( aux );
-	ra.latchFrom( dbus.OUT() );
-	Clock::tick();
+	transfer( cpu, cpu.dbus, cpu.aux, ra );
+	cpu_tick( cpu );
 }
 
 //
@@ -278,28 +255,14 @@ void complement_ra( Counter &ra ) {
 // Code 13
 //
 
-void increment_ra( Counter &ra ) {
+void increment_ra( CpuContext &cpu, Counter &ra ) {
 	// RA <- RA + 1
-	ra.incr();
-	Clock::tick();
-}
-
-//
-// dump_ra() - dump (print) the value of register RA.
-//
-// RTL (Register Transfer Language)
-// null
-//
-// Code 14
-//
-
-void dump_ra( Counter &ra, long ra_name, long am ) {
-	printf("%02lx:  %02lx = ", savedPC, savedIR);
-	printf( "DMP %01lx %01lx    R%lu=%02lx", ra_name, am, ra_name, ra.value() );
+	register_incr( cpu, ra );
+	cpu_tick( cpu );
 }
 
 //
-// dump_ra_short() - dump (print) the value of register RA.
+// dump_ra() - dump the value of register RA into the trace.
 //
 // RTL (Register Transfer Language)
 // null
@@ -307,8 +270,8 @@ void dump_ra( Counter &ra, long ra_name, long am ) {
 // Code 14
 //
 
-void dump_ra_short( Counter &ra, long ra_name ) {
-	printf( "R%lu=%02lx", ra_name, ra.value() );
+void dump_ra( CpuContext &cpu, Counter &ra ) {
+	cpu.trace.rec.value = ra.value();
 }
 
 
@@ -321,13 +284,53 @@ void dump_ra_short( Counter &ra, long ra_name ) {
 // Code 15
 //
 
-void halt(long ra, long am) {
-	printf("%02lx:  %02lx = ", savedPC, savedIR);
-	printf("%3s %01lx %01lx   ", "HLT", ra, am);
-	cout << endl << endl << "MACHINE HALTED due to halt instruction" << endl;
-	done = true;
+void halt( CpuContext &cpu ) {
+	cpu.done = true;
 }
 
+//
+// Op code routines, indexed by op code, for the handlers generated by
+// rtl_instr<>().  Each one runs the routine for its instruction and
+// returns true if a branch was taken.
+//
+
+typedef bool (*OpRoutine)( CpuContext &cpu, Counter &ra, long ra_name, long am );
+
+static bool op_nop( CpuContext &, Counter &, long, long )	{ return false; }
+static bool op_add( CpuContext &cpu, Counter &ra, long, long )
+	{ add_to_ra( cpu, ra ); return false; }
+static bool op_and( CpuContext &cpu, Counter &ra, long, long )
+	{ and_to_ra( cpu, ra ); return false; }
+static bool op_sra( CpuContext &cpu, Counter &ra, long, long )
+	{ shift_right_arithmetic( cpu, ra ); return false; }
+static bool op_sll( CpuContext &cpu, Counter &ra, long, long )
+	{ shift_left_logical( cpu, ra ); return false; }
+static bool op_ldr( CpuContext &cpu, Counter &ra, long, long )
+	{ load_to_ra( cpu, ra ); return false; }
+static bool op_str( CpuContext &cpu, Counter &ra, long, long )
+	{ store_to_mem( cpu, ra ); return false; }
+static bool op_jmp( CpuContext &cpu, Counter &, long, long )
+	{ return jump( cpu ); }
+static bool op_bez( CpuContext &cpu, Counter &ra, long, long )
+	{ return branch_if_ra_equals_zero( cpu, ra ); }
+static bool op_blt( CpuContext &cpu, Counter &ra, long, long )
+	{ return branch_if_ra_less_than_zero( cpu, ra ); }
+static bool op_clr( CpuContext &cpu, Counter &ra, long, long )
+	{ clear_ra( cpu, ra ); return false; }
+static bool op_cmp( CpuContext &cpu, Counter &ra, long, long )
+	{ complement_ra( cpu, ra ); return false; }
+static bool op_inc( CpuContext &cpu, Counter &ra, long, long )
+	{ increment_ra( cpu, ra ); return false; }
+static bool op_dmp( CpuContext &cpu, Counter &ra, long, long )
+	{ dump_ra( cpu, ra ); return false; }
+static bool op_hlt( CpuContext &cpu, Counter &, long, long )
+	{ halt( cpu ); return false; }
+
+static const OpRoutine op_routines[16] = {
+	op_nop, op_add, op_and, op_sra, op_sll, op_ldr, op_str, op_jmp,
+	op_bez, op_blt, op_nop, op_clr, op_cmp, op_inc, op_dmp, op_hlt
+};
+
 // Functions for decoding effective address, based on address modes (am).
 
 //
@@ -339,11 +342,10 @@ void halt(long ra, long am) {
 // Effective Address: data in Rn
 //
 
-void register_am( Counter &reg ) {
-	dbus.IN().pullFrom( reg );
-	addr.latchFrom( dbus.OUT() );
+void register_am( CpuContext &cpu, Counter &reg ) {
+	transfer( cpu, cpu.dbus, reg, cpu.addr );
 	
-	Clock::tick();
+	cpu_tick( cpu );
 }
 
 //
@@ -354,34 +356,29 @@ void register_am( Counter &reg ) {
 // Effective Address: EA = reg + imm
 //
 
-void displacement_am( Counter &reg, bool dataNeeded ) {
+void displacement_am( CpuContext &cpu, Counter &reg, bool dataNeeded ) {
 	// PC is pointing to the immediate value; get the imm value into addr.
-	fetch_into( pc, abus, addr );
-	pc.incr();
+	fetch_into( cpu, cpu.pc, cpu.abus, cpu.addr );
+	register_incr( cpu, cpu.pc );
 	
 	// Save the immediate value for trace output.
-	immediate = addr.value();
+	cpu.immediate = cpu.addr.value();
 	
 	// Compute EA = reg + imm; addr = reg + addr.
-	alu.OP1().pullFrom( reg );
-	alu.OP2().pullFrom( addr );
-	alu.perform( BusALU::op_add );
-	
 	// Get the output from ALU into AUX.
-	aux.latchFrom( alu.OUT() );
-	Clock::tick();
+	alu_transfer( cpu, BusALU::op_add, reg, cpu.addr, cpu.aux );
+	cpu_tick( cpu );
 	
 	// Instead of moving the address into the address register, use the address 
 	// to get the data.
 	if( dataNeeded ) {
-		fetch_into( aux, abus, addr );
+		fetch_into( cpu, cpu.aux, cpu.abus, cpu.addr );
 	}
 	// Otherwise, store the address.
 	else {
 		// Get the value from AUX into ADDR.
-		dbus.IN().pullFrom( aux );
-		addr.latchFrom( dbus.OUT() );
-		Clock::tick();
+		transfer( cpu, cpu.dbus, cpu.aux, cpu.addr );
+		cpu_tick( cpu );
 	}
 }
 
@@ -394,15 +391,17 @@ void displacement_am( Counter &reg, bool dataNeeded ) {
 // Effective Address: data in imm
 //
 
-void immediate_am() {
+void immediate_am( CpuContext &cpu ) {
 	// PC is pointing to the immediate value; get the imm value into addr.
-	fetch_into( pc, abus, addr );
+	// The read may go with the PC increment.
+	fetch_overlapped( cpu, cpu.pc, cpu.abus, cpu.addr );
 	
-	// Save the immediate value for trace output.
-	immediate = addr.value();
+	register_incr( cpu, cpu.pc );
+	cpu_tick( cpu );
+	fetch_done( cpu, cpu.addr );
 	
-	pc.incr();
-	Clock::tick();
+	// Save the immediate value for trace output.
+	cpu.immediate = cpu.addr.value();
 }
 
 //
@@ -413,20 +412,22 @@ void immediate_am() {
 // Effective Address: EA = imm
 //
 
-void absolute_am( bool dataNeeded ) {
+void absolute_am( CpuContext &cpu, bool dataNeeded ) {
 	// PC is pointing to the immediate value; get the imm value into addr.
-	fetch_into( pc, abus, addr );
+	// The read may go with the PC increment.
+	fetch_overlapped( cpu, cpu.pc, cpu.abus, cpu.addr );
 	
-	// Save the immediate value for trace output.
-	immediate = addr.value();
+	register_incr( cpu, cpu.pc );
+	cpu_tick( cpu );
+	fetch_done( cpu, cpu.addr );
 	
-	pc.incr();
-	Clock::tick();
+	// Save the immediate value for trace output.
+	cpu.immediate = cpu.addr.value();
 	
 	// Instead of moving the address into the address register, use the address 
 	// to get the data.
 	if( dataNeeded ) {
-		fetch_into( addr, abus, addr );
+		fetch_into( cpu, cpu.addr, cpu.abus, cpu.addr );
 	}
 }
 
@@ -440,185 +441,117 @@ void absolute_am( bool dataNeeded ) {
 // Effective Address: EA = PC + imm
 //
 
-void pc_relative_am( bool dataNeeded ) {
+void pc_relative_am( CpuContext &cpu, bool dataNeeded ) {
 	// PC is pointing to the immediate value; get the imm value into addr.
-	fetch_into( pc, abus, addr );
+	// The read may go with the PC increment.
+	fetch_overlapped( cpu, cpu.pc, cpu.abus, cpu.addr );
 	
-	// Save the immediate value for trace output.
-	immediate = addr.value();
+	register_incr( cpu, cpu.pc );
+	cpu_tick( cpu );
+	fetch_done( cpu, cpu.addr );
 	
-	pc.incr();
-	Clock::tick();
+	// Save the immediate value for trace output.
+	cpu.immediate = cpu.addr.value();
 	
 	// Compute EA = PC + imm; addr = pc + addr
-	alu.OP1().pullFrom( pc );
-	alu.OP2().pullFrom( addr );
-	alu.perform( BusALU::op_add );
-	
 	// Get the output from ALU into AUX.
-	aux.latchFrom( alu.OUT() );
-	Clock::tick();
+	alu_transfer( cpu, BusALU::op_add, cpu.pc, cpu.addr, cpu.aux );
+	cpu_tick( cpu );
 	
 	// Instead of moving the address into the address register, use the address 
 	// to get the data.
 	if( dataNeeded ) {
-		fetch_into( pc, abus, addr );
+		fetch_into( cpu, cpu.pc, cpu.abus, cpu.addr );
 	}
 	// Otherwise, store the address.
 	else {
 		// Get the value from AUX into ADDR.
-		dbus.IN().pullFrom( aux );
-		addr.latchFrom( dbus.OUT() );
-		Clock::tick();
+		transfer( cpu, cpu.dbus, cpu.aux, cpu.addr );
+		cpu_tick( cpu );
 	}
 }
 
-bool decode_am( long am, bool dataNeeded ) {
-	switch( am ) {
-		case 0:	register_am( r0 );						return true;
-		case 1:	register_am( r1 );						return true;
-		case 2:	displacement_am( r0, dataNeeded );		return false;
-		case 3:	displacement_am( r1, dataNeeded );		return false;
-		case 4:	immediate_am();							return true;
-		case 5:	absolute_am( dataNeeded );				return false;
-		case 6:	pc_relative_am( dataNeeded );			return false;
+//
+// decode_am() - compute the effective address or data for address mode AM
+// into addr.  Returns true if addr holds data rather than an address.
+//
+
+template<int AM>
+bool decode_am( CpuContext &cpu, bool dataNeeded ) {
+	switch( AM ) {
+		case 0:	register_am( cpu, cpu.r0 );					return true;
+		case 1:	register_am( cpu, cpu.r1 );					return true;
+		case 2:	displacement_am( cpu, cpu.r0, dataNeeded );	return false;
+		case 3:	displacement_am( cpu, cpu.r1, dataNeeded );	return false;
+		case 4:	immediate_am( cpu );						return true;
+		case 5:	absolute_am( cpu, dataNeeded );				return false;
+		case 6:	pc_relative_am( cpu, dataNeeded );			return false;
 		default:
-			cout << endl << 
-				"MACHINE HALTED due to unknown address mode" << endl;
-			done = true;
+			cpu.done = true;
 			return false;
 	}
 }
 
 //
-// execute() - decode and execute the instruction
+// rtl_instr() - decode and execute instruction byte IR.
+//
+// One of these is generated for each of the 256 instruction bytes, and
+// decode_table[] points to them.  All of the decoding - the op code,
+// the address mode routine, whether the mode is allowed, and how the
+// trace line ends - is resolved by the compiler.
 //
 
-void execute() {
-	long opc;
-	long am;
-	long ra;
-	long imm;
+template<int IR>
+bool rtl_instr( CpuContext &cpu, DecodedInstr *di ) {
+	typedef Decode<IR> D;
 	bool branchTaken;
-	
-	// If true, instead of storing the EA for use later as an address, 
-	// the EA is pointing to the data itself.
-	bool dataNeeded;
-	
-	// Represents the operation performed by the instruction's opcode.
-	const char* mnemonic;
-	
-	// Used to keep track of data vs. memory addresses stored in addr.
-	// Since some instructions need a memory address in addr, an
-	// invalid address mode could be used if addr contains data.
-	// In that case, the machine should halt due to invalid address mode.
-	bool data_in_addr;
-
-	// In each case, note that the last set of operations aren't actually 
-	// performed until we leave the switch statement.
-	//
-	// instr format: opcode = bits 7:4, address mode = bits 3:1, ra = bit 0
-
-	opc = ir( DATA_BITS-1, DATA_BITS-4 );
-	am = ir( DATA_BITS-5, DATA_BITS-7 );
-	ra = ir( DATA_BITS-8 );
-	
-	// Check for invalid address modes.
-	if( opc > 4 && opc < 11 && ( am == 0 || am == 1 || am == 4 ) ) {
-		cout << endl << "MACHINE HALTED due to invalid address mode" << endl;
-			done = true;
-	}
-	
+
+	// Address modes not allowed for the op code.  The transfers are still
+	// made, as before, but the machine stops after this instruction.
+	if( D::status == DECODE_INVALID_AM )
+		cpu.done = true;
+
 	// Get the content of addr, if address mode matters for the instruction.
-	// Ignore NOP, opc 0 and opc 10.
-	if( opc > 0 && opc < 10 ) {
-		if( opc > -1 && opc < 5 )
-			dataNeeded = true;
-		else
-			dataNeeded = false;
-		data_in_addr = decode_am( am, dataNeeded );
+	if( D::usesAm ) {
+		decode_am<D::am>( cpu, D::dataNeeded );
+		if( cpu.latency != NULL )
+			latency_end( *cpu.latency, cpu.latency->am[D::am] );
+
+		// Remember the immediate byte decode_am() fetched.
+		if( D::length == 2 )
+			di->imm = cpu.immediate;
 	}
-		
+
 	// Get the register represented by ra as RA.
-	Counter &ra_reg = (( ra == 0 ) ? r0 : r1 );
-	
-	// Opcode represents instructions supported by the minVAX CPU.
-	switch( opc ) {
-		// Instructions that use the address mode to get the data.
-		case 0:												mnemonic = "NOP";
-						break;
-		case 1: 	add_to_ra( ra_reg );					mnemonic = "ADD";
-						break;
-		case 2: 	and_to_ra( ra_reg );					mnemonic = "AND";
-						break;
-		case 3: 	shift_right_arithmetic( ra_reg );		mnemonic = "SRA";
-						break;
-		case 4: 	shift_left_logical( ra_reg );			mnemonic = "SLL";
-						break;
-		
-		// Instructions that use the address mode to get an effective address.
-		case 5: 	load_to_ra( ra_reg );					mnemonic = "LDR";
-						break;
-		case 6: 	store_to_mem( ra_reg );					mnemonic = "STR";
-						break;
-		case 7: 	branchTaken = jump();					mnemonic = "JMP";
-						break;
-		case 8: 	branchTaken = 
-					branch_if_ra_equals_zero( ra_reg );		mnemonic = "BEZ";
-						break;
-		case 9: 	branchTaken = 
-					branch_if_ra_less_than_zero( ra_reg );	mnemonic = "BLT";
-						break;
-		case 10: 											mnemonic = "NOP";
-						break;
-		
-		// Instructions that ignore the address mode.
-		case 11:	clear_ra( ra_reg );						mnemonic = "CLR";
-						break;
-		case 12:	complement_ra( ra_reg );				mnemonic = "CMP";
-						break;
-		case 13:	increment_ra( ra_reg );					mnemonic = "INC";
-						break;
-		case 14:	dump_ra( ra_reg, ra, am );				mnemonic = "DMP";
-						break;
-		case 15:	halt( ra, am );							mnemonic = "HLT";	
-						break;
+	Counter &ra_reg = (( D::ra == 0 ) ? cpu.r0 : cpu.r1 );
 
-		default:
-			cout << endl << "MACHINE HALTED due to unknown op code" 
-				<< opc << endl;
-			done = true;
-	}
-	
-	if( opc != 15 && opc != 14 && !done ) {
-		printf("%02lx:  %02lx = ", savedPC, savedIR);
-		printf("%3s %01lx %01lx", mnemonic, ra, am);
-		
-		if( opc != 0 && opc != 10 ) {
-			if( immediate == -1 )
-				printf("    ");
-			else
-				printf(" %02lx ", immediate);
-		
-			immediate = -1;
-			
-			if( opc < 6 || opc > 10 )
-				dump_ra_short( ra_reg, ra );
-			else if( opc > 6 && opc < 10 ) {
-				if( branchTaken )
-					printf("BRANCH TAKEN");
-				else
-					printf("BRANCH NOT TAKEN");
-				
-				branchTaken = false;
-			}
-			else if( opc == 6 )
-				printf("MEM[%01lx]=%02lx", addr.value(), aux.value());
+	branchTaken = op_routines[D::opc]( cpu, ra_reg, D::ra, D::am );
+
+	// With --predict, a mispredicted branch stalls.
+	if( D::opc >= 7 && D::opc <= 9 && D::status == DECODE_OK &&
+	    cpu.predictor != NULL )
+		predict_rtl( cpu, branchTaken );
+
+	// What the trace line shows; trace_retire() prints it.
+	if( D::trace > TRACE_PLAIN && !cpu.done ) {
+		TraceRecord &rec = cpu.trace.rec;
+
+		rec.imm = cpu.immediate;
+		cpu.immediate = -1;
+
+		if( D::trace == TRACE_REG )
+			rec.value = ra_reg.value();
+		else if( D::trace == TRACE_BRANCH )
+			rec.taken = branchTaken;
+		else {
+			rec.addr = cpu.addr.value();
+			rec.value = cpu.aux.value();
 		}
-		else
-			printf("   ");
 	}
-	
-	Clock::tick();
 
+	return branchTaken;
 }
+
+#define RTL_INSTANTIATE( n ) \
+	template bool rtl_instr<n>( CpuContext &, DecodedInstr * );
+DECODE_EACH( RTL_INSTANTIATE )
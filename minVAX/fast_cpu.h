@@ -0,0 +1,42 @@
+// fast_cpu.h
+//
+// Machine state for the functional ("fast path") minVAX engine.
+//
+// The RTL model moves every value through the arch buses and registers
+// one clock tick at a time.  The fast engine keeps the same registers as
+// plain bytes and memory as a flat array, and charges each instruction
+// the number of ticks the RTL model would have issued for it.
+
+#ifndef _FAST_CPU_H
+#define _FAST_CPU_H
+
+const unsigned int FAST_MEM_SIZE( 256 );	// 8-bit address => 256 bytes
+
+struct FastCpu {
+	unsigned char aux;		// auxiliary register
+	unsigned char ir;		// instruction register
+	unsigned char addr;		// address register
+	unsigned char r0;		// R0 register
+	unsigned char r1;		// R1 register
+	unsigned char pc;		// program counter
+	bool pcOverflow;		// did the last PC increment wrap around?
+
+	unsigned char mem[FAST_MEM_SIZE];	// primary memory
+
+	bool done;				// is the simulation over?
+	long immediate;			// immediate value for address modes that use it
+	long savedPC;			// used for printing trace output
+	long savedIR;			// used for printing trace output
+
+	DecodeCache dcache;		// predecoded instructions, keyed by address
+	BlockCache bcache;		// translated basic blocks, keyed by entry address
+	JitCache jit;			// host code for the blocks
+
+	long cycles;			// RTL clock ticks this run would have taken
+	long instructions;		// instructions executed
+	long limit;				// stop after this many instructions (0 = never)
+
+	TraceWriter trace;		// trace and halt messages; out is stdout by default
+};
+
+#endif
@@ -0,0 +1,764 @@
+// fast_engine.C
+//
+// Functional ("fast path") execution engine for minVAX.
+//
+// Implements the same op codes and address modes as rtl_instr() and
+// decode_am(), but on the plain registers and flat memory of a FastCpu
+// instead of the arch components.  The trace output is identical to the
+// RTL model, and every instruction is charged the number of clock ticks
+// the RTL model issues for it, so the reported cycle count matches the
+// RTL run.
+
+#include "includes.h"
+
+//
+// fast_load() - load an object file or memory image into the fast
+// engine's memory.
+//
+// RTL charge: 2 ticks to move the entry point into PC.
+//
+
+bool fast_load( FastCpu &cpu, char *objfile ) {
+	long entry;
+
+	if( !load_object( objfile, cpu.mem, entry ) )
+		return false;
+
+	trace_start( cpu.trace, entry, true );
+
+	cpu.pc = entry;
+	cpu.cycles += 2;
+
+	return true;
+}
+
+//
+// fast_reset() - power-on state, matching the arch components and the
+// runtime control variables in globals.cpp.
+//
+
+void fast_reset( FastCpu &cpu ) {
+	cpu.aux = cpu.ir = cpu.addr = 0;
+	cpu.r0 = cpu.r1 = cpu.pc = 0;
+	cpu.pcOverflow = false;
+
+	for( unsigned int i = 0; i < FAST_MEM_SIZE; i++ )
+		cpu.mem[i] = 0;
+
+	cpu.done = false;
+	cpu.immediate = -1;
+	cpu.savedPC = 0;
+	cpu.savedIR = 0;
+	cpu.cycles = 0;
+	cpu.instructions = 0;
+	cpu.limit = 0;
+
+	decode_cache_reset( cpu.dcache );
+	block_cache_reset( cpu.bcache );
+	jit_reset( cpu.jit );
+}
+
+//
+// fast_incr_pc() - PC <- PC + 1, recording overflow like Counter::incr().
+//
+
+static void fast_incr_pc( FastCpu &cpu ) {
+	cpu.pc++;
+	cpu.pcOverflow = ( cpu.pc == 0 );
+}
+
+//
+// fast_decode_am() - compute addr for the address mode, as decode_am().
+// The immediate byte comes from the predecoded instruction.
+//
+// RTL charge per address mode (fetch_into() is 2 ticks):
+//     register      1
+//     displacement  4, or 5 if dataNeeded
+//     immediate     3
+//     absolute      3, or 5 if dataNeeded
+//     PC relative   5, or 6 if dataNeeded
+//
+
+template<int AM>
+static void fast_decode_am( FastCpu &cpu, DecodedInstr *di, bool dataNeeded ) {
+	long am = AM;
+
+	switch( AM ) {
+		case 0:
+		case 1:
+			// ADDR <- Rn
+			cpu.addr = ( am == 0 ) ? cpu.r0 : cpu.r1;
+			cpu.cycles += 1;
+			break;
+
+		case 2:
+		case 3:
+			// ADDR <- imm, AUX <- Rn + imm
+			cpu.addr = di->imm;
+			fast_incr_pc( cpu );
+			cpu.immediate = cpu.addr;
+			cpu.aux = (( am == 2 ) ? cpu.r0 : cpu.r1 ) + cpu.addr;
+
+			// ADDR <- Mem[AUX] or ADDR <- AUX
+			if( dataNeeded ) {
+				cpu.addr = cpu.mem[cpu.aux];
+				cpu.cycles += 5;
+			}
+			else {
+				cpu.addr = cpu.aux;
+				cpu.cycles += 4;
+			}
+			break;
+
+		case 4:
+			// ADDR <- imm
+			cpu.addr = di->imm;
+			cpu.immediate = cpu.addr;
+			fast_incr_pc( cpu );
+			cpu.cycles += 3;
+			break;
+
+		case 5:
+			// ADDR <- imm, then optionally ADDR <- Mem[ADDR]
+			cpu.addr = di->imm;
+			cpu.immediate = cpu.addr;
+			fast_incr_pc( cpu );
+			cpu.cycles += 3;
+
+			if( dataNeeded ) {
+				cpu.addr = cpu.mem[cpu.addr];
+				cpu.cycles += 2;
+			}
+			break;
+
+		case 6:
+			// ADDR <- imm, AUX <- PC + imm
+			cpu.addr = di->imm;
+			cpu.immediate = cpu.addr;
+			fast_incr_pc( cpu );
+			cpu.aux = cpu.pc + cpu.addr;
+
+			// pc_relative_am() reads the data from Mem[PC], not Mem[AUX];
+			// the fast engine follows the RTL model exactly.
+			if( dataNeeded ) {
+				cpu.addr = cpu.mem[cpu.pc];
+				cpu.cycles += 6;
+			}
+			else {
+				cpu.addr = cpu.aux;
+				cpu.cycles += 5;
+			}
+			break;
+
+		default:
+			cpu.done = true;
+	}
+}
+
+//
+// fast_trace_record() - fill in what the trace line of an instruction
+// shows, for trace kinds that show an operand: the immediate byte, then
+// the register, branch outcome or stored byte.
+//
+
+static void fast_trace_record( FastCpu &cpu, int trace, unsigned char ra_reg,
+	bool branchTaken ) {
+	TraceRecord &rec = cpu.trace.rec;
+
+	rec.imm = cpu.immediate;
+	cpu.immediate = -1;
+
+	if( trace == TRACE_REG )
+		rec.value = ra_reg;
+	else if( trace == TRACE_BRANCH )
+		rec.taken = branchTaken;
+	else {
+		rec.addr = cpu.addr;
+		rec.value = cpu.aux;
+	}
+}
+
+//
+// Op code routines for the fast engine, indexed by op code; the
+// counterparts of the routines in execute.cpp.  Each one charges the
+// ticks its RTL routine issues and returns true if a branch was taken.
+//
+
+typedef bool (*FastOpRoutine)( FastCpu &cpu, unsigned char &ra, long ra_name,
+	long am );
+
+static bool fast_nop( FastCpu &, unsigned char &, long, long ) {
+	return false;
+}
+
+static bool fast_add( FastCpu &cpu, unsigned char &ra, long, long ) {
+	ra += cpu.addr;
+	cpu.aux = ra;
+	cpu.cycles += 2;
+	return false;
+}
+
+static bool fast_and( FastCpu &cpu, unsigned char &ra, long, long ) {
+	ra &= cpu.addr;
+	cpu.aux = ra;
+	cpu.cycles += 2;
+	return false;
+}
+
+static bool fast_sra( FastCpu &cpu, unsigned char &ra, long, long ) {
+	if( cpu.addr >= 8 )
+		ra = ( ra & 0x80 ) ? 0xff : 0;
+	else
+		ra = (signed char)ra >> cpu.addr;
+	cpu.aux = ra;
+	cpu.cycles += 2;
+	return false;
+}
+
+static bool fast_sll( FastCpu &cpu, unsigned char &ra, long, long ) {
+	ra = ( cpu.addr >= 8 ) ? 0 : ra << cpu.addr;
+	cpu.aux = ra;
+	cpu.cycles += 2;
+	return false;
+}
+
+static bool fast_ldr( FastCpu &cpu, unsigned char &ra, long, long ) {
+	cpu.aux = cpu.mem[cpu.addr];
+	ra = cpu.aux;
+	cpu.cycles += 3;
+	return false;
+}
+
+static bool fast_str( FastCpu &cpu, unsigned char &ra, long, long ) {
+	cpu.aux = ra;
+	cpu.mem[cpu.addr] = cpu.aux;
+	cpu.cycles += 2;
+
+	// The store may have overwritten a predecoded instruction, or one a
+	// block was translated from.
+	decode_cache_invalidate( cpu.dcache, cpu.addr );
+	block_cache_invalidate( cpu.bcache, cpu.addr );
+	return false;
+}
+
+static bool fast_jmp( FastCpu &cpu, unsigned char &, long, long ) {
+	cpu.pc = cpu.addr;
+	cpu.pcOverflow = false;
+	cpu.cycles += 1;
+	return true;
+}
+
+static bool fast_bez( FastCpu &cpu, unsigned char &ra, long, long ) {
+	if( ra == 0 )
+		return fast_jmp( cpu, ra, 0, 0 );
+	return false;
+}
+
+static bool fast_blt( FastCpu &cpu, unsigned char &ra, long, long ) {
+	if( ra & 0x80 )
+		return fast_jmp( cpu, ra, 0, 0 );
+	return false;
+}
+
+static bool fast_clr( FastCpu &cpu, unsigned char &ra, long, long ) {
+	ra = 0;
+	cpu.cycles += 1;
+	return false;
+}
+
+static bool fast_cmp( FastCpu &cpu, unsigned char &ra, long, long ) {
+	ra = ~ra;
+	cpu.aux = ra;
+	cpu.cycles += 2;
+	return false;
+}
+
+static bool fast_inc( FastCpu &cpu, unsigned char &ra, long, long ) {
+	ra++;
+	cpu.cycles += 1;
+	return false;
+}
+
+static bool fast_dmp( FastCpu &cpu, unsigned char &ra, long, long ) {
+	cpu.trace.rec.value = ra;
+	return false;
+}
+
+static bool fast_hlt( FastCpu &cpu, unsigned char &, long, long ) {
+	cpu.done = true;
+	return false;
+}
+
+static const FastOpRoutine fast_op_routines[16] = {
+	fast_nop, fast_add, fast_and, fast_sra, fast_sll, fast_ldr, fast_str,
+	fast_jmp, fast_bez, fast_blt, fast_nop, fast_clr, fast_cmp, fast_inc,
+	fast_dmp, fast_hlt
+};
+
+//
+// fast_instr() - decode and execute instruction byte IR; the fast engine
+// counterpart of rtl_instr().
+//
+
+template<int IR>
+bool fast_instr( FastCpu &cpu, DecodedInstr *di ) {
+	typedef Decode<IR> D;
+	bool branchTaken;
+
+	// Address modes not allowed for the op code.
+	if( D::status == DECODE_INVALID_AM )
+		cpu.done = true;
+
+	// Get the content of addr, if address mode matters for the instruction.
+	if( D::usesAm )
+		fast_decode_am<D::am>( cpu, di, D::dataNeeded );
+
+	unsigned char &ra_reg = ( D::ra == 0 ) ? cpu.r0 : cpu.r1;
+
+	branchTaken = fast_op_routines[D::opc]( cpu, ra_reg, D::ra, D::am );
+
+	// Same trace record as rtl_instr().
+	if( D::trace > TRACE_PLAIN && !cpu.done )
+		fast_trace_record( cpu, D::trace, ra_reg, branchTaken );
+
+	return branchTaken;
+}
+
+#define FAST_INSTANTIATE( n ) \
+	template bool fast_instr<n>( FastCpu &, DecodedInstr * );
+DECODE_EACH( FAST_INSTANTIATE )
+
+//
+// fast_trace() - fill in the trace record fast_instr() fills in for di,
+// with the trace format looked up at run time; for code that executes
+// the instruction some other way (the JIT).
+//
+
+void fast_trace( FastCpu &cpu, const DecodedInstr *di, bool branchTaken ) {
+	int trace = decode_table[di->ir & 0xff].trace;
+	unsigned char ra_reg = ( di->ra == 0 ) ? cpu.r0 : cpu.r1;
+
+	if( trace > TRACE_PLAIN && !cpu.done )
+		fast_trace_record( cpu, trace, ra_reg, branchTaken );
+}
+
+//
+// fast_execute() - decode and execute the instruction in ir, as the RTL
+// model does.
+//
+
+void fast_execute( FastCpu &cpu ) {
+	DecodedInstr *di = decode_cache_lookup( cpu.dcache, cpu.savedPC, cpu.ir,
+		cpu.mem );
+
+	di->fastHandler( cpu, di );
+
+	// the instruction's final tick
+	cpu.cycles += 1;
+}
+
+//
+// fast_step() - fetch and execute one instruction, as one pass of the
+// loop in run_simulation().
+//
+// RTL charge: 2 ticks for the fetch, 1 for the PC increment, plus
+// whatever fast_execute() charges.
+//
+
+void fast_step( FastCpu &cpu ) {
+	// instruction fetch into ir
+	cpu.ir = cpu.mem[cpu.pc];
+	cpu.cycles += 2;
+
+	// check for PC overflow
+	if( cpu.pcOverflow ) {
+		trace_overflow( cpu.trace );
+		cpu.done = true;
+		return;
+	}
+
+	cpu.savedPC = cpu.pc;
+	cpu.savedIR = cpu.ir;
+
+	// bump PC for next instruction
+	fast_incr_pc( cpu );
+	cpu.cycles += 1;
+
+	// decode and execute
+	fast_execute( cpu );
+	cpu.instructions++;
+	trace_retire( cpu.trace, cpu.savedPC, cpu.savedIR, cpu.r0, cpu.r1 );
+}
+
+//
+// fast_block() - execute block b, one micro-op per instruction, with
+// the same trace and tick charges as fast_step().  Stops early if the
+// machine halts or a store invalidates the block.  Returns true if the
+// last instruction executed took a branch.
+//
+// The block ends before PC can wrap around, so only its first fetch
+// can find PC overflowed; run_blocks() checks for that.
+//
+
+static bool fast_block( FastCpu &cpu, Block *b ) {
+	bool branchTaken = false;
+
+	cpu.bcache.runs++;
+
+	for( int i = 0; i < b->count; i++ ) {
+		DecodedInstr *di = &b->op[i];
+
+		// instruction fetch into ir
+		cpu.ir = di->ir;
+		cpu.cycles += 2;
+
+		cpu.savedPC = cpu.pc;
+		cpu.savedIR = cpu.ir;
+
+		// bump PC for next instruction
+		fast_incr_pc( cpu );
+		cpu.cycles += 1;
+
+		// execute, plus the instruction's final tick
+		branchTaken = di->fastHandler( cpu, di );
+		cpu.cycles += 1;
+		cpu.instructions++;
+		trace_retire( cpu.trace, cpu.savedPC, cpu.savedIR, cpu.r0, cpu.r1 );
+
+		if( cpu.done || !b->valid )
+			break;
+	}
+
+	return branchTaken;
+}
+
+//
+// run_limited() - run the program from cpu.pc one fast_step() at a time
+// until the machine halts or has executed cpu.limit instructions, and
+// then halt it.
+//
+
+static void run_limited( FastCpu &cpu ) {
+	while( !cpu.done && cpu.instructions < cpu.limit )
+		fast_step( cpu );
+
+	if( !cpu.done ) {
+		trace_limit( cpu.trace );
+		cpu.done = true;
+	}
+}
+
+//
+// run_blocks() - run the program from cpu.pc as translated basic blocks
+// until the machine halts.
+//
+// Each block records the block it went to on the way out (by whether
+// its last instruction branched), and the next run takes that chain if
+// it still leads to a valid block at the new PC.  Within a block of
+// cpu.limit the rest runs one instruction at a time, so the machine
+// stops on the limit exactly.
+//
+
+static void run_blocks( FastCpu &cpu ) {
+	Block *b = NULL;
+	bool branchTaken = false;
+
+	while( !cpu.done ) {
+		if( cpu.limit > 0 &&
+		    cpu.instructions > cpu.limit - (long)BLOCK_MAX_INSTRS ) {
+			run_limited( cpu );
+			break;
+		}
+
+		if( cpu.pcOverflow ) {
+			// the fetch that finds it
+			cpu.cycles += 2;
+			trace_overflow( cpu.trace );
+			cpu.done = true;
+			break;
+		}
+
+		Block *next = ( b != NULL ) ? b->next[branchTaken] : NULL;
+
+		if( next != NULL && next->valid && next->entry == cpu.pc )
+			cpu.bcache.chained++;
+		else {
+			next = block_cache_lookup( cpu.bcache, cpu.pc, cpu.mem );
+			if( b != NULL && b->valid )
+				b->next[branchTaken] = next;
+		}
+
+		b = next;
+
+		if( use_jit && !b->jitTried ) {
+			b->jitTried = true;
+			b->jit = jit_compile( cpu, b );
+		}
+
+		if( b->jit != NULL ) {
+			cpu.bcache.runs++;
+			branchTaken = b->jit( &cpu );
+		}
+		else
+			branchTaken = fast_block( cpu, b );
+	}
+}
+
+//
+// FETCH() - fast_step() up to the decode cache lookup; the rest of it
+// is spread over the instruction classes of fast_interpret().
+//
+
+#define FETCH() \
+	cpu.ir = cpu.mem[cpu.pc]; \
+	cpu.cycles += 2; \
+	if( cpu.pcOverflow ) \
+		goto overflow; \
+	cpu.savedPC = cpu.pc; \
+	cpu.savedIR = cpu.ir; \
+	fast_incr_pc( cpu ); \
+	cpu.cycles += 1; \
+	di = decode_cache_lookup( cpu.dcache, cpu.savedPC, cpu.ir, cpu.mem ); \
+	cpu.instructions++
+
+//
+// fast_interpret() - run the program from cpu.pc one instruction at a
+// time until the machine halts, with the same dispatch as
+// run_simulation().
+//
+
+static void fast_interpret( FastCpu &cpu ) {
+	DecodedInstr *di;
+
+#ifdef THREADED_DISPATCH
+	static void *const dispatch[16] = INSTR_LABELS;
+
+	NEXT();
+#else
+	for( ;; ) {
+		FETCH();
+
+		switch( instr_class[di->opc] ) {
+#endif
+
+		INSTR( INSTR_PLAIN )
+			di->fastHandler( cpu, di );
+			cpu.cycles += 1;
+			trace_retire( cpu.trace, cpu.savedPC, cpu.savedIR, cpu.r0,
+				cpu.r1 );
+			NEXT();
+
+		INSTR( INSTR_CHECKED )
+			di->fastHandler( cpu, di );
+			cpu.cycles += 1;
+			trace_retire( cpu.trace, cpu.savedPC, cpu.savedIR, cpu.r0,
+				cpu.r1 );
+			if( cpu.done )
+				goto halted;
+			NEXT();
+
+		INSTR( INSTR_HALT )
+			di->fastHandler( cpu, di );
+			cpu.cycles += 1;
+			trace_retire( cpu.trace, cpu.savedPC, cpu.savedIR, cpu.r0,
+				cpu.r1 );
+			goto halted;
+
+#ifndef THREADED_DISPATCH
+		}
+	}
+#endif
+
+overflow:
+	trace_overflow( cpu.trace );
+	cpu.done = true;
+
+halted:
+	return;
+}
+
+//
+// run_counted() - run the program from cpu.pc one fast_step() at a time
+// until the machine halts, adding each instruction's ticks and memory
+// traffic to c, its ticks and where PC went to p, and the instruction to
+// the pipelined timing model pl, whichever of them is not NULL.  The
+// reads and writes are the ones the RTL model makes for the instruction
+// byte; see Decode<IR>.  With a branch predictor bp each branch is
+// predicted first, and a misprediction's cycles charged to it.
+//
+
+static void run_counted( FastCpu &cpu, OpCounts *c, Profile *p,
+	Pipeline *pl, Predictor *bp ) {
+	while( !cpu.done ) {
+		long cycles = cpu.cycles;
+		long instructions = cpu.instructions;
+
+		fast_step( cpu );
+
+		if( cpu.instructions == instructions )
+			continue;
+
+		if( bp != NULL )
+			cpu.cycles += predict_fast( *bp, cpu );
+		if( c != NULL ) {
+			const DecodeEntry &e = decode_table[cpu.savedIR & 0xff];
+
+			op_counts_add( *c, cpu.savedIR, cpu.cycles - cycles, e.reads,
+				e.writes );
+		}
+		if( p != NULL )
+			profile_add( *p, cpu.savedPC, cpu.savedIR, cpu.cycles - cycles,
+				cpu.pc );
+		if( pl != NULL )
+			pipeline_add( *pl, cpu.savedPC, cpu.savedIR, cpu.pc, cpu.addr );
+	}
+}
+
+//
+// fast_finish() - run the machine from its current state until it
+// halts, or stops on cpu.limit: translated basic blocks, or with
+// --no-blocks one instruction at a time.  Prints nothing but the trace.
+//
+
+void fast_finish( FastCpu &cpu ) {
+	if( cpu.done )
+		return;
+
+	if( use_blocks )
+		run_blocks( cpu );
+	else if( cpu.limit > 0 )
+		run_limited( cpu );
+	else
+		fast_interpret( cpu );
+}
+
+//
+// fast_resume() - run the machine from its current state until it
+// halts with fast_finish(), and print the summary.  name is the
+// program's, for the --profile-folded stacks.  With --counts,
+// --counts-csv, --profile, --profile-folded, --pipeline or --predict it
+// steps one instruction at a time instead and counts, profiles, times or
+// predicts them.
+//
+// The summary goes after the trace, or to stdout if the trace is a
+// binary file.
+//
+
+void fast_resume( FastCpu &cpu, const char *name ) {
+	FILE *out = ( cpu.trace.mode == TRACE_BINARY ) ? stdout : cpu.trace.out;
+	long first = cpu.instructions;
+	OpCounts *counts = NULL;
+	Profile *profile = NULL;
+	Pipeline *pipeline = NULL;
+	Predictor *predictor = NULL;
+	double start;
+
+	if( show_counts || counts_file != NULL ) {
+		counts = new OpCounts;
+		op_counts_reset( *counts );
+	}
+
+	if( show_profile || profile_file != NULL ) {
+		profile = new Profile;
+		profile_reset( *profile, cpu.pc );
+	}
+
+	if( show_pipeline ) {
+		pipeline = new Pipeline;
+		pipeline_reset( *pipeline );
+	}
+
+	if( predict_spec != NULL ) {
+		predictor = new Predictor;
+		predictor_reset( *predictor );
+	}
+
+	start = host_seconds();
+
+	if( counts != NULL || profile != NULL || pipeline != NULL ||
+	    predictor != NULL )
+		run_counted( cpu, counts, profile, pipeline, predictor );
+	else
+		fast_finish( cpu );
+
+	trace_end( cpu.trace );
+
+	fprintf( out, "\nFast engine: %ld instructions, simulated time %ld cycles\n",
+		cpu.instructions, cpu.cycles );
+
+	if( show_stats ) {
+		double elapsed = host_seconds() - start;
+		long ran = cpu.instructions - first;
+
+		fprintf( out, "%ld instructions in %.3f s host time (%.0f instructions/sec)\n",
+			ran, elapsed, elapsed > 0 ? ran / elapsed : 0.0 );
+
+		if( use_blocks && counts == NULL && profile == NULL &&
+		    pipeline == NULL && predictor == NULL ) {
+			block_cache_report( out, cpu.bcache, cpu.instructions );
+			if( use_jit )
+				jit_report( out, cpu.jit );
+		}
+		else
+			decode_cache_report( out, cpu.dcache );
+	}
+
+	if( counts != NULL ) {
+		op_counts_done( out, *counts, cpu.cycles );
+		delete counts;
+	}
+
+	if( profile != NULL ) {
+		profile_done( out, *profile, cpu.cycles, name );
+		delete profile;
+	}
+
+	if( pipeline != NULL ) {
+		pipeline_report( out, *pipeline, cpu.cycles );
+		delete pipeline;
+	}
+
+	if( predictor != NULL ) {
+		predictor_report( out, *predictor, cpu.cycles );
+		delete predictor;
+	}
+
+	jit_release( cpu.jit );
+}
+
+//
+// fast_run() - load and run one program on the given machine, whose
+// trace.out must already be set, for up to limit instructions (0 = no
+// limit); the counterpart of run_simulation().  Returns false if the
+// object file could not be loaded.
+//
+
+bool fast_run( FastCpu &cpu, char *objfile, long limit ) {
+	fast_reset( cpu );
+	cpu.limit = limit;
+	if( !fast_load( cpu, objfile ) )
+		return false;
+
+	fast_resume( cpu, objfile );
+
+	return true;
+}
+
+//
+// run_fast() - run one program with the fast engine, writing to stdout,
+// or the trace to the --trace-file or the --flight ring, or folded.
+//
+
+void run_fast( char *objfile ) {
+	FastCpu cpu;
+
+	if( trace_file != NULL && !trace_open_binary( cpu.trace, trace_file ) )
+		exit( 1 );
+	if( flight_size > 0 )
+		trace_open_ring( cpu.trace, flight_size );
+	if( fold_trace )
+		trace_open_fold( cpu.trace );
+
+	if( !fast_run( cpu, objfile, 0 ) )
+		exit( 1 );
+}
@@ -8,21 +8,33 @@
 //
 // Move a word from the specified location in memory to the
 // indicated destination via a particular bus.
+//
+// With --overlap, fetch_overlapped() and fetch_start() do what the note
+// in fetch_into() suggests: the read goes with the caller's next tick,
+// and the next instruction's MAR <- PC with the final tick of the one
+// before it.
+//
+// With a cache configured, a read is looked up in it once MAR holds the
+// address, and a miss stalls for its ticks before the read is made.
+// Reads from PC go to the instruction side.
 
 #include "includes.h"
 
-void fetch_into( StorageObject &addr, Bus &bus, StorageObject &dest ) {
+void fetch_into( CpuContext &cpu, StorageObject &addr, Bus &bus,
+	StorageObject &dest ) {
 
 	// move address into MAR
 
-	bus.IN().pullFrom( addr );
-	m.MAR().latchFrom( bus.OUT() );
-	Clock::tick();
+	transfer( cpu, bus, addr, cpu.m.MAR() );
+	cpu_tick( cpu );
 
-	// read word from memory into destination
+	// read word from memory into destination, after any cache miss
 
-	m.read();
-	dest.latchFrom( m.READ() );
+	if( cpu.cache != NULL )
+		cache_read( cpu, ( &addr == &cpu.pc ) ? CACHE_FETCH : CACHE_DATA );
+
+	memory_read( cpu, dest );
+	cpu.reads++;
 
 	// Note that we don't ahve to do the clock tick here; we could,
 	// instead, just return, and have the next clock tick issued in
@@ -31,6 +43,69 @@ void fetch_into( StorageObject &addr, Bus &bus, StorageObject &dest ) {
 	// actions.  This requires that the next tick be done before we
 	// try to use the contents of 'dest'.
 
-	Clock::tick();
+	cpu_tick( cpu );
+
+	fetch_done( cpu, dest );
+
+}
+
+//
+// fetch_overlapped() - fetch_into(), for a read that the caller's next
+// register transfer does not depend on.  With --overlap the read is left
+// to the caller's next tick, to be done in parallel with that transfer,
+// and the caller must call fetch_done() after that tick and not use dest
+// before it.  If fetch_start() has already moved PC into MAR, addr must
+// be PC, and the first tick is skipped as well.
+//
+
+void fetch_overlapped( CpuContext &cpu, StorageObject &addr, Bus &bus,
+	StorageObject &dest ) {
+
+	// move address into MAR, unless the last tick did
+
+	if( cpu.fetchStarted ) {
+		cpu.fetchStarted = false;
+		cpu.overlapped++;
+	}
+	else {
+		transfer( cpu, bus, addr, cpu.m.MAR() );
+		cpu_tick( cpu );
+	}
+
+	// read word from memory into destination, after any cache miss,
+	// with the next tick if overlapping
+
+	if( cpu.cache != NULL )
+		cache_read( cpu, ( &addr == &cpu.pc ) ? CACHE_FETCH : CACHE_DATA );
+
+	memory_read( cpu, dest );
+	cpu.reads++;
+
+	if( overlap_fetch )
+		cpu.overlapped++;
+	else {
+		cpu_tick( cpu );
+		fetch_done( cpu, dest );
+	}
+}
+
+//
+// fetch_start() - with --overlap, set up MAR <- PC for the next
+// instruction's fetch, to go with this one's final tick, which has
+// nothing else to do.
+//
+
+void fetch_start( CpuContext &cpu ) {
+	transfer( cpu, cpu.abus, cpu.pc, cpu.m.MAR() );
+	cpu.fetchStarted = true;
+}
+
+//
+// fetch_done() - a read into dest has been ticked; with --cosim check it
+// against the shadow of memory.
+//
 
+void fetch_done( CpuContext &cpu, StorageObject &dest ) {
+	if( cpu.cosim != NULL )
+		cosim_read( *cpu.cosim, cpu.m.MAR().value(), dest.value() );
 }
@@ -7,7 +7,8 @@
 //	2000/11/29:	wrc, restructured code
 //	2001/12/10:	wrc, modified simulation control
 //
-// Global variables for the dummest little computer.
+// Global variables for the dummest little computer.  The machine
+// itself is a CpuContext; see cpu_context.h.
 
 #include "includes.h"
 
@@ -18,36 +19,33 @@
 const unsigned int ADDR_BITS( 8 ); // 8-bit address => 256 units of memory
 const unsigned int DATA_BITS( 8 ); // 8-bit unit size (00-FF)
 
-//
-// Buses
-//
-
-Bus abus( "ADDRBUS", ADDR_BITS ); // bus to carry memory addresses
-Bus dbus( "DATABUS", DATA_BITS ); // bus to carry data and instructions
-
-//
-// Registers
-//
-
-StorageObject aux( "AUX", DATA_BITS );		// auxiliary register
-StorageObject ir( "IR", DATA_BITS );        // instruction register
-StorageObject addr( "ADDR", ADDR_BITS );	// address register
-Counter r0( "R0", DATA_BITS );				// R0 register
-Counter r1( "R1", DATA_BITS );				// R1 register
-Counter pc( "PC", ADDR_BITS );              // program counter
-
-// 
-// Other components
-//
-
-Memory m( "Memory", ADDR_BITS, DATA_BITS ); // primary memory
-BusALU alu( "Adder", DATA_BITS );           // arithmetic logic unit
-
 //
 // Runtime control variables
 //
 
-bool done ( false );		// is the simulation over?
-long immediate ( -1 );		// immediate value for address modes that use it
-long savedPC;				// used for printing trace output
-long savedIR;				// used for printing trace output
\ No newline at end of file
+SimMode sim_mode ( MODE_RTL );	// which engine runs the program
+bool show_stats ( false );	// print run statistics at halt?
+bool use_blocks ( true );	// fast engine runs translated basic blocks?
+bool use_jit ( true );		// ... and translates them to host code?
+int batch_threads ( 0 );	// --batch worker threads (0 = one per CPU)
+long lane_limit ( 1000000 );	// --batch/--lanes/--variants instruction limit (0 = none)
+char *trace_file ( NULL );	// binary trace file, or NULL for the text trace
+long flight_size ( 0 );		// --flight ring entries (0 = full trace)
+bool fold_trace ( false );	// --fold: print loops in the trace folded
+bool show_counts ( false );	// --counts: print cycles per op code and mode
+char *counts_file ( NULL );	// --counts-csv file, or NULL
+bool show_profile ( false );	// --profile: print the hot spot report
+char *profile_file ( NULL );	// --profile-folded file, or NULL
+bool show_latency ( false );	// --latency: print host time per instruction
+long cosim_every ( 0 );		// --cosim: compare every Nth instruction (0 = off)
+bool overlap_fetch ( false );	// --overlap: reads go in parallel with the next transfer
+bool show_pipeline ( false );	// --pipeline: print the pipelined timing model's report
+bool compact_ticks ( false );	// --compact: pack each instruction's transfers into fewer ticks
+char *cache_spec ( NULL );	// --cache: unified cache SIZE,WAYS,LINE, or NULL
+char *icache_spec ( NULL );	// --icache: instruction cache, or NULL
+char *dcache_spec ( NULL );	// --dcache: data cache, or NULL
+bool write_through ( false );	// --write-through: caches write every store to memory
+long miss_ticks ( 10 );		// --miss: ticks a cache miss stalls for
+char *predict_spec ( NULL );	// --predict: branch predictor KIND[:BITS], or NULL
+long btb_size ( 0 );		// --btb: branch target buffer entries (0 = none)
+long branch_penalty ( 2 );	// --penalty: cycles a mispredicted branch costs
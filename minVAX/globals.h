@@ -15,21 +15,32 @@
 extern const unsigned int ADDR_BITS; // 8-bit address => 256 units of memory
 extern const unsigned int DATA_BITS; // 8-bit unit size (00-FF)
 
-extern Bus abus; // bus to carry memory addresses
-extern Bus dbus; // bus to carry data and instructions
-
-extern StorageObject aux;   // auxiliary register
-extern StorageObject ir;    // instruction register
-extern StorageObject addr;  // address register
-extern Counter r0;    		// R0 register
-extern Counter r1;		    // R1 register
-extern Counter pc;          // program counter
-extern Memory m;            // primary memory
-extern BusALU alu;          // arithmetic logic unit
-
-extern bool done;	        // is the simulation over?
-extern long immediate;		// immediate value for address modes that use it
-extern long savedPC;		// used for printing trace output
-extern long savedIR;		// used for printing trace output
+enum SimMode { MODE_RTL, MODE_FAST };
+extern SimMode sim_mode;	// which engine runs the program
+extern bool show_stats;		// print run statistics at halt?
+extern bool use_blocks;		// fast engine runs translated basic blocks?
+extern bool use_jit;		// ... and translates them to host code?
+extern int batch_threads;	// --batch worker threads (0 = one per CPU)
+extern long lane_limit;		// --batch/--lanes/--variants instruction limit (0 = none)
+extern char *trace_file;	// binary trace file, or NULL for the text trace
+extern long flight_size;	// --flight ring entries (0 = full trace)
+extern bool fold_trace;		// --fold: print loops in the trace folded
+extern bool show_counts;	// --counts: print cycles per op code and mode
+extern char *counts_file;	// --counts-csv file, or NULL
+extern bool show_profile;	// --profile: print the hot spot report
+extern char *profile_file;	// --profile-folded file, or NULL
+extern bool show_latency;	// --latency: print host time per instruction
+extern long cosim_every;	// --cosim: compare every Nth instruction (0 = off)
+extern bool overlap_fetch;	// --overlap: reads go in parallel with the next transfer
+extern bool show_pipeline;	// --pipeline: print the pipelined timing model's report
+extern bool compact_ticks;	// --compact: pack each instruction's transfers into fewer ticks
+extern char *cache_spec;	// --cache: unified cache SIZE,WAYS,LINE, or NULL
+extern char *icache_spec;	// --icache: instruction cache, or NULL
+extern char *dcache_spec;	// --dcache: data cache, or NULL
+extern bool write_through;	// --write-through: caches write every store to memory
+extern long miss_ticks;		// --miss: ticks a cache miss stalls for
+extern char *predict_spec;	// --predict: branch predictor KIND[:BITS], or NULL
+extern long btb_size;		// --btb: branch target buffer entries (0 = none)
+extern long branch_penalty;	// --penalty: cycles a mispredicted branch costs
 
 #endif
@@ -12,6 +12,8 @@
 
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
+#include <ctime>
 #include <iostream>
 
 // 'arch' library
@@ -28,6 +30,25 @@ using namespace std;
 
 // program-specific includes
 
+#include "decode_table.h"
+#include "dispatch.h"
+#include "decode_cache.h"
+#include "block_cache.h"
+#include "jit.h"
+#include "trace_writer.h"
+#include "latency.h"
+#include "cpu_context.h"
+#include "fast_cpu.h"
+#include "cosim.h"
+#include "lanes.h"
+#include "loader.h"
+#include "snapshot.h"
+#include "op_counts.h"
+#include "profiler.h"
+#include "pipeline.h"
+#include "predictor.h"
+#include "tick_schedule.h"
+#include "mem_cache.h"
 #include "globals.h"
 #include "prototypes.h"
 
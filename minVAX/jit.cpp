@@ -0,0 +1,564 @@
+// jit.C
+//
+// x86-64 translator for minVAX basic blocks.  See jit.h.
+//
+// Generated code for a block (rbx = FastCpu *, r12b = R0, r13b = R1,
+// r14b = PC, r15d = branch taken, eax = ADDR while an instruction runs):
+//
+//     prologue      save rbx, r12-r15; load R0, R1, PC from the FastCpu
+//     per instr     charge the static ticks; set IR, savedPC, savedIR,
+//                   PC and the PC overflow flag; address mode; op code;
+//                   store R0/R1 back and call jit_retire() for the trace
+//     epilogue      store R0, R1, PC back; return r15d
+//
+// Without a trace there is nothing for jit_retire() to do but count the
+// instruction, so the block makes no calls but the one for a store that
+// hits translated code, and adds its instruction count as it leaves.
+//
+// Everything known at translation time (the instruction's address,
+// its immediate byte, PC-relative addresses, tick charges) is folded
+// into constants.
+
+#include "includes.h"
+
+#if defined( __x86_64__ ) && defined( __linux__ )
+
+#include <cstddef>
+#include <sys/mman.h>
+
+//
+// Host code emitters.  Each appends one instruction at p.  rr is the
+// low 3 bits of a host register number (4 = r12, 5 = r13, 6 = r14).
+//
+
+static void emit8( unsigned char *&p, unsigned int b ) {
+	*p++ = (unsigned char)b;
+}
+
+static void emit32( unsigned char *&p, unsigned long v ) {
+	for( int i = 0; i < 4; i++ )
+		emit8( p, v >> ( 8 * i ) );
+}
+
+static void emit64( unsigned char *&p, unsigned long v ) {
+	for( int i = 0; i < 8; i++ )
+		emit8( p, v >> ( 8 * i ) );
+}
+
+// movzx r1Xd, byte [rbx + disp]
+static void emit_load_reg( unsigned char *&p, int rr, long disp ) {
+	emit8( p, 0x44 ); emit8( p, 0x0f ); emit8( p, 0xb6 );
+	emit8( p, 0x83 | ( rr << 3 ) ); emit32( p, disp );
+}
+
+// mov byte [rbx + disp], r1Xb
+static void emit_store_reg( unsigned char *&p, int rr, long disp ) {
+	emit8( p, 0x44 ); emit8( p, 0x88 );
+	emit8( p, 0x83 | ( rr << 3 ) ); emit32( p, disp );
+}
+
+// mov byte [rbx + rax + disp], r1Xb
+static void emit_store_reg_indexed( unsigned char *&p, int rr, long disp ) {
+	emit8( p, 0x44 ); emit8( p, 0x88 );
+	emit8( p, 0x84 | ( rr << 3 ) ); emit8( p, 0x03 ); emit32( p, disp );
+}
+
+// movzx eax, r1Xb
+static void emit_eax_from_reg( unsigned char *&p, int rr ) {
+	emit8( p, 0x41 ); emit8( p, 0x0f ); emit8( p, 0xb6 ); emit8( p, 0xc0 | rr );
+}
+
+// mov eax, imm32
+static void emit_eax_imm( unsigned char *&p, unsigned long v ) {
+	emit8( p, 0xb8 ); emit32( p, v );
+}
+
+// movzx eax, byte [rbx + disp]
+static void emit_eax_load( unsigned char *&p, long disp ) {
+	emit8( p, 0x0f ); emit8( p, 0xb6 ); emit8( p, 0x83 ); emit32( p, disp );
+}
+
+// movzx e(ax|cx), byte [rbx + rax + disp]
+static void emit_load_indexed( unsigned char *&p, int reg, long disp ) {
+	emit8( p, 0x0f ); emit8( p, 0xb6 );
+	emit8( p, 0x84 | ( reg << 3 ) ); emit8( p, 0x03 ); emit32( p, disp );
+}
+
+// mov byte [rbx + disp], (al|cl)
+static void emit_store_low( unsigned char *&p, int reg, long disp ) {
+	emit8( p, 0x88 ); emit8( p, 0x83 | ( reg << 3 ) ); emit32( p, disp );
+}
+
+// mov byte [rbx + disp], imm8
+static void emit_store_byte( unsigned char *&p, long disp, unsigned int v ) {
+	emit8( p, 0xc6 ); emit8( p, 0x83 ); emit32( p, disp ); emit8( p, v );
+}
+
+// mov qword [rbx + disp], simm32
+static void emit_store_qword( unsigned char *&p, long disp, long v ) {
+	emit8( p, 0x48 ); emit8( p, 0xc7 ); emit8( p, 0x83 );
+	emit32( p, disp ); emit32( p, v );
+}
+
+// add qword [rbx + disp], simm32
+static void emit_add_qword( unsigned char *&p, long disp, long v ) {
+	emit8( p, 0x48 ); emit8( p, 0x81 ); emit8( p, 0x83 );
+	emit32( p, disp ); emit32( p, v );
+}
+
+// <op> r1Xb, al   (op: 0x00 add, 0x20 and)
+static void emit_alu_al( unsigned char *&p, int op, int rr ) {
+	emit8( p, 0x41 ); emit8( p, op ); emit8( p, 0xc0 | rr );
+}
+
+// <group> r1Xb   (F6 /2 not, FE /0 inc, D2 /4 shl cl, D2 /7 sar cl)
+static void emit_unary( unsigned char *&p, int op, int ext, int rr ) {
+	emit8( p, 0x41 ); emit8( p, op ); emit8( p, 0xc0 | ( ext << 3 ) | rr );
+}
+
+// xor r1Xd, r1Xd
+static void emit_clear_reg( unsigned char *&p, int rr ) {
+	emit8( p, 0x45 ); emit8( p, 0x31 ); emit8( p, 0xc0 | ( rr << 3 ) | rr );
+}
+
+// jcc rel8 / jmp rel8 with the displacement patched by emit_label()
+static unsigned char *emit_jump8( unsigned char *&p, int op ) {
+	emit8( p, op ); emit8( p, 0 );
+	return p - 1;
+}
+
+static void emit_label( unsigned char *p, unsigned char *at ) {
+	*at = (unsigned char)( p - ( at + 1 ) );
+}
+
+// call fn( rbx, rsi = arg, edx = r15d )
+static void emit_call( unsigned char *&p, const void *fn, const void *arg ) {
+	emit8( p, 0x48 ); emit8( p, 0x89 ); emit8( p, 0xdf );		// mov rdi, rbx
+	emit8( p, 0x48 ); emit8( p, 0xbe ); emit64( p, (unsigned long)arg );
+	emit8( p, 0x44 ); emit8( p, 0x89 ); emit8( p, 0xfa );		// mov edx, r15d
+	emit8( p, 0x48 ); emit8( p, 0xb8 ); emit64( p, (unsigned long)fn );
+	emit8( p, 0xff ); emit8( p, 0xd0 );							// call rax
+}
+
+//
+// Offsets of the FastCpu fields the generated code uses.
+//
+
+#define CPU_OFF( field )	( (long)offsetof( FastCpu, field ) )
+
+static const int RR_R0 = 4;		// r12
+static const int RR_R1 = 5;		// r13
+static const int RR_PC = 6;		// r14
+
+//
+// jit_retire() - finish an instruction run by host code: its trace
+// line, as fast_instr() and fast_block() print it.
+//
+
+static void jit_retire( FastCpu *cpu, const DecodedInstr *di, int branchTaken ) {
+	fast_trace( *cpu, di, branchTaken != 0 );
+	cpu->instructions++;
+	trace_retire( cpu->trace, cpu->savedPC, cpu->savedIR, cpu->r0,
+		cpu->r1 );
+}
+
+//
+// jit_store_hook() - a store hit translated code; invalidate what it
+// overwrote, as fast_str() does.
+//
+
+static void jit_store_hook( FastCpu *cpu, long addr ) {
+	decode_cache_invalidate( cpu->dcache, addr & 0xff );
+	block_cache_invalidate( cpu->bcache, addr & 0xff );
+}
+
+//
+// jit_supported() - can host code run instruction di?
+//
+
+static bool jit_supported( const DecodedInstr *di ) {
+	const DecodeEntry &e = decode_table[di->ir & 0xff];
+
+	return e.status == DECODE_OK && di->opc != 14 && di->opc != 15;
+}
+
+//
+// am_ticks(), op_ticks() - the RTL ticks charged for an address mode
+// and an op code (a taken branch adds 1).  See fast_decode_am().
+//
+
+static long am_ticks( long am, bool dataNeeded ) {
+	switch( am ) {
+		case 0: case 1:	return 1;
+		case 2: case 3:	return dataNeeded ? 5 : 4;
+		case 4:			return 3;
+		case 5:			return dataNeeded ? 5 : 3;
+		default:		return dataNeeded ? 6 : 5;
+	}
+}
+
+static long op_ticks( long opc ) {
+	switch( opc ) {
+		case 1: case 2: case 3: case 4: case 6: case 12:	return 2;
+		case 5:									return 3;
+		case 7: case 11: case 13:				return 1;
+		default:								return 0;
+	}
+}
+
+//
+// emit_instr() - host code for instruction di at address pc in block b,
+// the n'th of the block, with or without the trace line.  Returns where
+// the block's early exit jump (after a store that hit translated code)
+// needs patching, or NULL.
+//
+
+static unsigned char *emit_instr( unsigned char *&p, Block *b,
+	DecodedInstr *di, long pc, int n, bool traced ) {
+
+	long opc = di->opc;
+	long am = di->am;
+	bool usesAm = ( opc > 0 && opc < 10 );
+	bool dataNeeded = ( opc < 5 );
+	int rr = ( di->ra == 0 ) ? RR_R0 : RR_R1;
+	long next = ( pc + di->length ) & 0xff;
+	long imm = di->imm & 0xff;
+	unsigned char *early = NULL;
+	unsigned char *skip, *over;
+
+	// fetch, PC increment, address mode, op code and the final tick; a
+	// taken BEZ/BLT adds its one below
+	emit_add_qword( p, CPU_OFF( cycles ),
+		4 + ( usesAm ? am_ticks( am, dataNeeded ) : 0 ) + op_ticks( opc ) );
+
+	emit_store_byte( p, CPU_OFF( ir ), di->ir );
+	emit_store_qword( p, CPU_OFF( savedPC ), pc );
+	emit_store_qword( p, CPU_OFF( savedIR ), di->ir );
+
+	// PC after the fetch and any immediate byte; it wrapped around if it
+	// is now 0
+	emit8( p, 0x41 ); emit8( p, 0xbe ); emit32( p, next );		// mov r14d, next
+	emit_store_byte( p, CPU_OFF( pcOverflow ), next == 0 );
+
+	if( di->length == 2 )
+		emit_store_qword( p, CPU_OFF( immediate ), imm );
+
+	// address mode: ADDR into eax and the FastCpu
+	if( usesAm ) {
+		switch( am ) {
+			case 0:
+			case 1:
+				emit_eax_from_reg( p, am == 0 ? RR_R0 : RR_R1 );
+				break;
+
+			case 2:
+			case 3:
+				emit_eax_from_reg( p, am == 2 ? RR_R0 : RR_R1 );
+				emit8( p, 0x04 ); emit8( p, imm );		// add al, imm
+				emit_store_low( p, 0, CPU_OFF( aux ) );
+				if( dataNeeded )
+					emit_load_indexed( p, 0, CPU_OFF( mem ) );
+				break;
+
+			case 4:
+				emit_eax_imm( p, imm );
+				break;
+
+			case 5:
+				if( dataNeeded )
+					emit_eax_load( p, CPU_OFF( mem ) + imm );
+				else
+					emit_eax_imm( p, imm );
+				break;
+
+			case 6:
+				// AUX <- PC + imm; the data comes from Mem[PC], as in
+				// pc_relative_am()
+				emit_store_byte( p, CPU_OFF( aux ), ( next + imm ) & 0xff );
+				if( dataNeeded )
+					emit_eax_load( p, CPU_OFF( mem ) + next );
+				else
+					emit_eax_imm( p, ( next + imm ) & 0xff );
+				break;
+		}
+
+		emit_store_low( p, 0, CPU_OFF( addr ) );
+	}
+
+	// op code
+	switch( opc ) {
+		case 1:		// ADD
+		case 2:		// AND
+			emit_alu_al( p, opc == 1 ? 0x00 : 0x20, rr );
+			emit_store_reg( p, rr, CPU_OFF( aux ) );
+			break;
+
+		case 3:		// SRA: shifts of 7 or more leave only the sign
+			emit8( p, 0x89 ); emit8( p, 0xc1 );				// mov ecx, eax
+			emit8( p, 0x80 ); emit8( p, 0xf9 ); emit8( p, 7 );	// cmp cl, 7
+			skip = emit_jump8( p, 0x76 );					// jbe
+			emit8( p, 0xb1 ); emit8( p, 7 );				// mov cl, 7
+			emit_label( p, skip );
+			emit_unary( p, 0xd2, 7, rr );
+			emit_store_reg( p, rr, CPU_OFF( aux ) );
+			break;
+
+		case 4:		// SLL: shifts of 8 or more clear the register
+			emit8( p, 0x89 ); emit8( p, 0xc1 );				// mov ecx, eax
+			emit8( p, 0x80 ); emit8( p, 0xf9 ); emit8( p, 8 );	// cmp cl, 8
+			skip = emit_jump8( p, 0x72 );					// jb
+			emit_clear_reg( p, rr );
+			over = emit_jump8( p, 0xeb );					// jmp
+			emit_label( p, skip );
+			emit_unary( p, 0xd2, 4, rr );
+			emit_label( p, over );
+			emit_store_reg( p, rr, CPU_OFF( aux ) );
+			break;
+
+		case 5:		// LDR
+			emit_load_indexed( p, 1, CPU_OFF( mem ) );
+			emit_store_low( p, 1, CPU_OFF( aux ) );
+			emit8( p, 0x41 ); emit8( p, 0x88 ); emit8( p, 0xc8 | rr );	// mov r1Xb, cl
+			break;
+
+		case 6:		// STR
+			emit_store_reg( p, rr, CPU_OFF( aux ) );
+			emit_store_reg_indexed( p, rr, CPU_OFF( mem ) );
+
+			// cmp byte [rbx + rax + covered], 0
+			emit8( p, 0x80 ); emit8( p, 0xbc ); emit8( p, 0x03 );
+			emit32( p, CPU_OFF( bcache ) + (long)offsetof( BlockCache, covered ) );
+			emit8( p, 0 );
+			skip = emit_jump8( p, 0x74 );					// je
+			emit8( p, 0x89 ); emit8( p, 0xc6 );				// mov esi, eax
+			emit8( p, 0x48 ); emit8( p, 0x89 ); emit8( p, 0xdf );	// mov rdi, rbx
+			emit8( p, 0x48 ); emit8( p, 0xb8 );
+			emit64( p, (unsigned long)&jit_store_hook );
+			emit8( p, 0xff ); emit8( p, 0xd0 );				// call rax
+			emit_label( p, skip );
+			break;
+
+		case 7:		// JMP
+		case 8:		// BEZ
+		case 9:		// BLT
+			skip = NULL;
+			if( opc == 8 ) {
+				emit8( p, 0x45 ); emit8( p, 0x84 );
+				emit8( p, 0xc0 | ( rr << 3 ) | rr );		// test r1Xb, r1Xb
+				skip = emit_jump8( p, 0x75 );				// jnz
+			}
+			else if( opc == 9 ) {
+				emit_unary( p, 0xf6, 0, rr ); emit8( p, 0x80 );	// test r1Xb, 0x80
+				skip = emit_jump8( p, 0x74 );				// jz
+			}
+			if( opc != 7 )
+				emit_add_qword( p, CPU_OFF( cycles ), 1 );
+
+			emit8( p, 0x41 ); emit8( p, 0x89 ); emit8( p, 0xc6 );	// mov r14d, eax
+			emit_store_byte( p, CPU_OFF( pcOverflow ), 0 );
+			emit8( p, 0x41 ); emit8( p, 0xbf ); emit32( p, 1 );	// mov r15d, 1
+
+			if( skip != NULL )
+				emit_label( p, skip );
+			break;
+
+		case 11:	// CLR
+			emit_clear_reg( p, rr );
+			break;
+
+		case 12:	// CMP
+			emit_unary( p, 0xf6, 2, rr );
+			emit_store_reg( p, rr, CPU_OFF( aux ) );
+			break;
+
+		case 13:	// INC
+			emit_unary( p, 0xfe, 0, rr );
+			break;
+	}
+
+	// trace line; without one, only the immediate byte fast_trace()
+	// would have taken
+	if( traced ) {
+		emit_store_reg( p, RR_R0, CPU_OFF( r0 ) );
+		emit_store_reg( p, RR_R1, CPU_OFF( r1 ) );
+		emit_call( p, (const void *)&jit_retire, di );
+	}
+	else if( decode_table[di->ir & 0xff].trace > TRACE_PLAIN )
+		emit_store_qword( p, CPU_OFF( immediate ), -1 );
+
+	// stop if the store invalidated this block:
+	// mov rax, &b->valid; cmp byte [rax], 0; je exit
+	// or, counting the n instructions run, jne skip; add; jmp exit
+	if( opc == 6 ) {
+		emit8( p, 0x48 ); emit8( p, 0xb8 ); emit64( p, (unsigned long)&b->valid );
+		emit8( p, 0x80 ); emit8( p, 0x38 ); emit8( p, 0 );
+		if( traced ) {
+			emit8( p, 0x0f ); emit8( p, 0x84 ); emit32( p, 0 );
+			early = p - 4;
+		}
+		else {
+			skip = emit_jump8( p, 0x75 );
+			emit_add_qword( p, CPU_OFF( instructions ), n );
+			emit8( p, 0xe9 ); emit32( p, 0 );
+			early = p - 4;
+			emit_label( p, skip );
+		}
+	}
+
+	return early;
+}
+
+//
+// jit_flush() - empty the code buffer; every block is translated again
+// the next time it runs.
+//
+
+static void jit_flush( FastCpu &cpu ) {
+	for( unsigned int i = 0; i < BLOCK_CACHE_SIZE; i++ ) {
+		cpu.bcache.block[i].jit = NULL;
+		cpu.bcache.block[i].jitTried = false;
+	}
+
+	cpu.jit.used = 0;
+	cpu.jit.flushes++;
+}
+
+//
+// jit_compile() - translate block b to host code.  Returns NULL if the
+// block has to be interpreted.
+//
+
+JitCode jit_compile( FastCpu &cpu, Block *b ) {
+	JitCache &jc = cpu.jit;
+	unsigned char *exits[BLOCK_MAX_INSTRS];
+	int nexits = 0;
+
+	for( int i = 0; i < b->count; i++ )
+		if( !jit_supported( &b->op[i] ) ) {
+			jc.interpreted++;
+			return NULL;
+		}
+
+	if( jc.code == NULL && !jc.failed ) {
+		void *buf = mmap( NULL, JIT_BUFFER_SIZE,
+			PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS,
+			-1, 0 );
+
+		if( buf == MAP_FAILED ) {
+			cerr << "JIT disabled: cannot map an executable buffer" << endl;
+			jc.failed = true;
+		}
+		else
+			jc.code = (unsigned char *)buf;
+	}
+
+	if( jc.failed ) {
+		jc.interpreted++;
+		return NULL;
+	}
+
+	if( jc.used + JIT_MAX_BLOCK_CODE > JIT_BUFFER_SIZE )
+		jit_flush( cpu );
+
+	unsigned char *start = jc.code + jc.used;
+	unsigned char *p = start;
+
+	// prologue: push rbx, r12-r15; mov rbx, rdi
+	emit8( p, 0x53 );
+	emit8( p, 0x41 ); emit8( p, 0x54 );
+	emit8( p, 0x41 ); emit8( p, 0x55 );
+	emit8( p, 0x41 ); emit8( p, 0x56 );
+	emit8( p, 0x41 ); emit8( p, 0x57 );
+	emit8( p, 0x48 ); emit8( p, 0x89 ); emit8( p, 0xfb );
+	emit_load_reg( p, RR_R0, CPU_OFF( r0 ) );
+	emit_load_reg( p, RR_R1, CPU_OFF( r1 ) );
+	emit_load_reg( p, RR_PC, CPU_OFF( pc ) );
+	emit8( p, 0x45 ); emit8( p, 0x31 ); emit8( p, 0xff );	// xor r15d, r15d
+
+	long pc = b->entry;
+	bool traced = ( cpu.trace.mode != TRACE_OFF );
+
+	for( int i = 0; i < b->count; i++ ) {
+		unsigned char *early = emit_instr( p, b, &b->op[i], pc, i + 1,
+			traced );
+
+		if( early != NULL )
+			exits[nexits++] = early;
+		pc = ( pc + b->op[i].length ) & 0xff;
+	}
+
+	if( !traced )
+		emit_add_qword( p, CPU_OFF( instructions ), b->count );
+
+	// epilogue: store R0, R1, PC back; return r15d
+	for( int i = 0; i < nexits; i++ ) {
+		int rel = p - ( exits[i] + 4 );
+
+		memcpy( exits[i], &rel, 4 );
+	}
+
+	emit_store_reg( p, RR_R0, CPU_OFF( r0 ) );
+	emit_store_reg( p, RR_R1, CPU_OFF( r1 ) );
+	emit_store_reg( p, RR_PC, CPU_OFF( pc ) );
+	emit8( p, 0x44 ); emit8( p, 0x89 ); emit8( p, 0xf8 );	// mov eax, r15d
+	emit8( p, 0x41 ); emit8( p, 0x5f );
+	emit8( p, 0x41 ); emit8( p, 0x5e );
+	emit8( p, 0x41 ); emit8( p, 0x5d );
+	emit8( p, 0x41 ); emit8( p, 0x5c );
+	emit8( p, 0x5b );
+	emit8( p, 0xc3 );
+
+	jc.used += p - start;
+	jc.compiled++;
+
+	return (JitCode)start;
+}
+
+//
+// jit_release() - give the code buffer back.
+//
+
+void jit_release( JitCache &jc ) {
+	if( jc.code != NULL )
+		munmap( jc.code, JIT_BUFFER_SIZE );
+	jc.code = NULL;
+	jc.used = 0;
+}
+
+#else
+
+//
+// No translator for this host: every block is interpreted.
+//
+
+JitCode jit_compile( FastCpu &cpu, Block * ) {
+	cpu.jit.interpreted++;
+	return NULL;
+}
+
+void jit_release( JitCache & ) {
+}
+
+#endif
+
+//
+// jit_reset() - empty translator state, no buffer yet.
+//
+
+void jit_reset( JitCache &jc ) {
+	jc.code = NULL;
+	jc.used = 0;
+	jc.failed = false;
+	jc.compiled = 0;
+	jc.interpreted = 0;
+	jc.flushes = 0;
+}
+
+//
+// jit_report() - print the translator statistics on out.
+//
+
+void jit_report( FILE *out, JitCache &jc ) {
+	fprintf( out, "JIT: %ld blocks compiled, %ld interpreted, %lu code bytes, "
+		"%ld flushes\n", jc.compiled, jc.interpreted, jc.used, jc.flushes );
+}
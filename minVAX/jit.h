@@ -0,0 +1,39 @@
+// jit.h
+//
+// x86-64 translator for minVAX basic blocks (fast engine).
+//
+// jit_compile() turns a translated Block into host code in an mmap'd
+// executable buffer.  R0, R1 and PC live in host registers (r12, r13,
+// r14) for the whole block and are updated with 8-bit operations, so
+// they wrap around at 0xff just like the Counter registers.  Every
+// instruction still charges its RTL ticks, and prints its trace line by
+// calling back into the fast engine; with the trace off a block makes no
+// calls, and counts its instructions once as it leaves.  A machine's
+// trace mode does not change while it runs, so a block is translated
+// for the mode it is first run in.
+//
+// Blocks containing DMP, HLT or an instruction with an invalid or
+// unknown address mode are left to the interpreter, as are stores that
+// hit translated code: the store itself is done in host code, but the
+// invalidation goes through block_cache_invalidate() and the block
+// stops if it was hit.
+//
+// Only built for x86-64 Linux; elsewhere jit_compile() always returns
+// NULL and every block is interpreted.
+
+#ifndef _JIT_H
+#define _JIT_H
+
+const unsigned long JIT_BUFFER_SIZE( 1024 * 1024 );	// bytes of host code
+const unsigned long JIT_MAX_BLOCK_CODE( 4096 );		// most one block can use
+
+struct JitCache {
+	unsigned char *code;	// executable buffer, NULL until first used
+	unsigned long used;		// bytes of it filled
+	bool failed;			// could not get a buffer; interpret everything
+	long compiled;			// blocks translated to host code
+	long interpreted;		// blocks left to the interpreter
+	long flushes;			// times the buffer filled up and was emptied
+};
+
+#endif
@@ -0,0 +1,398 @@
+// lanes.C
+//
+// Lockstep engine (--lanes list-file): runs the listed object files in
+// groups of LANES machines, one per byte lane of a LaneGroup; see
+// lanes.h.  Meant for fuzzing and for sweeps that run one program over
+// many initial memory images, where only the final state matters, so it
+// prints one result line per program instead of a trace.
+//
+// Each issue picks the lowest PC among the running lanes and executes
+// the instruction there for every lane at that PC holding the same
+// instruction byte (and PC overflow state).  Lanes that diverge wait
+// until the lowest PC reaches them again; min-PC issue lets loops and
+// if/else arms reconverge.  Within a group everything that depends only
+// on the PC is shared: the instruction fetch and the immediate byte are
+// one row of lane memory, and the tick charge is one constant.  Only
+// loads and stores through per-lane addresses touch the lanes one at a
+// time.
+//
+// Tick charges, halts and results are those of fast_step().
+
+#include "includes.h"
+
+// lane_gather() and the like return LaneVecs by value, but they are
+// static, so the AVX calling convention warning is moot in this file too.
+#if defined( SIMD_LANES )
+#pragma GCC diagnostic ignored "-Wpsabi"
+#endif
+
+static const char *const lane_halt_names[] = {
+	"running", "halt instruction", "invalid address mode",
+	"unknown address mode", "PC overflow", "instruction limit"
+};
+
+//
+// lane_gather() - Mem[a] of every lane.
+//
+
+static LaneVec lane_gather( LaneGroup &g, const LaneVec &a ) {
+	LaneVec r;
+
+	for( int l = 0; l < LANES; l++ )
+		r[l] = g.mem[a[l]][l];
+	return r;
+}
+
+//
+// lane_charge() - add ticks to the cycle count of the lanes set in m.
+//
+
+static void lane_charge( LaneGroup &g, const LaneVec &m, long ticks ) {
+	for( int l = 0; l < LANES; l++ )
+		if( m[l] )
+			g.cycles[l] += ticks;
+}
+
+//
+// lane_stop() - halt the lanes set in m for the given reason.
+//
+
+static void lane_stop( LaneGroup &g, const LaneVec &m, LaneHalt why ) {
+	for( int l = 0; l < LANES; l++ )
+		if( m[l] )
+			g.halt[l] = why;
+	g.active = g.active & ~m;
+}
+
+//
+// lane_incr_pc() - PC <- PC + 1 for the lanes set in m, which are all at
+// PC p, recording overflow like Counter::incr().
+//
+
+static void lane_incr_pc( LaneGroup &g, const LaneVec &m, unsigned char p ) {
+	unsigned char next = p + 1;
+
+	g.pc = lane_sel( m, lane_splat( next ), g.pc );
+	g.overflow = lane_sel( m, lane_splat( next == 0 ? 0xff : 0 ), g.overflow );
+}
+
+//
+// lane_issue() - execute instruction byte ir, at PC p, for the lanes set
+// in m.
+//
+
+static void lane_issue( LaneGroup &g, const LaneVec &m, unsigned char p,
+	unsigned char ir ) {
+	const DecodeEntry &e = decode_table[ir];
+	bool usesAm = ( e.opc > 0 && e.opc < 10 );
+	bool dataNeeded = ( e.opc < 5 );
+	LaneVec &ra = ( e.ra == 0 ) ? g.r0 : g.r1;
+	LaneVec &rn = ( e.am == 0 || e.am == 2 ) ? g.r0 : g.r1;	// for am 0-3
+	LaneVec imm = g.mem[(unsigned char)( p + 1 )];
+	LaneVec taken = lane_splat( 0 );
+	LaneVec v;
+	long ticks = 2 + 1 + 1;		// fetch, PC increment, final tick
+
+	lane_incr_pc( g, m, p );
+
+	// Address mode, as fast_decode_am().
+	if( usesAm ) {
+		switch( e.am ) {
+			case 0:
+			case 1:
+				g.addr = lane_sel( m, rn, g.addr );
+				ticks += 1;
+				break;
+
+			case 2:
+			case 3:
+				lane_incr_pc( g, m, p + 1 );
+				g.aux = lane_sel( m, rn + imm, g.aux );
+				if( dataNeeded ) {
+					g.addr = lane_sel( m, lane_gather( g, g.aux ), g.addr );
+					ticks += 5;
+				}
+				else {
+					g.addr = lane_sel( m, g.aux, g.addr );
+					ticks += 4;
+				}
+				break;
+
+			case 4:
+				g.addr = lane_sel( m, imm, g.addr );
+				lane_incr_pc( g, m, p + 1 );
+				ticks += 3;
+				break;
+
+			case 5:
+				g.addr = lane_sel( m, imm, g.addr );
+				lane_incr_pc( g, m, p + 1 );
+				ticks += 3;
+				if( dataNeeded ) {
+					g.addr = lane_sel( m, lane_gather( g, g.addr ), g.addr );
+					ticks += 2;
+				}
+				break;
+
+			case 6:
+				lane_incr_pc( g, m, p + 1 );
+				g.aux = lane_sel( m, lane_splat( p + 2 ) + imm, g.aux );
+
+				// Mem[PC], as pc_relative_am() reads it.
+				if( dataNeeded ) {
+					g.addr = lane_sel( m, g.mem[(unsigned char)( p + 2 )],
+						g.addr );
+					ticks += 6;
+				}
+				else {
+					g.addr = lane_sel( m, g.aux, g.addr );
+					ticks += 5;
+				}
+				break;
+		}
+	}
+
+	// Op code, as the fast_op_routines.
+	switch( e.opc ) {
+		case 1:
+			ra = lane_sel( m, ra + g.addr, ra );
+			g.aux = lane_sel( m, ra, g.aux );
+			ticks += 2;
+			break;
+
+		case 2:
+			ra = lane_sel( m, ra & g.addr, ra );
+			g.aux = lane_sel( m, ra, g.aux );
+			ticks += 2;
+			break;
+
+		case 3:
+		case 4:
+			// Shift counts differ by lane; byte shifts have no vector form.
+			for( int l = 0; l < LANES; l++ ) {
+				unsigned char r = ra[l], n = g.addr[l];
+
+				if( e.opc == 3 )
+					v[l] = ( n >= 8 ) ? (( r & 0x80 ) ? 0xff : 0 )
+						: (unsigned char)( (signed char)r >> n );
+				else
+					v[l] = ( n >= 8 ) ? 0 : (unsigned char)( r << n );
+			}
+			ra = lane_sel( m, v, ra );
+			g.aux = lane_sel( m, ra, g.aux );
+			ticks += 2;
+			break;
+
+		case 5:
+			g.aux = lane_sel( m, lane_gather( g, g.addr ), g.aux );
+			ra = lane_sel( m, g.aux, ra );
+			ticks += 3;
+			break;
+
+		case 6:
+			g.aux = lane_sel( m, ra, g.aux );
+			for( int l = 0; l < LANES; l++ )
+				if( m[l] )
+					g.mem[g.addr[l]][l] = ra[l];
+			ticks += 2;
+			break;
+
+		case 7:
+			taken = m;
+			break;
+
+		case 8:
+			taken = m & lane_eq( ra, lane_splat( 0 ) );
+			break;
+
+		case 9:
+			taken = m & ~lane_eq( ra & lane_splat( 0x80 ), lane_splat( 0 ) );
+			break;
+
+		case 11:
+			ra = lane_sel( m, lane_splat( 0 ), ra );
+			ticks += 1;
+			break;
+
+		case 12:
+			ra = lane_sel( m, ~ra, ra );
+			g.aux = lane_sel( m, ra, g.aux );
+			ticks += 2;
+			break;
+
+		case 13:
+			ra = lane_sel( m, ra + lane_splat( 1 ), ra );
+			ticks += 1;
+			break;
+	}
+
+	// Branches taken: PC <- ADDR, 1 tick.
+	g.pc = lane_sel( taken, g.addr, g.pc );
+	g.overflow = g.overflow & ~taken;
+
+	for( int l = 0; l < LANES; l++ )
+		if( m[l] ) {
+			g.cycles[l] += ticks + ( taken[l] & 1 );
+			g.instructions[l]++;
+		}
+	g.issues++;
+
+	if( e.status == DECODE_INVALID_AM )
+		lane_stop( g, m, LANE_INVALID_AM );
+	else if( e.status == DECODE_UNKNOWN_AM )
+		lane_stop( g, m, LANE_UNKNOWN_AM );
+	else if( e.opc == 15 )
+		lane_stop( g, m, LANE_HALT );
+
+	// No lane can have run more instructions than there were issues.
+	if( lane_limit > 0 && g.issues >= lane_limit ) {
+		for( int l = 0; l < LANES; l++ )
+			v[l] = ( g.instructions[l] >= lane_limit ) ? 0xff : 0;
+		lane_stop( g, g.active & v, LANE_LIMIT );
+	}
+}
+
+//
+// lane_run() - run every lane of g until it halts.
+//
+
+static void lane_run( LaneGroup &g ) {
+	for( ;; ) {
+		unsigned int low = LANE_MEM_SIZE;
+		int lead = 0;
+
+		// the lowest PC of the running lanes; halted lanes count as 256
+		for( int l = 0; l < LANES; l++ ) {
+			unsigned int key = g.active[l] ? g.pc[l] : LANE_MEM_SIZE;
+
+			low = ( key < low ) ? key : low;
+		}
+		if( low == LANE_MEM_SIZE )
+			break;
+
+		unsigned char p = low;
+		LaneVec m = g.active & lane_eq( g.pc, lane_splat( p ) );
+
+		// the first lane there leads this issue
+		while( !m[lead] )
+			lead++;
+		m = m & lane_eq( g.overflow, lane_splat( g.overflow[lead] ) );
+
+		// instruction fetch (2 ticks), then the PC overflow check
+		if( g.overflow[lead] ) {
+			lane_charge( g, m, 2 );
+			lane_stop( g, m, LANE_PC_OVERFLOW );
+			continue;
+		}
+
+		unsigned char ir = g.mem[p][lead];
+
+		lane_issue( g, m & lane_eq( g.mem[p], lane_splat( ir ) ), p, ir );
+	}
+}
+
+//
+// lane_setup() - power-on state for lanes 0 .. count - 1, loaded from
+// the given object files; the other lanes stay halted.  Returns the
+// number of files that could not be loaded, whose lanes are halted too.
+//
+
+static int lane_setup( LaneGroup &g, char **objfile, int count ) {
+	int failed = 0;
+
+	g.r0 = g.r1 = g.pc = g.aux = g.addr = lane_splat( 0 );
+	g.overflow = g.active = lane_splat( 0 );
+	for( unsigned int a = 0; a < LANE_MEM_SIZE; a++ )
+		g.mem[a] = lane_splat( 0 );
+	g.lanes = count;
+
+	for( int l = 0; l < LANES; l++ ) {
+		unsigned char mem[LANE_MEM_SIZE];
+		long entry;
+
+		g.halt[l] = LANE_RUNNING;
+		g.cycles[l] = 0;
+		g.instructions[l] = 0;
+
+		if( l >= count )
+			continue;
+
+		for( unsigned int a = 0; a < LANE_MEM_SIZE; a++ )
+			mem[a] = 0;
+		if( !load_object( objfile[l], mem, entry ) ) {
+			failed++;
+			continue;
+		}
+
+		for( unsigned int a = 0; a < LANE_MEM_SIZE; a++ )
+			g.mem[a][l] = mem[a];
+		g.pc[l] = entry;
+		g.active[l] = 0xff;
+		g.cycles[l] = 2;		// entry point into PC
+	}
+
+	return failed;
+}
+
+//
+// run_lanes() - run every program in the list file (the format --batch
+// reads) on the lockstep engine, LANES at a time, and print one line
+// per program in list order.  Returns the number of programs that could
+// not be loaded.
+//
+
+int run_lanes( char *listfile ) {
+	LaneGroup g;
+	char **objfile;
+	long jobs, instructions = 0, issues = 0;
+	int failed = 0;
+	double start, elapsed = 0;
+
+	jobs = read_list( listfile, objfile );
+
+	for( long first = 0; first < jobs; first += LANES ) {
+		int count = ( jobs - first < LANES ) ? jobs - first : LANES;
+		int bad = lane_setup( g, objfile + first, count );
+
+		g.issues = 0;
+		start = host_seconds();
+		lane_run( g );
+		elapsed += host_seconds() - start;
+		issues += g.issues;
+
+		for( int l = 0; l < count; l++ ) {
+			if( g.halt[l] == LANE_RUNNING ) {
+				printf( "%s: cannot load\n", objfile[first + l] );
+				continue;
+			}
+
+			printf( "%s: %ld instructions, simulated time %ld cycles, "
+				"R0=%02x R1=%02x PC=%02x, %s\n", objfile[first + l],
+				g.instructions[l], g.cycles[l], g.r0[l], g.r1[l], g.pc[l],
+				lane_halt_names[g.halt[l]] );
+			instructions += g.instructions[l];
+		}
+		failed += bad;
+	}
+
+	if( show_stats ) {
+		fflush( stdout );
+		fprintf( stderr, "Lanes: %ld programs, %d lanes (%s), %ld issues, "
+			"%.1f lanes/issue\n", jobs, LANES,
+#ifdef SIMD_LANES
+			"vector",
+#else
+			"scalar",
+#endif
+			issues, issues ? (double)instructions / issues : 0.0 );
+		fprintf( stderr, "%ld instructions in %.3f s host time "
+			"(%.0f instructions/sec)\n", instructions, elapsed,
+			elapsed > 0 ? instructions / elapsed : 0.0 );
+	}
+
+	for( long i = 0; i < jobs; i++ )
+		free( objfile[i] );
+	delete [] objfile;
+
+	return failed;
+}
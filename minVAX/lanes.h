@@ -0,0 +1,143 @@
+// lanes.h
+//
+// Lockstep ("lanes") engine for minVAX: LANES independent machines kept
+// in structure-of-arrays form, one byte lane per machine, so that one
+// instruction is executed for every machine that is about to run it
+// with a single vector operation per register.
+//
+// With GCC, LaneVec is a native vector of LANES bytes, one host vector
+// register wide: 64 lanes with -mavx512bw, 32 with -mavx2, 16 (SSE2)
+// otherwise; -DLANES=n overrides it.  Other compilers, or -DNO_SIMD_LANES,
+// get a plain array with element-by-element operators.
+
+#ifndef _LANES_H
+#define _LANES_H
+
+#ifndef LANES
+#if defined( __AVX512BW__ )
+#define LANES	64
+#elif defined( __AVX2__ )
+#define LANES	32
+#else
+#define LANES	16
+#endif
+#endif
+
+const unsigned int LANE_MEM_SIZE( 256 );	// 8-bit address => 256 bytes
+
+#if defined( __GNUC__ ) && !defined( NO_SIMD_LANES )
+
+#define SIMD_LANES
+
+// The helpers down to lane_sel() return LaneVecs by value.  They are all
+// inline, so the AVX calling convention warning for builds without -mavx
+// is moot; it is turned off for them alone.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpsabi"
+
+typedef unsigned char LaneVec __attribute__(( vector_size( LANES ) ));
+
+inline LaneVec lane_eq( const LaneVec &a, const LaneVec &b ) {
+	return (LaneVec)( a == b );
+}
+
+#else
+
+struct LaneVec {
+	unsigned char b[LANES];
+
+	unsigned char &operator[]( int l ) { return b[l]; }
+	unsigned char operator[]( int l ) const { return b[l]; }
+};
+
+inline LaneVec operator+( const LaneVec &x, const LaneVec &y ) {
+	LaneVec r;
+	for( int l = 0; l < LANES; l++ )
+		r.b[l] = x.b[l] + y.b[l];
+	return r;
+}
+
+inline LaneVec operator&( const LaneVec &x, const LaneVec &y ) {
+	LaneVec r;
+	for( int l = 0; l < LANES; l++ )
+		r.b[l] = x.b[l] & y.b[l];
+	return r;
+}
+
+inline LaneVec operator|( const LaneVec &x, const LaneVec &y ) {
+	LaneVec r;
+	for( int l = 0; l < LANES; l++ )
+		r.b[l] = x.b[l] | y.b[l];
+	return r;
+}
+
+inline LaneVec operator~( const LaneVec &x ) {
+	LaneVec r;
+	for( int l = 0; l < LANES; l++ )
+		r.b[l] = ~x.b[l];
+	return r;
+}
+
+inline LaneVec lane_eq( const LaneVec &a, const LaneVec &b ) {
+	LaneVec r;
+	for( int l = 0; l < LANES; l++ )
+		r.b[l] = ( a.b[l] == b.b[l] ) ? 0xff : 0;
+	return r;
+}
+
+#endif
+
+//
+// lane_splat() - x in every lane.
+//
+
+inline LaneVec lane_splat( unsigned char x ) {
+	LaneVec r;
+	for( int l = 0; l < LANES; l++ )
+		r[l] = x;
+	return r;
+}
+
+//
+// lane_sel() - a in the lanes set in mask m, b in the others.
+//
+
+inline LaneVec lane_sel( const LaneVec &m, const LaneVec &a,
+	const LaneVec &b ) {
+	return ( a & m ) | ( b & ~m );
+}
+
+#if defined( SIMD_LANES )
+#pragma GCC diagnostic pop
+#endif
+
+// Why a lane stopped.
+enum LaneHalt {
+	LANE_RUNNING,
+	LANE_HALT,			// HLT instruction
+	LANE_INVALID_AM,	// address mode not allowed for the op code
+	LANE_UNKNOWN_AM,	// address mode 7
+	LANE_PC_OVERFLOW,	// PC wrapped around
+	LANE_LIMIT			// ran --limit instructions
+};
+
+struct LaneGroup {
+	LaneVec r0;				// R0 register of each lane
+	LaneVec r1;				// R1 register
+	LaneVec pc;				// program counter
+	LaneVec aux;			// auxiliary register
+	LaneVec addr;			// address register
+	LaneVec overflow;		// 0xff if the last PC increment wrapped around
+	LaneVec active;			// 0xff while the lane's machine runs
+
+	LaneVec mem[LANE_MEM_SIZE];	// mem[a][l] is byte a of lane l's memory
+
+	unsigned char halt[LANES];	// LaneHalt of each lane
+	long cycles[LANES];			// RTL clock ticks each lane would have taken
+	long instructions[LANES];	// instructions each lane executed
+
+	int lanes;				// lanes in use
+	long issues;			// instructions issued, one per group of lanes
+};
+
+#endif
@@ -0,0 +1,115 @@
+// latency.C
+//
+// --latency: the host time histograms and their percentile report.  See
+// latency.h.
+
+#include "includes.h"
+
+//
+// latency_reset() - nothing recorded yet; measure what a clock read
+// costs, for the report.
+//
+
+void latency_reset( LatencyStats &l ) {
+	memset( &l, 0, sizeof( l ) );
+
+	l.overhead = -1;
+	for( int i = 0; i < 1000; i++ ) {
+		long t = latency_now();
+		long gap = latency_now() - t;
+
+		if( l.overhead < 0 || gap < l.overhead )
+			l.overhead = gap;
+	}
+}
+
+//
+// latency_value() - the highest value that falls in bucket b, in ns.
+//
+
+static long latency_value( int b ) {
+	int half = b >> LATENCY_SUB_BITS;
+	long sub = b & ( ( 1 << LATENCY_SUB_BITS ) - 1 );
+
+	if( half == 0 )
+		return sub;
+	return ( ( ( 1L << LATENCY_SUB_BITS ) + sub + 1 ) << ( half - 1 ) ) - 1;
+}
+
+//
+// latency_percentile() - the value q (0 to 1) of the way up h, in ns:
+// the top of the bucket the q * count'th value fell in, or the largest
+// value recorded if that is lower.
+//
+
+static long latency_percentile( const LatencyHistogram &h, double q ) {
+	long rank = (long)( q * h.count + 0.999999 );
+	long seen = 0;
+
+	if( rank < 1 )
+		rank = 1;
+
+	for( int b = 0; b < LATENCY_BUCKETS; b++ ) {
+		seen += h.bucket[b];
+		if( seen >= rank ) {
+			long v = latency_value( b );
+
+			return ( v < h.max ) ? v : h.max;
+		}
+	}
+
+	return h.max;
+}
+
+//
+// latency_row() - one line of the report, if anything was recorded.
+//
+
+static void latency_row( FILE *out, const char *name,
+	const LatencyHistogram &h ) {
+	if( h.count == 0 )
+		return;
+
+	fprintf( out, "  %-16s %12ld %9.0f %9ld %9ld %9ld %9ld\n", name, h.count,
+		h.sum / h.count, latency_percentile( h, 0.5 ),
+		latency_percentile( h, 0.99 ), latency_percentile( h, 0.999 ), h.max );
+}
+
+//
+// latency_head() - the title and column headings of a table.
+//
+
+static void latency_head( FILE *out, const char *title ) {
+	fprintf( out, "\n%s:\n  %-16s %12s %9s %9s %9s %9s %9s\n", title, "",
+		"count", "mean", "p50", "p99", "p99.9", "max" );
+}
+
+//
+// latency_report() - print the histograms as percentiles, in ns: whole
+// instructions and op code routines by op code, the fetch, and address
+// mode routines by address mode.
+//
+
+void latency_report( FILE *out, const LatencyStats &l ) {
+	char name[32];
+
+	fprintf( out, "\nHost time in ns (a clock read costs about %ld ns, not "
+		"subtracted)\n", l.overhead );
+
+	latency_head( out, "Host time per instruction" );
+	for( int opc = 0; opc < 16; opc++ ) {
+		sprintf( name, "%x %s", opc, op_mnemonics[opc] );
+		latency_row( out, name, l.instr[opc] );
+	}
+
+	latency_head( out, "Host time per stage" );
+	latency_row( out, "fetch", l.fetch );
+	for( int am = 0; am < 8; am++ ) {
+		sprintf( name, "am %s", am_names[am] );
+		latency_row( out, name, l.am[am] );
+	}
+	for( int opc = 0; opc < 16; opc++ ) {
+		sprintf( name, "op %x %s", opc, op_mnemonics[opc] );
+		latency_row( out, name, l.op[opc] );
+	}
+}
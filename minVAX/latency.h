@@ -0,0 +1,124 @@
+// latency.h
+//
+// Host time per instruction for --latency: how long the RTL model, and
+// so the arch library under it, takes on the host to run each kind of
+// instruction.  Unlike the simulated cycles of --counts, this is what
+// speeding up fetch_into(), the ALU transfers or store_to_mem() would
+// save.
+//
+// Each instruction is timed in three stages, each into its own
+// histogram: the fetch (FETCH() in run_simulation.cpp), the address mode
+// routine (decode_am(), by address mode), and the op code routine with
+// the instruction's final tick (by op code).  The three add up to the
+// instruction's time, kept by op code as well.  The trace, counts and
+// profile bookkeeping between the stages is not timed.
+//
+// The histograms are log-linear, like HdrHistogram's: values below
+// 2^LATENCY_SUB_BITS nanoseconds get a bucket each, and every power of
+// two above that is split into 2^LATENCY_SUB_BITS equal buckets, so a
+// percentile read back is within about 3% of the true value, however
+// wide the spread.
+
+#ifndef _LATENCY_H
+#define _LATENCY_H
+
+const int LATENCY_SUB_BITS( 5 );	// 32 buckets per power of two
+const int LATENCY_MAX_BITS( 40 );	// up to 2^40 ns (about 18 minutes)
+const int LATENCY_BUCKETS(
+	( LATENCY_MAX_BITS - LATENCY_SUB_BITS + 2 ) << LATENCY_SUB_BITS );
+
+struct LatencyHistogram {
+	long count;					// values recorded
+	long max;					// largest of them, ns
+	double sum;					// their total, ns
+	long bucket[LATENCY_BUCKETS];
+};
+
+struct LatencyStats {
+	LatencyHistogram fetch;		// FETCH()
+	LatencyHistogram am[8];		// decode_am(), by address mode
+	LatencyHistogram op[16];	// op code routine and final tick, by op code
+	LatencyHistogram instr[16];	// all three stages, by op code
+
+	long overhead;				// shortest gap between two clock reads, ns
+	long mark;					// when the current stage began, ns
+	long spent;					// time in the stages so far, ns
+};
+
+//
+// latency_now() - the monotonic host clock, in nanoseconds.
+//
+
+inline long latency_now() {
+	struct timespec ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return ts.tv_sec * 1000000000L + ts.tv_nsec;
+}
+
+//
+// latency_bucket() - the histogram bucket for ns nanoseconds.
+//
+
+inline int latency_bucket( long ns ) {
+	int msb = 0;
+
+	if( ns < ( 1L << LATENCY_SUB_BITS ) )
+		return ns < 0 ? 0 : ns;
+	if( ns >= ( 1L << ( LATENCY_MAX_BITS + 1 ) ) )
+		return LATENCY_BUCKETS - 1;
+
+	for( long v = ns; v > 1; v >>= 1 )
+		msb++;
+
+	int shift = msb - LATENCY_SUB_BITS;
+
+	return ( ( shift + 1 ) << LATENCY_SUB_BITS ) |
+		( ( ns >> shift ) & ( ( 1 << LATENCY_SUB_BITS ) - 1 ) );
+}
+
+//
+// latency_add() - record one value in h.
+//
+
+inline void latency_add( LatencyHistogram &h, long ns ) {
+	h.count++;
+	h.sum += ns;
+	if( ns > h.max )
+		h.max = ns;
+	h.bucket[latency_bucket( ns )]++;
+}
+
+//
+// latency_begin() - an instruction's fetch starts now.
+//
+
+inline void latency_begin( LatencyStats &l ) {
+	l.spent = 0;
+	l.mark = latency_now();
+}
+
+//
+// latency_end() - the current stage is over: record its time in h, and
+// start the next one.
+//
+
+inline void latency_end( LatencyStats &l, LatencyHistogram &h ) {
+	long ns = latency_now() - l.mark;
+
+	l.spent += ns;
+	latency_add( h, ns );
+	l.mark = latency_now();
+}
+
+//
+// latency_retire() - the op code routine and final tick of an
+// instruction with op code opc are over.
+//
+
+inline void latency_retire( LatencyStats &l, int opc ) {
+	latency_end( l, l.op[opc] );
+	latency_add( l.instr[opc], l.spent );
+}
+
+#endif
@@ -0,0 +1,189 @@
+// loader.C
+//
+// Text object files and binary memory images for minVAX.  See loader.h.
+
+#include "includes.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+const char IMAGE_MAGIC[4] = { 'S', 'I', 'M', 'G' };
+
+//
+// load_text() - read a text object file into a flat 256-byte memory
+// and return its entry point.  Returns false if the file cannot be
+// opened.
+//
+// Object file format (same as Memory::load()):
+//     address count word word ...		one line per record, in hex
+//     entry									last line: the entry point
+//
+
+static bool load_text( char *objfile, unsigned char *mem, long &entry ) {
+	FILE *fp;
+	char line[1024];
+
+	entry = 0;
+
+	fp = fopen( objfile, "r" );
+	if( fp == NULL ) {
+		fprintf( stderr, "Cannot open object file %s\n", objfile );
+		return false;
+	}
+
+	while( fgets( line, sizeof( line ), fp ) != NULL ) {
+		long word[ 2 + FAST_MEM_SIZE ];
+		int count = 0;
+		char *p = line;
+		char *end;
+
+		// Collect the hex numbers on this line.
+		while( count < (int)( sizeof( word ) / sizeof( word[0] ) ) ) {
+			word[count] = strtol( p, &end, 16 );
+			if( end == p )
+				break;
+			count++;
+			p = end;
+		}
+
+		if( count == 0 )
+			continue;
+
+		// A lone number is the entry point.
+		if( count == 1 ) {
+			entry = word[0];
+			break;
+		}
+
+		for( long i = 0; i < word[1] && i + 2 < count; i++ )
+			mem[( word[0] + i ) % FAST_MEM_SIZE] = word[i + 2];
+	}
+
+	fclose( fp );
+
+	return true;
+}
+
+//
+// image_long() - the 4-byte little-endian field at p.
+//
+
+static long image_long( const unsigned char *p ) {
+	return p[0] | ( p[1] << 8 ) | ( p[2] << 16 ) | ( (long)p[3] << 24 );
+}
+
+//
+// load_image() - copy the memory image of size bytes at p, mapped from
+// objfile, into a flat 256-byte memory and return its entry point.
+// Returns false if it is not an image of this machine's memory.
+//
+
+static bool load_image( const unsigned char *p, long size, char *objfile,
+	unsigned char *mem, long &entry ) {
+	long words = image_long( p + 12 );
+
+	if( p[4] != 1 || p[5] != ADDR_BITS || p[6] != DATA_BITS ||
+	    words != FAST_MEM_SIZE || size != IMAGE_HEADER_SIZE + words ) {
+		fprintf( stderr, "%s is not a minVAX memory image\n", objfile );
+		return false;
+	}
+
+	entry = image_long( p + 8 );
+	memcpy( mem, p + IMAGE_HEADER_SIZE, FAST_MEM_SIZE );
+
+	return true;
+}
+
+//
+// load_object() - load an object file or memory image into a flat
+// 256-byte memory and return its entry point.  Returns false if the
+// file cannot be opened or is a bad image.
+//
+
+bool load_object( char *objfile, unsigned char *mem, long &entry ) {
+	int fd = open( objfile, O_RDONLY );
+	struct stat st;
+
+	if( fd < 0 || fstat( fd, &st ) < 0 ) {
+		if( fd >= 0 )
+			close( fd );
+		fprintf( stderr, "Cannot open object file %s\n", objfile );
+		return false;
+	}
+
+	// an image is used straight from the mapped file
+	if( st.st_size >= (long)IMAGE_HEADER_SIZE ) {
+		void *map = mmap( NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+
+		if( map != MAP_FAILED ) {
+			const unsigned char *p = (const unsigned char *)map;
+
+			if( memcmp( p, IMAGE_MAGIC, sizeof( IMAGE_MAGIC ) ) == 0 ) {
+				bool ok = load_image( p, st.st_size, objfile, mem, entry );
+
+				munmap( map, st.st_size );
+				close( fd );
+				return ok;
+			}
+			munmap( map, st.st_size );
+		}
+	}
+	close( fd );
+
+	return load_text( objfile, mem, entry );
+}
+
+//
+// is_image() - whether objfile is a memory image rather than a text
+// object file.
+//
+
+bool is_image( const char *objfile ) {
+	FILE *fp = fopen( objfile, "rb" );
+	char magic[sizeof( IMAGE_MAGIC )];
+	bool image;
+
+	if( fp == NULL )
+		return false;
+	image = fread( magic, 1, sizeof( magic ), fp ) == sizeof( magic ) &&
+		memcmp( magic, IMAGE_MAGIC, sizeof( IMAGE_MAGIC ) ) == 0;
+	fclose( fp );
+
+	return image;
+}
+
+//
+// write_image() - write the 256-byte memory mem, entered at entry, to
+// path as a memory image.  Returns false if it cannot be written.
+//
+
+bool write_image( const char *path, const unsigned char *mem, long entry ) {
+	unsigned char header[IMAGE_HEADER_SIZE];
+	FILE *fp = fopen( path, "wb" );
+
+	if( fp == NULL ) {
+		fprintf( stderr, "Cannot create image file %s\n", path );
+		return false;
+	}
+
+	memset( header, 0, sizeof( header ) );
+	memcpy( header, IMAGE_MAGIC, sizeof( IMAGE_MAGIC ) );
+	header[4] = 1;
+	header[5] = ADDR_BITS;
+	header[6] = DATA_BITS;
+	for( int i = 0; i < 4; i++ ) {
+		header[8 + i] = entry >> ( 8 * i );
+		header[12 + i] = FAST_MEM_SIZE >> ( 8 * i );
+	}
+
+	fwrite( header, 1, sizeof( header ), fp );
+	fwrite( mem, 1, FAST_MEM_SIZE, fp );
+	if( fclose( fp ) != 0 ) {
+		fprintf( stderr, "Cannot write image file %s\n", path );
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,30 @@
+// loader.h
+//
+// Loading programs into the flat memory of the fast engine, the batch
+// runner and the lanes engine: either a text object file, as
+// Memory::load() reads it, or a binary memory image.
+//
+// A memory image is the whole of memory as loading left it, plus the
+// entry point, so loading one is a header check and a copy out of the
+// mapped file instead of parsing hex text.  minvax-image makes one from
+// an object file.  Layout, multi-byte fields little-endian:
+//
+//   0    IMAGE_MAGIC
+//   4    bytes per word (1)
+//   5    address bits (ADDR_BITS)
+//   6    data bits (DATA_BITS)
+//   7    0
+//   8    entry point, 4 bytes
+//   12   number of words (2 ** address bits), 4 bytes
+//   16   the words, from address 0
+//
+// The RTL model loads through Memory::load(), which reads text only.
+
+#ifndef _LOADER_H
+#define _LOADER_H
+
+const unsigned int IMAGE_HEADER_SIZE( 16 );
+
+extern const char IMAGE_MAGIC[4];	// "SIMG"
+
+#endif
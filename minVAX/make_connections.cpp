@@ -18,39 +18,39 @@
 // Connections for special components are not defined: Memory.
 // Special components do not directly read/write from anything.
 //
-void make_connections() {
+void make_connections( CpuContext &cpu ) {
 
-	ir.connectsTo( dbus.OUT() );
-	ir.connectsTo( m.READ() );
+	cpu.ir.connectsTo( cpu.dbus.OUT() );
+	cpu.ir.connectsTo( cpu.m.READ() );
 	
-	aux.connectsTo( alu.OUT() );
-	aux.connectsTo( abus.IN() );
-	aux.connectsTo( abus.OUT() );
-	aux.connectsTo( dbus.IN() );
-	aux.connectsTo( dbus.OUT() );
-	aux.connectsTo( m.READ() );
-	aux.connectsTo( m.WRITE() );
+	cpu.aux.connectsTo( cpu.alu.OUT() );
+	cpu.aux.connectsTo( cpu.abus.IN() );
+	cpu.aux.connectsTo( cpu.abus.OUT() );
+	cpu.aux.connectsTo( cpu.dbus.IN() );
+	cpu.aux.connectsTo( cpu.dbus.OUT() );
+	cpu.aux.connectsTo( cpu.m.READ() );
+	cpu.aux.connectsTo( cpu.m.WRITE() );
 	
-	pc.connectsTo( abus.IN() );
-	pc.connectsTo( abus.OUT() );
-	pc.connectsTo( alu.OP1() );
+	cpu.pc.connectsTo( cpu.abus.IN() );
+	cpu.pc.connectsTo( cpu.abus.OUT() );
+	cpu.pc.connectsTo( cpu.alu.OP1() );
 	
-	addr.connectsTo( alu.OP2() );
-	addr.connectsTo( m.READ() );
-	addr.connectsTo( abus.IN() );
-	addr.connectsTo( abus.OUT() );
-	addr.connectsTo( dbus.IN() );
-	addr.connectsTo( dbus.OUT() );
+	cpu.addr.connectsTo( cpu.alu.OP2() );
+	cpu.addr.connectsTo( cpu.m.READ() );
+	cpu.addr.connectsTo( cpu.abus.IN() );
+	cpu.addr.connectsTo( cpu.abus.OUT() );
+	cpu.addr.connectsTo( cpu.dbus.IN() );
+	cpu.addr.connectsTo( cpu.dbus.OUT() );
 	
-	r0.connectsTo( alu.OP1() );
-	r0.connectsTo( alu.OP2() );
-	r0.connectsTo( dbus.IN() );
-	r0.connectsTo( dbus.OUT() );
+	cpu.r0.connectsTo( cpu.alu.OP1() );
+	cpu.r0.connectsTo( cpu.alu.OP2() );
+	cpu.r0.connectsTo( cpu.dbus.IN() );
+	cpu.r0.connectsTo( cpu.dbus.OUT() );
 
-	r1.connectsTo( alu.OP1() );
-	r1.connectsTo( alu.OP2() );
-	r1.connectsTo( dbus.IN() );
-	r1.connectsTo( dbus.OUT() );
+	cpu.r1.connectsTo( cpu.alu.OP1() );
+	cpu.r1.connectsTo( cpu.alu.OP2() );
+	cpu.r1.connectsTo( cpu.dbus.IN() );
+	cpu.r1.connectsTo( cpu.dbus.OUT() );
 	
-	m.MAR().connectsTo( abus.OUT() );
+	cpu.m.MAR().connectsTo( cpu.abus.OUT() );
 }
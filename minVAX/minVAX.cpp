@@ -24,20 +24,331 @@ int main ( int argc, char *argv[] ) {
 
 	// CPUObject::debug |= CPUObject::trace | CPUObject::memload;
 
-	// make sure we've been given an object file name
+	// pick up the options, and make sure we've been given an object
+	// file name
+	//
+	//   --mode=rtl    run the arch register-transfer model (default)
+	//   --mode=fast   run the functional engine in fast_engine.cpp
+	//   --no-blocks   fast engine: interpret one instruction at a time
+	//                 instead of running translated basic blocks
+	//   --no-jit      fast engine: interpret the basic blocks instead of
+	//                 translating them to x86-64 code
+	//   --stats       print run statistics when the machine halts
+	//   --batch list  run every object file named in list on the fast
+	//                 engine, spread over a pool of threads
+	//   --threads=N   number of --batch threads (default: one per CPU)
+	//   --lanes list  run every object file named in list on the lockstep
+	//                 engine, LANES machines at a time
+	//   --limit=N     --batch, --lanes: stop each machine after N
+	//                 instructions (default 1000000, 0 = no limit)
+	//   --trace-file=FILE
+	//                 write the trace to FILE in binary form instead of
+	//                 printing it; minvax-trace prints it
+	//   --flight=N    keep only the last N instructions of the trace, and
+	//                 print them only if the machine halts on an error
+	//   --fold        print each loop in the trace once, with how many
+	//                 times it went round
+	//   --save=FILE   run the first N (--at=N, default 0) instructions on
+	//                 the fast engine and save the machine to FILE
+	//   --restore=FILE
+	//                 run the machine saved in FILE on to the halt on the
+	//                 fast engine, in place of an object file
+	//   --variants=LIST
+	//                 --restore: run a copy of the saved machine for each
+	//                 line of LIST, with the memory bytes (AA=VV) and
+	//                 registers (R0=VV, R1=VV, PC=VV) it gives changed;
+	//                 --limit=N applies
+	//   --counts      print instructions, cycles and memory reads and
+	//                 writes per op code, address mode and pair at halt
+	//   --counts-csv=FILE
+	//                 write the same tables to FILE as CSV
+	//   --profile     print executions and cycles per address and per
+	//                 basic block of the program, hottest first, at halt
+	//   --profile-folded=FILE
+	//                 write the cycles per instruction to FILE as folded
+	//                 stacks (program;block;instruction), for flame graphs
+	//   --latency     RTL model: print host time percentiles per op code,
+	//                 for the fetch and per address mode at halt
+	//   --cosim[=N]   RTL model: run the fast engine in lockstep and
+	//                 compare registers, cycles and memory after every
+	//                 instruction (or 1 in N); stop at the first difference
+	//   --overlap     RTL model: do memory reads in parallel with the next
+	//                 register transfer, and start each fetch in the final
+	//                 tick of the instruction before; print the cycles with
+	//                 and without
+	//   --pipeline    also time the run on a five-stage pipelined model,
+	//                 with and without forwarding, and print its cycles,
+	//                 CPI, stalls and branch penalties at halt
+	//   --compact     RTL model: record each instruction's register
+	//                 transfers, pack them into the fewest ticks the buses,
+	//                 ALU, memory port and data dependencies allow, and
+	//                 print the ticks saved per op code and address mode
+	//   --cache=SIZE,WAYS,LINE
+	//                 RTL model: put a unified cache of SIZE bytes, WAYS
+	//                 ways and LINE-byte lines in front of memory, and
+	//                 print its misses per fetch and data address at halt
+	//   --icache=SIZE,WAYS,LINE, --dcache=SIZE,WAYS,LINE
+	//                 RTL model: the same, with separate instruction and
+	//                 data caches (or either one alone)
+	//   --write-through
+	//                 caches write every store on to memory instead of
+	//                 writing dirty lines back when they are replaced
+	//   --miss=N      ticks a cache miss stalls for (default 10)
+	//   --predict=KIND[:BITS]
+	//                 predict every JMP, BEZ and BLT with a taken,
+	//                 not-taken, btfn, bimodal or gshare predictor (BITS:
+	//                 table size), charge each misprediction to the cycle
+	//                 count and print the mispredictions per branch at halt
+	//   --btb=N       --predict: redirect fetch through an N-entry branch
+	//                 target buffer
+	//   --penalty=N   cycles a mispredicted branch costs (default 2)
 
-	if( argc != 2 ) {
-		cerr << "Usage:  " << argv[0] << " object-file-name\n\n";
+	char *objfile = NULL;
+	char *listfile = NULL;
+	char *lanefile = NULL;
+	char *savefile = NULL;
+	char *restorefile = NULL;
+	char *variantfile = NULL;
+	long saveAt = 0;
+	bool badArgs = false;
+
+	for( int i = 1; i < argc; i++ ) {
+		if( strcmp( argv[i], "--mode=rtl" ) == 0 )
+			sim_mode = MODE_RTL;
+		else if( strcmp( argv[i], "--mode=fast" ) == 0 )
+			sim_mode = MODE_FAST;
+		else if( strcmp( argv[i], "--no-blocks" ) == 0 )
+			use_blocks = false;
+		else if( strcmp( argv[i], "--no-jit" ) == 0 )
+			use_jit = false;
+		else if( strcmp( argv[i], "--stats" ) == 0 )
+			show_stats = true;
+		else if( strcmp( argv[i], "--batch" ) == 0 && i + 1 < argc )
+			listfile = argv[++i];
+		else if( strncmp( argv[i], "--threads=", 10 ) == 0 )
+			batch_threads = atoi( argv[i] + 10 );
+		else if( strcmp( argv[i], "--lanes" ) == 0 && i + 1 < argc )
+			lanefile = argv[++i];
+		else if( strncmp( argv[i], "--limit=", 8 ) == 0 )
+			lane_limit = atol( argv[i] + 8 );
+		else if( strncmp( argv[i], "--trace-file=", 13 ) == 0 )
+			trace_file = argv[i] + 13;
+		else if( strncmp( argv[i], "--flight=", 9 ) == 0 ) {
+			flight_size = atol( argv[i] + 9 );
+			if( flight_size <= 0 )
+				badArgs = true;
+		}
+		else if( strcmp( argv[i], "--fold" ) == 0 )
+			fold_trace = true;
+		else if( strncmp( argv[i], "--save=", 7 ) == 0 )
+			savefile = argv[i] + 7;
+		else if( strncmp( argv[i], "--at=", 5 ) == 0 )
+			saveAt = atol( argv[i] + 5 );
+		else if( strncmp( argv[i], "--restore=", 10 ) == 0 )
+			restorefile = argv[i] + 10;
+		else if( strncmp( argv[i], "--variants=", 11 ) == 0 )
+			variantfile = argv[i] + 11;
+		else if( strcmp( argv[i], "--counts" ) == 0 )
+			show_counts = true;
+		else if( strncmp( argv[i], "--counts-csv=", 13 ) == 0 )
+			counts_file = argv[i] + 13;
+		else if( strcmp( argv[i], "--profile" ) == 0 )
+			show_profile = true;
+		else if( strncmp( argv[i], "--profile-folded=", 17 ) == 0 )
+			profile_file = argv[i] + 17;
+		else if( strcmp( argv[i], "--latency" ) == 0 )
+			show_latency = true;
+		else if( strcmp( argv[i], "--overlap" ) == 0 )
+			overlap_fetch = true;
+		else if( strcmp( argv[i], "--pipeline" ) == 0 )
+			show_pipeline = true;
+		else if( strcmp( argv[i], "--compact" ) == 0 )
+			compact_ticks = true;
+		else if( strncmp( argv[i], "--cache=", 8 ) == 0 )
+			cache_spec = argv[i] + 8;
+		else if( strncmp( argv[i], "--icache=", 9 ) == 0 )
+			icache_spec = argv[i] + 9;
+		else if( strncmp( argv[i], "--dcache=", 9 ) == 0 )
+			dcache_spec = argv[i] + 9;
+		else if( strcmp( argv[i], "--write-through" ) == 0 )
+			write_through = true;
+		else if( strncmp( argv[i], "--miss=", 7 ) == 0 ) {
+			miss_ticks = atol( argv[i] + 7 );
+			if( miss_ticks < 0 )
+				badArgs = true;
+		}
+		else if( strncmp( argv[i], "--predict=", 10 ) == 0 )
+			predict_spec = argv[i] + 10;
+		else if( strncmp( argv[i], "--btb=", 6 ) == 0 ) {
+			btb_size = atol( argv[i] + 6 );
+			if( btb_size <= 0 || btb_size > PREDICT_SITES ||
+			    ( btb_size & ( btb_size - 1 ) ) )
+				badArgs = true;
+		}
+		else if( strncmp( argv[i], "--penalty=", 10 ) == 0 ) {
+			branch_penalty = atol( argv[i] + 10 );
+			if( branch_penalty < 0 )
+				badArgs = true;
+		}
+		else if( strcmp( argv[i], "--cosim" ) == 0 )
+			cosim_every = 1;
+		else if( strncmp( argv[i], "--cosim=", 8 ) == 0 ) {
+			cosim_every = atol( argv[i] + 8 );
+			if( cosim_every <= 0 )
+				badArgs = true;
+		}
+		else if( argv[i][0] != '-' && objfile == NULL )
+			objfile = argv[i];
+		else
+			badArgs = true;
+	}
+
+	if( ( objfile != NULL ) + ( listfile != NULL ) + ( lanefile != NULL ) +
+	    ( restorefile != NULL ) != 1 )
+		badArgs = true;
+
+	// a snapshot is of one machine, and variants start from one
+	if( savefile != NULL && objfile == NULL )
+		badArgs = true;
+	if( variantfile != NULL && ( restorefile == NULL || trace_file != NULL ||
+	    flight_size > 0 || fold_trace ) )
+		badArgs = true;
+
+	// the counts, the profile, the pipeline timing and the branch
+	// prediction are of one run
+	if( ( show_counts || counts_file != NULL || show_profile ||
+	    profile_file != NULL || show_pipeline || predict_spec != NULL ) &&
+	    ( listfile != NULL || lanefile != NULL || variantfile != NULL ) )
+		badArgs = true;
+
+	// host time is measured, and transfers recorded, on the RTL model
+	if( ( show_latency || compact_ticks ) && ( sim_mode != MODE_RTL || objfile == NULL ||
+	    savefile != NULL ) )
+		badArgs = true;
+
+	// co-simulation checks the RTL model against the fast engine, and
+	// overlapping changes the RTL model's timing only
+	if( ( cosim_every > 0 || overlap_fetch ) && ( sim_mode != MODE_RTL ||
+	    objfile == NULL || savefile != NULL ) )
+		badArgs = true;
+
+	// the caches are one unified one or a split pair, each SIZE,WAYS,LINE
+	const char *caches[3] = { cache_spec, icache_spec, dcache_spec };
+	long size, ways, line;
+
+	if( cache_spec != NULL && ( icache_spec != NULL || dcache_spec != NULL ) )
+		badArgs = true;
+	for( int i = 0; i < 3; i++ )
+		if( caches[i] != NULL && !cache_parse( caches[i], size, ways, line ) )
+			badArgs = true;
+
+	// they stall the RTL model's reads and writes, which --compact takes
+	// to be a tick each
+	if( ( cache_spec != NULL || icache_spec != NULL || dcache_spec != NULL ) &&
+	    ( sim_mode != MODE_RTL || objfile == NULL || savefile != NULL ||
+	    compact_ticks ) )
+		badArgs = true;
+	if( write_through && cache_spec == NULL && icache_spec == NULL &&
+	    dcache_spec == NULL )
+		badArgs = true;
+
+	// the branch predictor is KIND[:BITS], and its BTB needs it; a
+	// misprediction stalls the RTL model too
+	int kind, bits;
+
+	if( predict_spec != NULL && ( savefile != NULL || compact_ticks ||
+	    !predictor_parse( predict_spec, kind, bits ) ) )
+		badArgs = true;
+	if( btb_size > 0 && predict_spec == NULL )
+		badArgs = true;
+
+	// one trace file is for one program, and it holds the whole trace
+	if( trace_file != NULL && ( objfile == NULL || flight_size > 0 ) )
+		badArgs = true;
+	if( fold_trace && ( trace_file != NULL || flight_size > 0 ) )
+		badArgs = true;
+
+	if( badArgs ) {
+		cerr << "Usage:  " << argv[0]
+		     << " [--mode=rtl|--mode=fast] [--no-blocks] [--no-jit]"
+		     << " [--stats] [--trace-file=FILE|--flight=N|--fold]"
+		     << " [--counts] [--counts-csv=FILE] [--profile]"
+		     << " [--profile-folded=FILE] [--latency] [--cosim[=N]]"
+		     << " [--overlap] [--pipeline] [--compact]"
+		     << " [--cache=S,W,L|--icache=S,W,L --dcache=S,W,L]"
+		     << " [--write-through] [--miss=N]"
+		     << " [--predict=KIND[:BITS] [--btb=N] [--penalty=N]]"
+		     << " object-file-name\n"
+		     << "        " << argv[0]
+		     << " --batch list-file [--threads=N] [--limit=N] [--no-blocks]"
+		     << " [--no-jit] [--flight=N|--fold] [--stats]\n"
+		     << "        " << argv[0]
+		     << " --lanes list-file [--limit=N] [--stats]\n"
+		     << "        " << argv[0]
+		     << " --save=FILE [--at=N] [--trace-file=FILE|--flight=N|--fold]"
+		     << " object-file-name\n"
+		     << "        " << argv[0]
+		     << " --restore=FILE [--no-blocks] [--no-jit] [--stats]"
+		     << " [--trace-file=FILE|--flight=N|--fold] [--counts]"
+		     << " [--counts-csv=FILE] [--profile] [--profile-folded=FILE]"
+		     << " [--pipeline] [--predict=KIND[:BITS] [--btb=N] [--penalty=N]]\n"
+		     << "        " << argv[0]
+		     << " --restore=FILE --variants=LIST [--limit=N] [--stats]\n\n";
 		exit( 1 );
 	}
 
+	if( listfile != NULL )
+		return( run_batch( listfile ) == 0 ? 0 : 1 );
+	if( lanefile != NULL )
+		return( run_lanes( lanefile ) == 0 ? 0 : 1 );
+	if( savefile != NULL )
+		return( run_save( objfile, savefile, saveAt ) ? 0 : 1 );
+	if( variantfile != NULL )
+		return( run_variants( restorefile, variantfile ) == 0 ? 0 : 1 );
+	if( restorefile != NULL )
+		return( run_restore( restorefile ) ? 0 : 1 );
+
 	cout << hex; // change base for future printing
 
 	try {
 
-		make_connections();
+		if( sim_mode == MODE_FAST ) {
+
+			run_fast( objfile );
+
+		}
+		else {
+
+			// Memory::load() reads text object files only
+			if( is_image( objfile ) ) {
+				cerr << objfile << " is a memory image; run it with"
+				     << " --mode=fast\n";
+				return( 1 );
+			}
+
+			CpuContext cpu;
+
+			if( trace_file != NULL &&
+			    !trace_open_binary( cpu.trace, trace_file ) )
+				return( 1 );
+			if( flight_size > 0 )
+				trace_open_ring( cpu.trace, flight_size );
+			if( fold_trace )
+				trace_open_fold( cpu.trace );
+
+			make_connections( cpu );
+
+			CoSim cosim;
+
+			if( cosim_every > 0 && !cosim_start( cosim, cpu, objfile ) )
+				return( 1 );
+
+			run_simulation( cpu, objfile );
+
+			if( cosim_every > 0 && cosim.diverged )
+				return( 1 );
 
-		run_simulation( argv[1] );
+		}
 
 	}
 
@@ -0,0 +1,414 @@
+// minvax_bench.C
+//
+// minvax-bench: simulated instructions per second for every (op code,
+// address mode) pair, on the RTL model and each fast engine mode.
+//
+//   minvax-bench [--time=S] [--engine=NAME]... [json-file]
+//
+// For each pair it builds a program whose loop body is BENCH_BODY copies
+// of the instruction, run BENCH_ITERATIONS times, and runs it with the
+// trace off until at least S host seconds (default 0.1) have gone by.
+// It prints million instructions per second per pair and engine, and
+// with json-file also writes every result, with ns per instruction, as
+// JSON for comparing builds.  The engines are rtl, interp (--no-blocks),
+// blocks (--no-jit) and jit; --engine picks some of them.
+//
+// The loop counter is R1, or R0 when the instruction under test is a
+// STR or branch through disp(R1), which must stay put.  The instruction
+// under test names R0 as RA; a branch goes to the next instruction
+// whether it is taken or not, and a store goes to BENCH_DATA.  DMP
+// (which prints) and HLT are left out, as are the address modes an op
+// code does not allow.
+
+#include "includes.h"
+
+#include <unistd.h>
+
+const int BENCH_BODY( 64 );				// copies of the instruction per pass
+const int BENCH_ITERATIONS( 256 );		// passes: the counter wraps to 0
+const unsigned int BENCH_DATA( 0xf0 );	// where the stores go
+
+enum BenchEngine { BENCH_RTL, BENCH_INTERP, BENCH_BLOCKS, BENCH_JIT,
+	BENCH_ENGINES };
+
+static const char *const engine_names[BENCH_ENGINES] = {
+	"rtl", "interp", "blocks", "jit"
+};
+
+struct BenchResult {
+	long instructions;		// instructions run, all runs
+	long runs;				// times the program was run
+	double seconds;			// host time they took
+};
+
+//
+// usage() - print the usage message and exit.
+//
+
+static void usage( char *name ) {
+	cerr << "Usage:  " << name
+	     << " [--time=S] [--engine=rtl|interp|blocks|jit]... [json-file]\n\n";
+	exit( 1 );
+}
+
+//
+// bench_program() - build the program for instruction byte ir in mem.
+// Returns the instructions one run executes, or 0 if ir is not
+// benchmarked.
+//
+
+static long bench_program( int ir, unsigned char *mem ) {
+	const DecodeEntry &e = decode_table[ir];
+	bool usesAm = ( e.opc > 0 && e.opc < 10 );
+	bool branch = ( e.opc >= 7 && e.opc <= 9 );
+	int counter = ( e.opc >= 6 && e.opc <= 9 && e.am == 3 ) ? 0 : 1;
+	unsigned int pc = 0, loop;
+
+	// one byte per pair, with RA R0
+	if( e.ra != 0 || ( !usesAm && e.am != 0 ) )
+		return 0;
+	if( e.opc == 14 || e.opc == 15 || e.status != DECODE_OK )
+		return 0;
+
+	memset( mem, 0, FAST_MEM_SIZE );
+
+	mem[pc++] = 0xb0;		// CLR R0
+	mem[pc++] = 0xb1;		// CLR R1
+	loop = pc;
+
+	for( int i = 0; i < BENCH_BODY; i++ ) {
+		mem[pc++] = ir;
+		if( e.length == 2 ) {
+			unsigned int next = pc + 1;
+			unsigned int imm = 1;
+
+			// disp(Rn) has Rn == 0 when it matters; PC relative is from
+			// the next instruction.
+			if( branch )
+				imm = ( e.am == 6 ) ? 0 : next;
+			else if( e.opc == 6 )
+				imm = ( e.am == 6 ) ? BENCH_DATA - next : BENCH_DATA;
+			mem[pc++] = imm & 0xff;
+		}
+	}
+
+	mem[pc++] = 0xd0 | counter;		// INC counter
+	mem[pc++] = 0x8a | counter;		// BEZ counter, exit (absolute)
+	mem[pc] = pc + 3;
+	pc++;
+	mem[pc++] = 0x7a;				// JMP loop (absolute)
+	mem[pc++] = loop;
+	mem[pc++] = 0xf0;				// exit: HLT
+
+	return 2 + BENCH_ITERATIONS * ( BENCH_BODY + 2 ) +
+		( BENCH_ITERATIONS - 1 ) + 1;
+}
+
+//
+// write_object() - write mem as a text object file for Memory::load(),
+// entry point 0.  Returns false if it cannot be written.
+//
+
+static bool write_object( const char *path, const unsigned char *mem ) {
+	FILE *fp = fopen( path, "w" );
+
+	if( fp == NULL ) {
+		fprintf( stderr, "Cannot create object file %s\n", path );
+		return false;
+	}
+
+	for( unsigned int addr = 0; addr < FAST_MEM_SIZE; addr += 16 ) {
+		fprintf( fp, "%02x 10", addr );
+		for( unsigned int i = 0; i < 16; i++ )
+			fprintf( fp, " %02x", mem[addr + i] );
+		fprintf( fp, "\n" );
+	}
+	fprintf( fp, "00\n" );
+
+	return fclose( fp ) == 0;
+}
+
+//
+// bench_fast() - run the program in image on the fast engine, as the
+// engine selects, until min seconds have gone by.  Returns false if a
+// run did not execute expect instructions.
+//
+// The program only stores to BENCH_DATA, so its code is the same from
+// one run to the next, and each run starts with the decode, block and
+// JIT caches the last one left.  One untimed run fills them first.
+//
+
+static bool bench_fast( FastCpu &cpu, const unsigned char *image,
+	BenchEngine engine, double min, long expect, BenchResult &r ) {
+	bool ok = true;
+
+	use_blocks = ( engine != BENCH_INTERP );
+	use_jit = ( engine == BENCH_JIT );
+
+	fast_reset( cpu );
+	trace_off( cpu.trace );
+	memcpy( cpu.mem, image, FAST_MEM_SIZE );
+
+	for( bool warm = false; ok && ( !warm || r.seconds < min ); warm = true ) {
+		cpu.pc = 0;
+		cpu.pcOverflow = false;
+		cpu.done = false;
+		cpu.instructions = 0;
+
+		double start = host_seconds();
+
+		fast_finish( cpu );
+
+		if( warm ) {
+			r.seconds += host_seconds() - start;
+			r.instructions += cpu.instructions;
+			r.runs++;
+		}
+
+		ok = ( cpu.instructions == expect );
+	}
+
+	jit_release( cpu.jit );
+
+	return ok;
+}
+
+//
+// bench_rtl() - run the object file on the RTL model until min seconds
+// have gone by.  The time includes Memory::load().
+//
+
+static void bench_rtl( CpuContext &cpu, char *objfile, double min,
+	long expect, BenchResult &r ) {
+	do {
+		double start = host_seconds();
+
+		cpu.done = false;
+		run_simulation( cpu, objfile );
+		r.seconds += host_seconds() - start;
+		r.instructions += expect;
+		r.runs++;
+	} while( r.seconds < min );
+}
+
+//
+// mips() - million instructions per host second.
+//
+
+static double mips( const BenchResult &r ) {
+	return r.seconds > 0 ? r.instructions / r.seconds / 1e6 : 0.0;
+}
+
+//
+// json_result() - one result object, for instruction byte ir, or with
+// ir -1 for an engine's total.  last leaves off the comma.
+//
+
+static void json_result( FILE *fp, BenchEngine engine, int ir,
+	const BenchResult &r, bool last ) {
+	fprintf( fp, "    { \"engine\": \"%s\", ", engine_names[engine] );
+	if( ir >= 0 ) {
+		const DecodeEntry &e = decode_table[ir];
+
+		fprintf( fp, "\"ir\": \"%02x\", \"op\": \"%s\", \"am\": \"%s\", ", ir,
+			op_mnemonics[e.opc],
+			am_names[( e.opc > 0 && e.opc < 10 ) ? e.am : COUNT_NO_AM] );
+	}
+	fprintf( fp, "\"instructions\": %ld, \"runs\": %ld, \"seconds\": %.6f, "
+		"\"mips\": %.3f, \"ns_per_instruction\": %.2f }%s\n", r.instructions,
+		r.runs, r.seconds, mips( r ),
+		r.instructions > 0 ? r.seconds * 1e9 / r.instructions : 0.0,
+		last ? "" : "," );
+}
+
+int main( int argc, char *argv[] ) {
+	static BenchResult result[256][BENCH_ENGINES];
+	BenchResult total[BENCH_ENGINES];
+	bool wanted[BENCH_ENGINES];
+	bool anyEngine = false;
+	char *jsonfile = NULL;
+	double min = 0.1;
+
+	for( int i = 0; i < BENCH_ENGINES; i++ )
+		wanted[i] = false;
+
+	for( int i = 1; i < argc; i++ ) {
+		if( strncmp( argv[i], "--time=", 7 ) == 0 ) {
+			min = atof( argv[i] + 7 );
+			if( min < 0 )
+				usage( argv[0] );
+		}
+		else if( strncmp( argv[i], "--engine=", 9 ) == 0 ) {
+			int n;
+
+			for( n = 0; n < BENCH_ENGINES; n++ )
+				if( strcmp( argv[i] + 9, engine_names[n] ) == 0 )
+					break;
+			if( n == BENCH_ENGINES )
+				usage( argv[0] );
+			wanted[n] = anyEngine = true;
+		}
+		else if( argv[i][0] != '-' && jsonfile == NULL )
+			jsonfile = argv[i];
+		else
+			usage( argv[0] );
+	}
+
+	if( !anyEngine )
+		for( int i = 0; i < BENCH_ENGINES; i++ )
+			wanted[i] = true;
+
+	memset( result, 0, sizeof( result ) );
+	memset( total, 0, sizeof( total ) );
+
+	FastCpu *cpu = new FastCpu;
+	char objfile[] = "/tmp/minvax-bench-XXXXXX";
+	int fd = mkstemp( objfile );
+
+	if( fd < 0 ) {
+		fprintf( stderr, "Cannot create a temporary object file\n" );
+		return( 1 );
+	}
+	close( fd );
+
+	try {
+
+		CpuContext rtl;
+
+		trace_off( rtl.trace );
+		make_connections( rtl );
+
+		for( int ir = 0; ir < 256; ir++ ) {
+			unsigned char image[FAST_MEM_SIZE];
+			long expect = bench_program( ir, image );
+
+			if( expect == 0 )
+				continue;
+
+			for( int n = 0; n < BENCH_ENGINES; n++ ) {
+				if( !wanted[n] )
+					continue;
+
+				BenchEngine engine = (BenchEngine)n;
+
+				if( engine == BENCH_RTL ) {
+					if( !write_object( objfile, image ) )
+						return( 1 );
+					bench_rtl( rtl, objfile, min, expect, result[ir][n] );
+				}
+				else if( !bench_fast( *cpu, image, engine, min, expect,
+				    result[ir][n] ) ) {
+					fprintf( stderr, "Instruction %02x ran %ld instructions on "
+						"the %s engine, not %ld\n", ir, cpu->instructions,
+						engine_names[n], expect );
+					unlink( objfile );
+					return( 1 );
+				}
+
+				total[n].instructions += result[ir][n].instructions;
+				total[n].runs += result[ir][n].runs;
+				total[n].seconds += result[ir][n].seconds;
+			}
+		}
+
+	}
+
+	catch( ArchLibError &err ) {
+
+		cout << endl
+		     << "Simulation aborted - ArchLib runtime error"
+		     << endl
+		     << "Cause:  " << err.what() << endl;
+		unlink( objfile );
+		return( 1 );
+
+	}
+
+	unlink( objfile );
+	delete cpu;
+
+	// the table, million instructions per second
+	printf( "\nMillion simulated instructions per second:\n  %-2s %-4s %-9s",
+		"ir", "op", "am" );
+	for( int n = 0; n < BENCH_ENGINES; n++ )
+		if( wanted[n] )
+			printf( " %9s", engine_names[n] );
+	printf( "\n" );
+
+	for( int ir = 0; ir < 256; ir++ ) {
+		const DecodeEntry &e = decode_table[ir];
+		bool ran = false;
+
+		for( int n = 0; n < BENCH_ENGINES; n++ )
+			ran = ran || result[ir][n].runs > 0;
+		if( !ran )
+			continue;
+
+		printf( "  %02x %-4s %-9s", ir, op_mnemonics[e.opc],
+			am_names[( e.opc > 0 && e.opc < 10 ) ? e.am : COUNT_NO_AM] );
+		for( int n = 0; n < BENCH_ENGINES; n++ )
+			if( wanted[n] )
+				printf( " %9.3f", mips( result[ir][n] ) );
+		printf( "\n" );
+	}
+
+	printf( "  %-17s", "all" );
+	for( int n = 0; n < BENCH_ENGINES; n++ )
+		if( wanted[n] )
+			printf( " %9.3f", mips( total[n] ) );
+	printf( "\n" );
+
+	if( jsonfile == NULL )
+		return( 0 );
+
+	FILE *fp = fopen( jsonfile, "w" );
+	char host[256];
+	char date[64];
+	time_t now = time( NULL );
+
+	if( fp == NULL ) {
+		fprintf( stderr, "Cannot create JSON file %s\n", jsonfile );
+		return( 1 );
+	}
+
+	if( gethostname( host, sizeof( host ) ) != 0 )
+		strcpy( host, "unknown" );
+	host[sizeof( host ) - 1] = '\0';
+	strftime( date, sizeof( date ), "%Y-%m-%dT%H:%M:%SZ", gmtime( &now ) );
+
+	fprintf( fp, "{\n  \"benchmark\": \"minvax-bench\",\n"
+		"  \"date\": \"%s\",\n  \"host\": \"%s\",\n  \"body\": %d,\n"
+		"  \"iterations\": %d,\n  \"min_seconds\": %.3f,\n"
+		"  \"results\": [\n", date, host, BENCH_BODY, BENCH_ITERATIONS, min );
+
+	int last = -1;
+
+	for( int ir = 0; ir < 256; ir++ )
+		for( int n = 0; n < BENCH_ENGINES; n++ )
+			if( result[ir][n].runs > 0 )
+				last = ir * BENCH_ENGINES + n;
+
+	for( int ir = 0; ir < 256; ir++ )
+		for( int n = 0; n < BENCH_ENGINES; n++ )
+			if( result[ir][n].runs > 0 )
+				json_result( fp, (BenchEngine)n, ir, result[ir][n],
+					ir * BENCH_ENGINES + n == last );
+
+	fprintf( fp, "  ],\n  \"engines\": [\n" );
+
+	for( int n = 0; n < BENCH_ENGINES; n++ )
+		if( wanted[n] )
+			last = n;
+	for( int n = 0; n < BENCH_ENGINES; n++ )
+		if( wanted[n] )
+			json_result( fp, (BenchEngine)n, -1, total[n], n == last );
+
+	fprintf( fp, "  ]\n}\n" );
+
+	if( fclose( fp ) != 0 ) {
+		fprintf( stderr, "Cannot write JSON file %s\n", jsonfile );
+		return( 1 );
+	}
+
+	return( 0 );
+}
@@ -0,0 +1,29 @@
+// minvax_image.C
+//
+// minvax-image: convert a minVAX text object file into a binary memory
+// image, which minVAX --mode=fast, --batch and --lanes load by copying
+// it instead of parsing it.
+//
+//   minvax-image object-file image-file
+//
+// See loader.h for the image layout.
+
+#include "includes.h"
+
+int main( int argc, char *argv[] ) {
+	unsigned char mem[FAST_MEM_SIZE];
+	long entry;
+
+	if( argc != 3 ) {
+		cerr << "Usage:  " << argv[0] << " object-file image-file\n\n";
+		exit( 1 );
+	}
+
+	memset( mem, 0, sizeof( mem ) );
+	if( !load_object( argv[1], mem, entry ) )
+		return( 1 );
+	if( !write_image( argv[2], mem, entry ) )
+		return( 1 );
+
+	return( 0 );
+}
@@ -0,0 +1,148 @@
+// minvax_trace.C
+//
+// minvax-trace: print a binary trace written by minVAX --trace-file as
+// the text minVAX prints, optionally only the instructions in a range
+// of addresses or with given op codes.
+//
+//   minvax-trace [--pc=LO-HI] [--op=MNE]... trace-file
+//
+// The file is mapped rather than read, and rendered with the same code
+// minVAX uses for its text trace.
+
+#include "includes.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//
+// usage() - print the usage message and exit.
+//
+
+static void usage( char *name ) {
+	cerr << "Usage:  " << name
+	     << " [--pc=LO-HI] [--op=MNE]... trace-file\n\n";
+	exit( 1 );
+}
+
+int main( int argc, char *argv[] ) {
+	char *tracefile = NULL;
+	long pcLow = 0, pcHigh = 0xff;
+	bool opWanted[16];
+	bool filtered = false;
+	bool anyOp = false;
+
+	for( int opc = 0; opc < 16; opc++ )
+		opWanted[opc] = false;
+
+	// pick up the options
+	//
+	//   --pc=LO-HI   only instructions at addresses LO to HI (hex)
+	//   --op=MNE     only instructions with mnemonic MNE; may be repeated
+
+	for( int i = 1; i < argc; i++ ) {
+		if( strncmp( argv[i], "--pc=", 5 ) == 0 ) {
+			if( sscanf( argv[i] + 5, "%lx-%lx", &pcLow, &pcHigh ) != 2 )
+				usage( argv[0] );
+			filtered = true;
+		}
+		else if( strncmp( argv[i], "--op=", 5 ) == 0 ) {
+			bool found = false;
+
+			for( int opc = 0; opc < 16; opc++ )
+				if( strcasecmp( argv[i] + 5, op_mnemonics[opc] ) == 0 ) {
+					opWanted[opc] = true;
+					found = true;
+				}
+			if( !found )
+				usage( argv[0] );
+			filtered = anyOp = true;
+		}
+		else if( argv[i][0] != '-' && tracefile == NULL )
+			tracefile = argv[i];
+		else
+			usage( argv[0] );
+	}
+
+	if( tracefile == NULL )
+		usage( argv[0] );
+
+	// map the whole file
+
+	int fd = open( tracefile, O_RDONLY );
+	struct stat st;
+
+	if( fd < 0 || fstat( fd, &st ) < 0 ) {
+		fprintf( stderr, "Cannot open trace file %s\n", tracefile );
+		return( 1 );
+	}
+
+	long size = st.st_size;
+	const unsigned char *data = NULL;
+
+	if( size > 0 ) {
+		void *map = mmap( NULL, size, PROT_READ, MAP_PRIVATE, fd, 0 );
+
+		if( map == MAP_FAILED ) {
+			perror( "mmap" );
+			return( 1 );
+		}
+		data = (const unsigned char *)map;
+		madvise( map, size, MADV_SEQUENTIAL );
+	}
+
+	if( size < (long)sizeof( TRACE_MAGIC ) ||
+	    memcmp( data, TRACE_MAGIC, sizeof( TRACE_MAGIC ) ) != 0 ) {
+		fprintf( stderr, "%s is not a minVAX trace file\n", tracefile );
+		return( 1 );
+	}
+
+	// render the records
+
+	TraceWriter tw;
+	TraceCodec codec;
+	TraceRecord rec;
+	long at = sizeof( TRACE_MAGIC );
+	int status = 0;
+
+	trace_codec_reset( codec, 0 );
+
+	while( at < size ) {
+		int kind;
+		long pc, ir;
+		long used = trace_decode( data + at, size - at, codec, kind, pc, ir,
+			rec );
+
+		if( used == 0 ) {
+			trace_flush( tw );
+			fprintf( stderr, "%s: bad or truncated record at offset %lx\n",
+				tracefile, at );
+			status = 1;
+			break;
+		}
+		at += used;
+
+		if( kind == TRACE_INSTR ) {
+			if( pc < pcLow || pc > pcHigh )
+				continue;
+			if( anyOp && !opWanted[( ir >> 4 ) & 0xf] )
+				continue;
+			trace_render( tw, pc, ir, rec );
+		}
+		else if( !filtered ) {
+			if( kind == TRACE_START )
+				trace_start( tw, pc, true );
+			else
+				trace_overflow( tw );
+		}
+	}
+
+	trace_flush( tw );
+
+	if( size > 0 )
+		munmap( (void *)data, size );
+	close( fd );
+
+	return( status );
+}
@@ -0,0 +1,165 @@
+// op_counts.C
+//
+// --counts and --counts-csv: the tables of instructions, clock ticks and
+// memory traffic per op code, per address mode and per pair.  See
+// op_counts.h.
+
+#include "includes.h"
+
+const char *const am_names[COUNT_NO_AM + 1] = {
+	"R0", "R1", "disp(R0)", "disp(R1)", "imm", "abs", "pc-rel", "am 7", "-"
+};
+
+//
+// op_counts_reset() - nothing counted yet.
+//
+
+void op_counts_reset( OpCounts &c ) {
+	memset( &c, 0, sizeof( c ) );
+}
+
+//
+// count_sum() - n += m.
+//
+
+static void count_sum( OpCount &n, const OpCount &m ) {
+	n.instructions += m.instructions;
+	n.cycles += m.cycles;
+	n.reads += m.reads;
+	n.writes += m.writes;
+}
+
+//
+// count_row() - one line of a table, if anything was counted.
+//
+
+static void count_row( FILE *out, const char *name, const OpCount &n ) {
+	if( n.instructions == 0 )
+		return;
+
+	fprintf( out, "  %-16s %12ld %12ld %8.2f %12ld %12ld\n", name,
+		n.instructions, n.cycles, (double)n.cycles / n.instructions,
+		n.reads, n.writes );
+}
+
+//
+// count_head() - the title and column headings of a table.
+//
+
+static void count_head( FILE *out, const char *title ) {
+	fprintf( out, "\n%s:\n  %-16s %12s %12s %8s %12s %12s\n", title, "",
+		"instructions", "cycles", "cyc/ins", "reads", "writes" );
+}
+
+//
+// op_counts_report() - print the three tables.  total is the run's
+// cycle count, so the cycles outside any instruction can be shown.
+//
+
+void op_counts_report( FILE *out, const OpCounts &c, long total ) {
+	OpCount all;
+	char name[32];
+
+	memset( &all, 0, sizeof( all ) );
+
+	count_head( out, "Cycles by op code" );
+	for( int opc = 0; opc < 16; opc++ ) {
+		OpCount n;
+
+		memset( &n, 0, sizeof( n ) );
+		for( int am = 0; am <= COUNT_NO_AM; am++ )
+			count_sum( n, c.pair[opc][am] );
+		sprintf( name, "%x %s", opc, op_mnemonics[opc] );
+		count_row( out, name, n );
+		count_sum( all, n );
+	}
+	count_row( out, "all", all );
+
+	count_head( out, "Cycles by address mode" );
+	for( int am = 0; am <= COUNT_NO_AM; am++ ) {
+		OpCount n;
+
+		memset( &n, 0, sizeof( n ) );
+		for( int opc = 0; opc < 16; opc++ )
+			count_sum( n, c.pair[opc][am] );
+		count_row( out, am_names[am], n );
+	}
+
+	count_head( out, "Cycles by op code and address mode" );
+	for( int opc = 0; opc < 16; opc++ )
+		for( int am = 0; am <= COUNT_NO_AM; am++ ) {
+			sprintf( name, "%x %s %s", opc, op_mnemonics[opc], am_names[am] );
+			count_row( out, name, c.pair[opc][am] );
+		}
+
+	fprintf( out, "\n%ld cycles outside the instructions counted (loading, "
+		"PC overflow)\n", total - all.cycles );
+}
+
+//
+// op_counts_csv() - write the three tables to path as CSV, one row per
+// op code, address mode and pair that ran.  Returns false if the file
+// cannot be written.
+//
+
+bool op_counts_csv( const char *path, const OpCounts &c ) {
+	FILE *fp = fopen( path, "w" );
+
+	if( fp == NULL ) {
+		fprintf( stderr, "Cannot create counts file %s\n", path );
+		return false;
+	}
+
+	fprintf( fp, "table,opc,op,am,instructions,cycles,reads,writes\n" );
+
+	for( int opc = 0; opc < 16; opc++ ) {
+		OpCount n;
+
+		memset( &n, 0, sizeof( n ) );
+		for( int am = 0; am <= COUNT_NO_AM; am++ )
+			count_sum( n, c.pair[opc][am] );
+		if( n.instructions > 0 )
+			fprintf( fp, "op,%x,%s,,%ld,%ld,%ld,%ld\n", opc,
+				op_mnemonics[opc], n.instructions, n.cycles, n.reads, n.writes );
+	}
+
+	for( int am = 0; am <= COUNT_NO_AM; am++ ) {
+		OpCount n;
+
+		memset( &n, 0, sizeof( n ) );
+		for( int opc = 0; opc < 16; opc++ )
+			count_sum( n, c.pair[opc][am] );
+		if( n.instructions > 0 )
+			fprintf( fp, "am,,,%s,%ld,%ld,%ld,%ld\n", am_names[am],
+				n.instructions, n.cycles, n.reads, n.writes );
+	}
+
+	for( int opc = 0; opc < 16; opc++ )
+		for( int am = 0; am <= COUNT_NO_AM; am++ ) {
+			const OpCount &n = c.pair[opc][am];
+
+			if( n.instructions > 0 )
+				fprintf( fp, "pair,%x,%s,%s,%ld,%ld,%ld,%ld\n", opc,
+					op_mnemonics[opc], am_names[am], n.instructions, n.cycles,
+					n.reads, n.writes );
+		}
+
+	if( fclose( fp ) != 0 ) {
+		fprintf( stderr, "Cannot write counts file %s\n", path );
+		return false;
+	}
+
+	return true;
+}
+
+//
+// op_counts_done() - the run is over: print the tables for --counts and
+// write them for --counts-csv.
+//
+
+void op_counts_done( FILE *out, const OpCounts &c, long total ) {
+	if( show_counts )
+		op_counts_report( out, c, total );
+	if( counts_file != NULL )
+		op_counts_csv( counts_file, c );
+}
@@ -0,0 +1,49 @@
+// op_counts.h
+//
+// Per op code and address mode accounting for --counts: how many
+// instructions of each (op code, address mode) pair ran, and the clock
+// ticks and memory reads and writes they took, fetch included.  The
+// per op code and per address mode tables are sums of the pairs, made
+// when the report is printed.
+//
+// Op codes that ignore the address mode bits are counted under
+// COUNT_NO_AM.  Cycles that belong to no instruction (loading the entry
+// point, the fetch that finds PC overflow) are left to the report to
+// work out from the run's total.
+
+#ifndef _OP_COUNTS_H
+#define _OP_COUNTS_H
+
+const int COUNT_NO_AM( 8 );		// column for op codes without an address mode
+
+struct OpCount {
+	long instructions;
+	long cycles;
+	long reads;
+	long writes;
+};
+
+struct OpCounts {
+	OpCount pair[16][COUNT_NO_AM + 1];	// [op code][address mode]
+};
+
+extern const char *const am_names[COUNT_NO_AM + 1];	// table row names
+
+//
+// op_counts_add() - count one instruction ir that took the given ticks,
+// reads and writes.
+//
+
+inline void op_counts_add( OpCounts &c, long ir, long cycles, long reads,
+	long writes ) {
+	const DecodeEntry &e = decode_table[ir & 0xff];
+	OpCount &n = c.pair[e.opc]
+		[( e.opc > 0 && e.opc < 10 ) ? e.am : COUNT_NO_AM];
+
+	n.instructions++;
+	n.cycles += cycles;
+	n.reads += reads;
+	n.writes += writes;
+}
+
+#endif
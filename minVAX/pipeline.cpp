@@ -0,0 +1,271 @@
+// pipeline.C
+//
+// --pipeline: the five-stage pipelined timing model and its report.  See
+// pipeline.h.
+
+#include "includes.h"
+
+static const char *const stall_names[PIPE_STALLS] = {
+	"two-byte fetch", "memory port", "store into code", "branch flush",
+	"ADDR from R0", "ADDR from R1", "R0 operand", "R1 operand"
+};
+
+// What the timing model needs to know about one instruction.
+struct PipeInstr {
+	long pc;				// where it was fetched from
+	int length;				// bytes
+	bool memory;			// does MEM read or write memory?
+	bool store;				// ... write it, at addr
+	long addr;
+	int exec;				// stage whose end RA's new value is ready at
+	int amReg;				// register the address mode reads, or -1
+	int raRead;				// RA, if the op code reads it, or -1
+	int raStage;			// the stage it is read in
+	int raWrite;			// RA, if the op code writes it, or -1
+	bool taken;				// is it a taken branch?
+};
+
+//
+// pipeline_reset() - nothing timed yet.  Both pipelines start as if an
+// instruction had gone into IF at cycle -1, so the first one is fetched
+// at cycle 0.
+//
+
+void pipeline_reset( Pipeline &p ) {
+	memset( &p, 0, sizeof( p ) );
+
+	for( int n = 0; n < 2; n++ ) {
+		PipeTiming &t = p.timing[n];
+
+		t.forward = ( n == 0 );
+		for( int st = 0; st < PIPE_STAGES; st++ )
+			t.stage[st] = st - 1;
+		t.redirect = -1;
+		for( int i = 0; i < PIPE_WINDOW; i++ )
+			t.port[i] = t.store[i] = -1;
+	}
+}
+
+//
+// pipe_fetch() - the first cycle from c on in which bytes first through
+// last can be fetched: one the MEM stage is not using memory in, and
+// after any store into them that is still in the pipeline, as far as
+// the causes before upto are modelled.
+//
+
+static long pipe_fetch( const PipeTiming &t, long c, long first, long last,
+	int upto ) {
+	bool moved = true;
+
+	while( moved ) {
+		moved = false;
+		for( int i = 0; i < PIPE_WINDOW; i++ ) {
+			if( STALL_PORT < upto && t.port[i] == c ) {
+				c++;
+				moved = true;
+			}
+			if( STALL_CODE < upto && t.store[i] >= c )
+				for( long a = first; a <= last; a++ )
+					if( ( a & 0xff ) == t.storeAddr[i] ) {
+						c = t.store[i] + 1;
+						moved = true;
+					}
+		}
+	}
+
+	return c;
+}
+
+//
+// pipe_operand() - hold s, when instruction stage st starts, until
+// register reg (none if -1), read in stage need, can be read.
+//
+
+static void pipe_operand( const PipeTiming &t, int reg, int need,
+	int cause, int st, int upto, long &s ) {
+	if( reg < 0 || cause >= upto )
+		return;
+	if( !t.forward )
+		need = PIPE_AM;
+	if( need == st && t.ready[reg] > s )
+		s = t.ready[reg];
+}
+
+//
+// pipe_schedule() - when instruction in enters each stage of pipeline
+// t, with the causes of stalls before upto modelled.
+//
+
+static void pipe_schedule( const PipeTiming &t, const PipeInstr &in,
+	int upto, long *s ) {
+	long c = t.stage[PIPE_AM];
+
+	if( STALL_BRANCH < upto && t.redirect > c )
+		c = t.redirect;
+
+	// fetch one byte a cycle, or both bytes at once if that is not
+	// modelled yet
+	if( STALL_FETCH < upto ) {
+		s[PIPE_IF] = c = pipe_fetch( t, c, in.pc, in.pc, upto );
+		for( int b = 1; b < in.length; b++ )
+			c = pipe_fetch( t, c + 1, in.pc + b, in.pc + b, upto );
+	}
+	else
+		s[PIPE_IF] = c = pipe_fetch( t, c, in.pc, in.pc + in.length - 1,
+			upto );
+
+	// each later stage once the instruction is through the one before
+	// and the instruction ahead has moved on, and its operands are ready
+	for( int st = PIPE_AM; st < PIPE_STAGES; st++ ) {
+		s[st] = ( ( st == PIPE_AM ) ? c : s[st - 1] ) + 1;
+		if( st < PIPE_WB && t.stage[st + 1] > s[st] )
+			s[st] = t.stage[st + 1];
+		if( st == PIPE_WB && t.stage[PIPE_WB] + 1 > s[st] )
+			s[st] = t.stage[PIPE_WB] + 1;
+
+		pipe_operand( t, in.amReg, PIPE_EA, STALL_ADDR_R0 + in.amReg, st,
+			upto, s[st] );
+		pipe_operand( t, in.raRead, in.raStage, STALL_R0 + in.raRead, st,
+			upto, s[st] );
+	}
+}
+
+//
+// pipe_time() - run instruction in through pipeline t, charging the
+// cycles its WB falls behind the last one's to the causes, and return
+// what flushing after the last instruction, if it was a taken branch,
+// cost.
+//
+
+static long pipe_time( PipeTiming &t, const PipeInstr &in ) {
+	long s[PIPE_STAGES];
+	long last = t.stage[PIPE_WB] + 1;
+	long flush = 0;
+
+	for( int cause = 0; cause < PIPE_STALLS; cause++ ) {
+		pipe_schedule( t, in, cause + 1, s );
+		t.stalls[cause] += s[PIPE_WB] - last;
+		if( cause == STALL_BRANCH )
+			flush = s[PIPE_WB] - last;
+		last = s[PIPE_WB];
+	}
+
+	for( int st = 0; st < PIPE_STAGES; st++ )
+		t.stage[st] = s[st];
+
+	if( in.raWrite >= 0 )
+		t.ready[in.raWrite] = t.forward ? s[in.exec] + 1 : s[PIPE_WB];
+	t.redirect = in.taken ? s[PIPE_EA] + 1 : -1;
+
+	for( int i = PIPE_WINDOW - 1; i > 0; i-- ) {
+		t.port[i] = t.port[i - 1];
+		t.store[i] = t.store[i - 1];
+		t.storeAddr[i] = t.storeAddr[i - 1];
+	}
+	t.port[0] = in.memory ? s[PIPE_MEM] : -1;
+	t.store[0] = in.store ? s[PIPE_MEM] : -1;
+	t.storeAddr[0] = in.addr;
+
+	return flush;
+}
+
+//
+// pipeline_add() - instruction ir at pc retired, leaving PC at next and
+// ADDR holding addr (STR's effective address).  JMP is always taken; a
+// BEZ or BLT is taken if PC did not go on to the next instruction, so
+// one to the next instruction counts as not taken.  One with an address
+// mode the decoder rejects stops the machine, and is not counted as a
+// branch at all.
+//
+
+void pipeline_add( Pipeline &p, long pc, long ir, long next, long addr ) {
+	const DecodeEntry &e = decode_table[ir & 0xff];
+	bool usesAm = ( e.opc > 0 && e.opc < 10 );
+	bool branch = ( e.opc >= 7 && e.opc <= 9 && e.status == DECODE_OK );
+	PipeInstr in;
+
+	in.pc = pc;
+	in.length = e.length;
+	in.memory = ( e.reads > e.length || e.writes > 0 );
+	in.store = ( e.writes > 0 );
+	in.addr = addr & 0xff;
+	in.exec = ( e.reads > e.length ) ? PIPE_MEM : PIPE_EA;
+	in.amReg = ( usesAm && e.am < 4 ) ? ( e.am & 1 ) : -1;
+
+	in.raRead = e.ra;
+	if( e.opc >= 1 && e.opc <= 4 )
+		in.raStage = in.exec;
+	else if( e.opc == 6 )
+		in.raStage = PIPE_MEM;
+	else if( e.opc == 8 || e.opc == 9 || ( e.opc >= 12 && e.opc <= 14 ) )
+		in.raStage = PIPE_EA;
+	else
+		in.raRead = -1;
+
+	in.raWrite = ( ( e.opc >= 1 && e.opc <= 5 ) ||
+		( e.opc >= 11 && e.opc <= 13 ) ) ? e.ra : -1;
+
+	in.taken = branch && ( e.opc == 7 ||
+		( next & 0xff ) != ( ( pc + e.length ) & 0xff ) );
+
+	p.instructions++;
+	if( branch ) {
+		if( in.taken )
+			p.taken[e.opc]++;
+		else
+			p.notTaken[e.opc]++;
+	}
+
+	for( int n = 0; n < 2; n++ )
+		p.timing[n].penalty[p.lastOpc] += pipe_time( p.timing[n], in );
+	p.lastOpc = e.opc;
+}
+
+//
+// pipeline_report() - print the cycles, CPI and stalls of both
+// pipelines, and the branches and what their flushes cost.  cycles is
+// the run's on the multi-cycle model, for comparison.
+//
+
+void pipeline_report( FILE *out, const Pipeline &p, long cycles ) {
+	long total[2];
+
+	if( p.instructions == 0 )
+		return;
+
+	for( int n = 0; n < 2; n++ )
+		total[n] = p.timing[n].stage[PIPE_WB] + 1;
+
+	fprintf( out, "\nPipeline (IF AM EA MEM WB), %ld instructions:\n"
+		"  %-18s %14s %14s\n", p.instructions, "", "forwarding",
+		"no forwarding" );
+	fprintf( out, "  %-18s %14ld %14ld\n", "cycles", total[0], total[1] );
+	fprintf( out, "  %-18s %14.2f %14.2f\n", "CPI",
+		(double)total[0] / p.instructions, (double)total[1] / p.instructions );
+	fprintf( out, "  %-18s %14d %14d\n", "pipeline fill", PIPE_STAGES - 1,
+		PIPE_STAGES - 1 );
+
+	for( int cause = 0; cause < PIPE_STALLS; cause++ )
+		fprintf( out, "  %-18s %14ld %14ld\n", stall_names[cause],
+			p.timing[0].stalls[cause], p.timing[1].stalls[cause] );
+
+	fprintf( out, "  multi-cycle model: %ld cycles, CPI %.2f (%.2fx the"
+		" forwarding pipeline's)\n", cycles, (double)cycles / p.instructions,
+		(double)cycles / total[0] );
+
+	if( p.taken[7] + p.taken[8] + p.taken[9] + p.notTaken[8] +
+	    p.notTaken[9] == 0 )
+		return;
+
+	fprintf( out, "\nBranches, with forwarding:\n  %-6s %10s %10s %14s %14s\n",
+		"", "taken", "not taken", "flush cycles", "per taken" );
+	for( int opc = 7; opc <= 9; opc++ ) {
+		const long *penalty = p.timing[0].penalty;
+
+		if( p.taken[opc] + p.notTaken[opc] == 0 )
+			continue;
+		fprintf( out, "  %-6s %10ld %10ld %14ld %14.2f\n", op_mnemonics[opc],
+			p.taken[opc], p.notTaken[opc], penalty[opc], p.taken[opc] > 0 ?
+			(double)penalty[opc] / p.taken[opc] : 0.0 );
+	}
+}
@@ -0,0 +1,81 @@
+// pipeline.h
+//
+// Five-stage pipelined timing model for --pipeline.
+//
+// The machine is still simulated by the RTL model or the fast engine;
+// every instruction they retire is also fed, with where it was fetched
+// from, where PC went and what ADDR ended up holding, to a timing model
+// of a pipelined minVAX:
+//
+//   IF   fetch the instruction byte, and the immediate byte if any,
+//        one byte a cycle
+//   AM   decode; read the register a register mode address mode uses
+//   EA   compute the effective address (Rn or PC + immediate); ops
+//        on a register, an immediate or nothing do their ALU work here;
+//        JMP, BEZ and BLT resolve here
+//   MEM  read the operand a memory address mode points to, or LDR's
+//        data, or write STR's; ops on that operand do their ALU work
+//        at the end of the stage
+//   WB   write RA
+//
+// Memory has one port, so a MEM stage read or write holds up IF for the
+// cycle.  Fetch goes on sequentially past a branch, so a taken JMP, BEZ
+// or BLT flushes what came in behind it and fetching restarts at the
+// target once EA has resolved it.  A STR into a byte already fetched
+// flushes it too.
+//
+// R0 and R1 hazards are checked wherever they are read: as RA, and
+// where an address mode moves them into ADDR (or adds them to the
+// immediate for it).  With forwarding a value can be used the cycle
+// after the stage that computes it ends; without, only once WB has
+// written it back, and registers are read in AM.  ADDR itself travels
+// down the pipeline with its instruction.
+//
+// Two pipelines, with and without forwarding, are timed side by side.
+// The cycles each instruction's WB falls behind the one before it are
+// charged to the causes in PipeStall order: each cause is added to the
+// schedule in turn, and charged what it adds.  So the stalls, plus one
+// cycle per instruction and the four it takes to fill the pipeline,
+// add up to the run's cycles.
+
+#ifndef _PIPELINE_H
+#define _PIPELINE_H
+
+enum PipeStage { PIPE_IF, PIPE_AM, PIPE_EA, PIPE_MEM, PIPE_WB, PIPE_STAGES };
+
+// Why an instruction is late, in the order the stalls are charged.
+enum PipeStall {
+	STALL_FETCH,		// second byte of a two-byte instruction
+	STALL_PORT,			// IF waiting for a MEM stage read or write
+	STALL_CODE,			// refetch after a STR into fetched bytes
+	STALL_BRANCH,		// flush after a taken branch
+	STALL_ADDR_R0,		// an address mode waiting for R0
+	STALL_ADDR_R1,		// an address mode waiting for R1
+	STALL_R0,			// RA = R0 not ready
+	STALL_R1,			// RA = R1 not ready
+	PIPE_STALLS
+};
+
+const int PIPE_WINDOW( 4 );		// instructions a fetch can overlap
+
+struct PipeTiming {
+	bool forward;					// forwarding paths?
+	long stage[PIPE_STAGES];		// when the last instruction entered each
+	long ready[2];					// when R0 and R1 can next be read
+	long redirect;					// first fetch after a taken branch, or -1
+	long port[PIPE_WINDOW];			// MEM cycles that use memory, or -1
+	long store[PIPE_WINDOW];		// MEM cycles that store, or -1
+	long storeAddr[PIPE_WINDOW];	// where
+	long stalls[PIPE_STALLS];		// cycles charged to each cause
+	long penalty[16];				// branch flush cycles per op code
+};
+
+struct Pipeline {
+	PipeTiming timing[2];			// with forwarding, and without
+	long instructions;
+	int lastOpc;					// op code of the last instruction
+	long taken[16];					// branches per op code
+	long notTaken[16];
+};
+
+#endif
@@ -0,0 +1,257 @@
+// predictor.C
+//
+// --predict: the branch predictors, what their mispredictions cost, and
+// the report.  See predictor.h.
+
+#include "includes.h"
+
+static const char *const predict_names[] = {
+	"taken", "not-taken", "btfn", "bimodal", "gshare"
+};
+
+//
+// predictor_parse() - read a KIND[:BITS] predictor description.  Returns
+// false unless KIND is one of predict_names[], and BITS, which only
+// bimodal and gshare take, is from 1 to PREDICT_MAX_BITS.
+//
+
+bool predictor_parse( const char *spec, int &kind, int &bits ) {
+	const char *colon = strchr( spec, ':' );
+	size_t len = ( colon != NULL ) ? (size_t)( colon - spec ) : strlen( spec );
+	char extra;
+
+	kind = -1;
+	for( int k = PREDICT_TAKEN; k <= PREDICT_GSHARE; k++ )
+		if( strlen( predict_names[k] ) == len &&
+		    strncmp( spec, predict_names[k], len ) == 0 )
+			kind = k;
+	if( kind < 0 )
+		return false;
+
+	bits = PREDICT_BITS;
+	if( colon != NULL && ( ( kind != PREDICT_BIMODAL &&
+	    kind != PREDICT_GSHARE ) || sscanf( colon + 1, "%d%c", &bits,
+	    &extra ) != 1 ) )
+		return false;
+
+	return bits >= 1 && bits <= PREDICT_MAX_BITS;
+}
+
+//
+// predictor_reset() - the predictor the options describe, with every
+// counter weakly not taken and the BTB empty.
+//
+
+void predictor_reset( Predictor &bp ) {
+	memset( &bp, 0, sizeof( bp ) );
+	predictor_parse( predict_spec, bp.kind, bp.bits );
+	bp.penalty = branch_penalty;
+	bp.btbSize = btb_size;
+
+	memset( bp.counter, 1, sizeof( bp.counter ) );
+	for( int i = 0; i < PREDICT_SITES; i++ )
+		bp.btbPC[i] = -1;
+}
+
+//
+// predict_direction() - will the branch at pc to target, op code opc, be
+// taken?  index gets the counter a bimodal or gshare prediction used.
+//
+
+static bool predict_direction( const Predictor &bp, long pc, int opc,
+	long target, unsigned int &index ) {
+	unsigned int mask = ( 1 << bp.bits ) - 1;
+
+	if( opc == 7 )
+		return true;
+
+	switch( bp.kind ) {
+		case PREDICT_TAKEN:		return true;
+		case PREDICT_NOT_TAKEN:	return false;
+		case PREDICT_BTFN:		return target <= pc;
+		case PREDICT_BIMODAL:	index = pc & mask;						break;
+		default:				index = ( pc ^ bp.history ) & mask;	break;
+	}
+
+	return bp.counter[index] >= 2;
+}
+
+//
+// predict_branch() - instruction ir at pc retired, going to target if
+// taken.  If it is a branch, predict it as it would have been when it
+// was fetched, train the predictor and the BTB on what it did, and
+// count it.  Returns the cycles a misprediction costs, or 0.
+//
+
+long predict_branch( Predictor &bp, long pc, long ir, bool taken,
+	long target ) {
+	const DecodeEntry &e = decode_table[ir & 0xff];
+	unsigned int index = 0;
+
+	if( e.opc < 7 || e.opc > 9 || e.status != DECODE_OK )
+		return 0;
+
+	pc &= 0xff;
+	target &= 0xff;
+
+	bool direction = predict_direction( bp, pc, e.opc, target, index );
+	bool predicted = direction;
+	bool wrongTarget = false;
+	long entry = pc & ( bp.btbSize - 1 );
+
+	// without a BTB entry for it, fetch cannot be redirected
+	if( predicted && bp.btbSize > 0 ) {
+		if( bp.btbPC[entry] != pc )
+			predicted = false;
+		else if( taken && bp.btbTarget[entry] != target )
+			wrongTarget = true;
+	}
+
+	bool mispredicted = ( predicted != taken ) || wrongTarget;
+
+	if( mispredicted && taken && direction )
+		bp.btbMisses++;
+	if( taken && bp.btbSize > 0 ) {
+		bp.btbPC[entry] = pc;
+		bp.btbTarget[entry] = target;
+	}
+
+	if( e.opc != 7 ) {
+		unsigned char &c = bp.counter[index];
+
+		if( bp.kind == PREDICT_BIMODAL || bp.kind == PREDICT_GSHARE ) {
+			if( taken && c < 3 )
+				c++;
+			else if( !taken && c > 0 )
+				c--;
+		}
+		bp.history = ( bp.history << 1 ) | taken;
+	}
+
+	BranchSite &s = bp.site[pc];
+
+	s.opc = e.opc;
+	s.executions++;
+	bp.branches[e.opc]++;
+	if( taken ) {
+		s.taken++;
+		bp.taken[e.opc]++;
+	}
+	if( !mispredicted )
+		return 0;
+
+	s.mispredicts++;
+	bp.mispredicts[e.opc]++;
+	bp.cycles += bp.penalty;
+	return bp.penalty;
+}
+
+//
+// predict_rtl() - the RTL model has executed the branch in savedIR,
+// taken or not: predict it, and stall for a misprediction.
+//
+
+void predict_rtl( CpuContext &cpu, bool taken ) {
+	long ticks = predict_branch( *cpu.predictor, cpu.savedPC, cpu.savedIR,
+		taken, cpu.addr.value() );
+
+	while( ticks-- > 0 )
+		cpu_tick( cpu );
+}
+
+//
+// predict_fast() - the fast engine has retired the instruction in
+// savedIR: if it is a branch, predict it and return what a misprediction
+// costs.  BEZ and BLT leave RA alone, so it still says which way they
+// went.
+//
+
+long predict_fast( Predictor &bp, const FastCpu &cpu ) {
+	const DecodeEntry &e = decode_table[cpu.savedIR & 0xff];
+	long ra = ( e.ra == 0 ) ? cpu.r0 : cpu.r1;
+	bool taken = ( e.opc == 7 ) || ( e.opc == 8 && ra == 0 ) ||
+		( e.opc == 9 && ( ra & 0x80 ) != 0 );
+
+	return predict_branch( bp, cpu.savedPC, cpu.savedIR, taken, cpu.addr );
+}
+
+//
+// by_mispredicts() - qsort() order for branch sites: most mispredictions
+// first, then most executions, then lowest address.
+//
+
+static const Predictor *sort_predictor;
+
+static int by_mispredicts( const void *a, const void *b ) {
+	const BranchSite *x = &sort_predictor->site[*(const long *)a];
+	const BranchSite *y = &sort_predictor->site[*(const long *)b];
+
+	if( x->mispredicts != y->mispredicts )
+		return ( x->mispredicts > y->mispredicts ) ? -1 : 1;
+	if( x->executions != y->executions )
+		return ( x->executions > y->executions ) ? -1 : 1;
+	return ( x < y ) ? -1 : ( x > y );
+}
+
+//
+// predictor_report() - print the branches, mispredictions and accuracy
+// per op code, what the mispredictions cost, and every branch site, most
+// mispredicted first.  cycles is the run's cycle count.
+//
+
+void predictor_report( FILE *out, const Predictor &bp, long cycles ) {
+	long order[PREDICT_SITES];
+	long branches = 0, taken = 0, mispredicts = 0, n = 0;
+	char name[32];
+
+	sprintf( name, "%s", predict_names[bp.kind] );
+	if( bp.kind == PREDICT_BIMODAL || bp.kind == PREDICT_GSHARE )
+		sprintf( name + strlen( name ), ":%d", bp.bits );
+
+	fprintf( out, "\nBranch prediction (%s", name );
+	if( bp.btbSize > 0 )
+		fprintf( out, ", %ld-entry BTB", bp.btbSize );
+	fprintf( out, ", %ld cycles a misprediction):\n"
+		"  %-6s %12s %12s %12s %9s\n", bp.penalty, "", "branches", "taken",
+		"mispredicts", "accuracy" );
+
+	for( int opc = 7; opc <= 9; opc++ ) {
+		if( bp.branches[opc] == 0 )
+			continue;
+		fprintf( out, "  %-6s %12ld %12ld %12ld %8.2f%%\n", op_mnemonics[opc],
+			bp.branches[opc], bp.taken[opc], bp.mispredicts[opc],
+			100.0 - 100.0 * bp.mispredicts[opc] / bp.branches[opc] );
+
+		branches += bp.branches[opc];
+		taken += bp.taken[opc];
+		mispredicts += bp.mispredicts[opc];
+	}
+
+	if( branches == 0 )
+		return;
+
+	fprintf( out, "  %-6s %12ld %12ld %12ld %8.2f%%\n", "all", branches, taken,
+		mispredicts, 100.0 - 100.0 * mispredicts / branches );
+	fprintf( out, "  %ld cycles of penalty, %.1f%% of %ld cycles\n", bp.cycles,
+		cycles > 0 ? 100.0 * bp.cycles / cycles : 0.0, cycles );
+	if( bp.btbSize > 0 )
+		fprintf( out, "  %ld taken branches predicted taken that the BTB had no"
+			" target or the wrong one for\n", bp.btbMisses );
+
+	for( long pc = 0; pc < PREDICT_SITES; pc++ )
+		if( bp.site[pc].executions > 0 )
+			order[n++] = pc;
+	sort_predictor = &bp;
+	qsort( order, n, sizeof( order[0] ), by_mispredicts );
+
+	fprintf( out, "\nBranch sites, most mispredicted first:\n"
+		"  %-4s %-4s %12s %12s %12s %9s\n", "addr", "op", "executions",
+		"taken", "mispredicts", "accuracy" );
+	for( long i = 0; i < n; i++ ) {
+		const BranchSite &s = bp.site[order[i]];
+
+		fprintf( out, "  %02lx   %-4s %12ld %12ld %12ld %8.2f%%\n", order[i],
+			op_mnemonics[s.opc], s.executions, s.taken, s.mispredicts,
+			100.0 - 100.0 * s.mispredicts / s.executions );
+	}
+}
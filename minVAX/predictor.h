@@ -0,0 +1,71 @@
+// predictor.h
+//
+// Branch prediction for --predict.
+//
+// The minVAX resolves a branch as it executes it, at no extra cost.
+// With --predict=KIND every JMP, BEZ and BLT the RTL model or the fast
+// engine retires is also run past a branch predictor, as if it had been
+// predicted when it was fetched, and each misprediction costs
+// --penalty=N more cycles (default 2), charged to the run's cycle count:
+//
+//   taken       every branch taken
+//   not-taken   every BEZ and BLT not taken
+//   btfn        backward (to a lower address) taken, forward not taken
+//   bimodal     a table of 2-bit counters indexed by the low bits of PC
+//   gshare      the same, indexed by PC exclusive-or the outcomes of the
+//               last conditional branches
+//
+// bimodal and gshare take :BITS for the size of the table (default 6, so
+// 64 counters), which for gshare is also the length of the history.
+// JMP is unconditional and always predicted taken.
+//
+// --btb=N adds an N-entry direct-mapped branch target buffer: a branch
+// predicted taken is only redirected to the target the BTB holds for
+// it, so a BTB miss falls through as if predicted not taken, and a
+// wrong target (the target comes from the address mode, and can move
+// with R0 or R1) is a misprediction too.  The BTB learns the targets of
+// taken branches.
+//
+// A branch whose address mode the decoder rejects stops the machine and
+// is not predicted.
+
+#ifndef _PREDICTOR_H
+#define _PREDICTOR_H
+
+enum PredictKind {
+	PREDICT_TAKEN, PREDICT_NOT_TAKEN, PREDICT_BTFN, PREDICT_BIMODAL,
+	PREDICT_GSHARE
+};
+
+const int PREDICT_SITES( 256 );		// one per address
+const int PREDICT_BITS( 6 );		// default bimodal and gshare table bits
+const int PREDICT_MAX_BITS( 12 );
+
+struct BranchSite {
+	long executions;
+	long taken;
+	long mispredicts;
+	int opc;
+};
+
+struct Predictor {
+	int kind;						// PredictKind
+	int bits;						// table and history bits
+	unsigned char counter[1 << PREDICT_MAX_BITS];	// 0-1 not taken, 2-3 taken
+	unsigned int history;			// last outcomes, newest in bit 0
+	long penalty;					// cycles a misprediction costs
+
+	long btbSize;					// BTB entries, or 0 for none
+	long btbPC[PREDICT_SITES];		// branch each entry holds, or -1
+	long btbTarget[PREDICT_SITES];
+
+	long branches[16];				// per op code
+	long taken[16];
+	long mispredicts[16];
+	long btbMisses;					// taken branches the BTB could not redirect
+	long cycles;					// penalty cycles charged
+
+	BranchSite site[PREDICT_SITES];
+};
+
+#endif
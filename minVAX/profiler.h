@@ -0,0 +1,48 @@
+// profiler.h
+//
+// Guest program hot-spot profiler for --profile and --profile-folded.
+//
+// Every instruction that retires adds one execution and the clock ticks
+// it took (fetch included) to the address it was fetched from.  A JMP,
+// BEZ or BLT also marks both where it went and the address after it as
+// basic block leaders, as does the entry point, so when the run is over
+// the executed addresses can be cut into the basic blocks the program
+// actually ran, each ending at a branch, a HLT, or the next leader.
+
+#ifndef _PROFILER_H
+#define _PROFILER_H
+
+const unsigned int PROFILE_SIZE( 256 );		// one slot per address
+
+struct Profile {
+	long count[PROFILE_SIZE];	// executions of the instruction at each address
+	long cycles[PROFILE_SIZE];	// ticks they took
+	long target[PROFILE_SIZE];	// where a branch there last went, or -1
+	unsigned char ir[PROFILE_SIZE];	// instruction byte last executed there
+	bool leader[PROFILE_SIZE];	// does a basic block start here?
+};
+
+//
+// profile_add() - instruction ir at pc retired after the given ticks,
+// leaving PC at next.
+//
+
+inline void profile_add( Profile &p, long pc, long ir, long cycles,
+	long next ) {
+	const DecodeEntry &e = decode_table[ir & 0xff];
+
+	pc &= PROFILE_SIZE - 1;
+	p.count[pc]++;
+	p.cycles[pc] += cycles;
+	p.ir[pc] = ir;
+
+	if( e.opc >= 7 && e.opc <= 9 ) {
+		next &= PROFILE_SIZE - 1;
+		p.leader[next] = true;
+		p.leader[( pc + e.length ) & ( PROFILE_SIZE - 1 )] = true;
+		if( next != ( ( pc + e.length ) & ( PROFILE_SIZE - 1 ) ) )
+			p.target[pc] = next;
+	}
+}
+
+#endif
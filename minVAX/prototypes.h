@@ -10,9 +10,83 @@
 #ifndef _PROTOTYPES_H
 #define _PROTOTYPES_H
 
-void execute();
-void fetch_into( StorageObject &, Bus &, StorageObject & );
-void make_connections();
-void run_simulation( char * );
+void decode_cache_reset( DecodeCache & );
+DecodedInstr *decode_cache_lookup( DecodeCache &, long, long,
+	const unsigned char * );
+void decode_cache_invalidate( DecodeCache &, long );
+void decode_cache_report( FILE *, DecodeCache & );
+void decode_instr( DecodedInstr *, long, long, const unsigned char * );
+void block_cache_reset( BlockCache & );
+Block *block_cache_lookup( BlockCache &, long, const unsigned char * );
+void block_cache_invalidate( BlockCache &, long );
+void block_cache_report( FILE *, BlockCache &, long );
+void jit_reset( JitCache & );
+JitCode jit_compile( FastCpu &, Block * );
+void jit_release( JitCache & );
+void jit_report( FILE *, JitCache & );
+void fetch_into( CpuContext &, StorageObject &, Bus &, StorageObject & );
+void fetch_overlapped( CpuContext &, StorageObject &, Bus &,
+	StorageObject & );
+void fetch_start( CpuContext & );
+void fetch_done( CpuContext &, StorageObject & );
+void make_connections( CpuContext & );
+void run_simulation( CpuContext &, char * );
+double host_seconds();
+
+void fast_reset( FastCpu & );
+bool fast_load( FastCpu &, char * );
+void fast_execute( FastCpu & );
+void fast_step( FastCpu & );
+void fast_trace( FastCpu &, const DecodedInstr *, bool );
+void fast_finish( FastCpu & );
+void fast_resume( FastCpu &, const char * );
+bool fast_run( FastCpu &, char *, long );
+void run_fast( char * );
+bool load_object( char *, unsigned char *, long & );
+bool is_image( const char * );
+bool write_image( const char *, const unsigned char *, long );
+long read_list( char *, char **& );
+int run_batch( char * );
+int run_lanes( char * );
+void snapshot_take( Snapshot &, const FastCpu & );
+void snapshot_fork( Snapshot &, const Snapshot & );
+void snapshot_poke( Snapshot &, long, long );
+void snapshot_restore( FastCpu &, const Snapshot & );
+void snapshot_free( Snapshot & );
+bool snapshot_save( Snapshot &, const char * );
+bool snapshot_load( Snapshot &, const char * );
+bool run_save( char *, char *, long );
+bool run_restore( char * );
+int run_variants( char *, char * );
+void op_counts_reset( OpCounts & );
+void op_counts_report( FILE *, const OpCounts &, long );
+bool op_counts_csv( const char *, const OpCounts & );
+void op_counts_done( FILE *, const OpCounts &, long );
+void profile_reset( Profile &, long );
+void profile_report( FILE *, const Profile &, long );
+bool profile_folded( const char *, const Profile &, const char * );
+void profile_done( FILE *, const Profile &, long, const char * );
+void pipeline_reset( Pipeline & );
+void pipeline_add( Pipeline &, long, long, long, long );
+void pipeline_report( FILE *, const Pipeline &, long );
+bool predictor_parse( const char *, int &, int & );
+void predictor_reset( Predictor & );
+long predict_branch( Predictor &, long, long, bool, long );
+void predict_rtl( CpuContext &, bool );
+long predict_fast( Predictor &, const FastCpu & );
+void predictor_report( FILE *, const Predictor &, long );
+void schedule_reset( TickSchedule &, long );
+void schedule_retire( TickSchedule &, long, long );
+void schedule_report( FILE *, const TickSchedule & );
+bool cache_parse( const char *, long &, long &, long & );
+void cache_reset( MemCache & );
+void cache_read( CpuContext &, int );
+void cache_write( CpuContext & );
+void cache_report( FILE *, const MemCache &, long );
+void latency_reset( LatencyStats & );
+void latency_report( FILE *, const LatencyStats & );
+bool cosim_start( CoSim &, CpuContext &, char * );
+bool cosim_step( CpuContext & );
+void cosim_done( FILE *, CpuContext & );
 
 #endif
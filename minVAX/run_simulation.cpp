@@ -11,54 +11,254 @@
 
 #include "includes.h"
 
-void run_simulation( char *objfile ) {
+#include <sys/time.h>
+
+//
+// host_seconds() - wall clock time, for the instructions per second
+// figure printed with --stats.
+//
+
+double host_seconds() {
+	struct timeval tv;
+
+	gettimeofday( &tv, NULL );
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+//
+// FETCH() - fetch the next instruction into ir, stop on PC overflow,
+// save PC and IR for the trace, bump PC and look the instruction up in
+// the decode cache.  See dispatch.h for INSTR() and NEXT().  With
+// --overlap the read goes with the PC increment, and if RETIRE() has
+// moved PC into MAR already, the first tick is skipped.  With --compact
+// it marks where the instruction's transfers start depending on IR.
+//
+// RETIRE() - the instruction's final tick, the trace line, and with
+// --counts the ticks, reads and writes since FETCH(); with --profile the
+// ticks and where PC went; with --pipeline the instruction goes through
+// the pipelined timing model; with --compact its recorded transfers are
+// packed into as few ticks as they fit; with --cosim the fast engine steps through
+// the same instruction, and the run stops if the two differ.  With
+// --overlap the final tick, which has nothing else to do, also starts
+// the next instruction's fetch, unless the machine has stopped.
+//
+// With --latency both also time their stage of the instruction on the
+// host, as rtl_instr() does the address mode routine.
+//
+
+#define FETCH() \
+	if( cpu.latency != NULL ) \
+		latency_begin( *cpu.latency ); \
+	cycles = cpu.cycles; \
+	reads = cpu.reads; \
+	writes = cpu.writes; \
+	fetch_overlapped( cpu, cpu.pc, cpu.abus, cpu.ir ); \
+	if( cpu.pc.overflow() ) \
+		goto overflow; \
+	cpu.savedPC = cpu.pc.value(); \
+	register_incr( cpu, cpu.pc ); \
+	cpu_tick( cpu ); \
+	fetch_done( cpu, cpu.ir ); \
+	if( cpu.schedule != NULL ) \
+		cpu.schedule->fetched = cpu.schedule->count; \
+	cpu.savedIR = cpu.ir.value(); \
+	di = decode_cache_lookup( cpu.decode_cache, cpu.savedPC, cpu.savedIR, \
+		NULL ); \
+	if( cpu.latency != NULL ) \
+		latency_end( *cpu.latency, cpu.latency->fetch ); \
+	count++
+
+#define RETIRE() \
+	if( overlap_fetch && !cpu.done ) \
+		fetch_start( cpu ); \
+	cpu_tick( cpu ); \
+	if( cpu.latency != NULL ) \
+		latency_retire( *cpu.latency, di->opc ); \
+	trace_retire( cpu.trace, cpu.savedPC, cpu.savedIR, cpu.r0.value(), \
+		cpu.r1.value() ); \
+	if( counts != NULL ) \
+		op_counts_add( *counts, cpu.savedIR, cpu.cycles - cycles, \
+			cpu.reads - reads, cpu.writes - writes ); \
+	if( profile != NULL ) \
+		profile_add( *profile, cpu.savedPC, cpu.savedIR, \
+			cpu.cycles - cycles, cpu.pc.value() ); \
+	if( pipeline != NULL ) \
+		pipeline_add( *pipeline, cpu.savedPC, cpu.savedIR, cpu.pc.value(), \
+			cpu.addr.value() ); \
+	if( cpu.schedule != NULL ) \
+		schedule_retire( *cpu.schedule, cpu.savedIR, cpu.cycles ); \
+	if( cpu.cosim != NULL && !cosim_step( cpu ) ) \
+		goto halted
+
+void run_simulation( CpuContext &cpu, char *objfile ) {
+	DecodedInstr *di;
+	OpCounts *counts = NULL;
+	Profile *profile = NULL;
+	Pipeline *pipeline = NULL;
+	long count = 0, cycles, reads, writes;
+	double start;
 
 	// step 1:  load the object file
 
-	m.load( objfile );
+	cpu.m.load( objfile );
+	decode_cache_reset( cpu.decode_cache );
+	cpu.fetchStarted = false;
 
 	// step 2:  set the entry point
 	// get the address of entry point into pc
 	
-	aux.latchFrom( m.READ() );
-	Clock::tick();
+	cpu.aux.latchFrom( cpu.m.READ() );
+	cpu_tick( cpu );
 	
-	abus.IN().pullFrom( aux );
-	pc.latchFrom ( abus.OUT() );
-	Clock::tick();
+	transfer( cpu, cpu.abus, cpu.aux, cpu.pc );
+	cpu_tick( cpu );
+
+	// Memory::load() has already printed the entry point
+	trace_start( cpu.trace, cpu.pc.value(), false );
 
 	// step 3:  continue fetching, decoding, and executing instructions
 	// until we stop the simulation
+	//
+	// instruction fetch goes directly into ir; mdr is not needed anymore
 
-	while( !done ) {
+	if( show_counts || counts_file != NULL ) {
+		counts = new OpCounts;
+		op_counts_reset( *counts );
+	}
 
-		// instruction fetch into ir
-		// mdr is not needed anymore, since we can directly write into ir
+	if( show_profile || profile_file != NULL ) {
+		profile = new Profile;
+		profile_reset( *profile, cpu.pc.value() );
+	}
 
-		fetch_into( pc, abus, ir );
+	if( show_pipeline ) {
+		pipeline = new Pipeline;
+		pipeline_reset( *pipeline );
+	}
 
-		// check for PC overflow
-		
-		if ( pc.overflow() ) {
-			cout << endl << "MACHINE HALTED due to PC overflow" << endl << endl;
-			done = true;
-			break;
-		}
+	if( compact_ticks ) {
+		cpu.schedule = new TickSchedule;
+		schedule_reset( *cpu.schedule, cpu.cycles );
+	}
+
+	if( cache_spec != NULL || icache_spec != NULL || dcache_spec != NULL ) {
+		cpu.cache = new MemCache;
+		cache_reset( *cpu.cache );
+	}
 
-		// save the instruction's address (pc) and data (memory data register) 
-		// values in hexadecimal
-		
-		savedPC = pc.value();
-		savedIR = ir.value();
+	if( predict_spec != NULL ) {
+		cpu.predictor = new Predictor;
+		predictor_reset( *cpu.predictor );
+	}
+
+	if( show_latency ) {
+		cpu.latency = new LatencyStats;
+		latency_reset( *cpu.latency );
+	}
+
+	start = host_seconds();
 
-		// bump PC for next instruction
-		
-		pc.incr();
-		Clock::tick();
+#ifdef THREADED_DISPATCH
+	static void *const dispatch[16] = INSTR_LABELS;
+
+	NEXT();
+#else
+	for( ;; ) {
+		FETCH();
+
+		switch( instr_class[di->opc] ) {
+#endif
 
 		// decode and execute
-		
-		execute();
-		printf("\n");
+
+		INSTR( INSTR_PLAIN )
+			di->handler( cpu, di );
+			RETIRE();
+			NEXT();
+
+		INSTR( INSTR_CHECKED )
+			di->handler( cpu, di );
+			RETIRE();
+			if( cpu.done )
+				goto halted;
+			NEXT();
+
+		INSTR( INSTR_HALT )
+			di->handler( cpu, di );
+			RETIRE();
+			goto halted;
+
+#ifndef THREADED_DISPATCH
+		}
+	}
+#endif
+
+overflow:
+	trace_overflow( cpu.trace );
+	cpu.done = true;
+
+halted:
+	trace_end( cpu.trace );
+
+	if( show_stats ) {
+		double elapsed = host_seconds() - start;
+
+		printf( "%ld instructions in %.3f s host time (%.0f instructions/sec)\n",
+			count, elapsed, elapsed > 0 ? count / elapsed : 0.0 );
+		decode_cache_report( stdout, cpu.decode_cache );
+	}
+
+	if( counts != NULL ) {
+		op_counts_done( stdout, *counts, cpu.cycles );
+		delete counts;
+	}
+
+	if( profile != NULL ) {
+		profile_done( stdout, *profile, cpu.cycles, objfile );
+		delete profile;
+	}
+
+	if( pipeline != NULL ) {
+		pipeline_report( stdout, *pipeline, cpu.cycles );
+		delete pipeline;
+	}
+
+	if( cpu.schedule != NULL ) {
+		schedule_report( stdout, *cpu.schedule );
+		delete cpu.schedule;
+		cpu.schedule = NULL;
+	}
+
+	if( cpu.cache != NULL )
+		cache_report( stdout, *cpu.cache, cpu.cycles );
+
+	if( cpu.predictor != NULL )
+		predictor_report( stdout, *cpu.predictor, cpu.cycles );
+
+	if( cpu.latency != NULL ) {
+		latency_report( stdout, *cpu.latency );
+		delete cpu.latency;
+		cpu.latency = NULL;
+	}
+
+	if( overlap_fetch ) {
+		long baseline = cpu.cycles + cpu.overlapped;
+
+		printf( "\nFetch overlap: %ld cycles, %ld without overlap (%ld saved,"
+			" %.1f%%)\n", cpu.cycles, baseline, cpu.overlapped,
+			baseline > 0 ? 100.0 * cpu.overlapped / baseline : 0.0 );
+	}
+
+	if( cpu.cosim != NULL )
+		cosim_done( stdout, cpu );
+
+	if( cpu.cache != NULL ) {
+		delete cpu.cache;
+		cpu.cache = NULL;
+	}
+
+	if( cpu.predictor != NULL ) {
+		delete cpu.predictor;
+		cpu.predictor = NULL;
 	}
 }
@@ -0,0 +1,450 @@
+// snapshot.C
+//
+// Machine snapshots for the fast engine: taking, forking with
+// copy-on-write memory pages, poking, restoring, and saving to and
+// loading from a file (see snapshot.h), and the three ways minVAX uses
+// them:
+//
+//   --save=FILE --at=N      run N instructions and save the machine
+//   --restore=FILE          run a saved machine on to the halt
+//   --variants=LIST         run one fork of the saved machine per line
+//                           of LIST, each with its own changes
+
+#include "includes.h"
+
+const char SNAP_MAGIC[4] = { 'M', 'V', 'S', '1' };
+
+//
+// snapshot_regs() - the register fields of s, in file order.
+//
+
+static void snapshot_regs( Snapshot &s, long *reg[SNAP_REGS] ) {
+	reg[0] = &s.aux;
+	reg[1] = &s.ir;
+	reg[2] = &s.addr;
+	reg[3] = &s.r0;
+	reg[4] = &s.r1;
+	reg[5] = &s.pc;
+	reg[6] = &s.pcOverflow;
+	reg[7] = &s.done;
+	reg[8] = &s.immediate;
+	reg[9] = &s.savedPC;
+	reg[10] = &s.savedIR;
+	reg[11] = &s.cycles;
+	reg[12] = &s.instructions;
+}
+
+//
+// snapshot_take() - the state of cpu, in pages of its own.
+//
+
+void snapshot_take( Snapshot &s, const FastCpu &cpu ) {
+	s.aux = cpu.aux;
+	s.ir = cpu.ir;
+	s.addr = cpu.addr;
+	s.r0 = cpu.r0;
+	s.r1 = cpu.r1;
+	s.pc = cpu.pc;
+	s.pcOverflow = cpu.pcOverflow;
+	s.done = cpu.done;
+	s.immediate = cpu.immediate;
+	s.savedPC = cpu.savedPC;
+	s.savedIR = cpu.savedIR;
+	s.cycles = cpu.cycles;
+	s.instructions = cpu.instructions;
+
+	for( unsigned int p = 0; p < SNAP_PAGES; p++ ) {
+		s.page[p] = new SnapPage;
+		s.page[p]->refs = 1;
+		memcpy( s.page[p]->data, cpu.mem + p * SNAP_PAGE_SIZE,
+			SNAP_PAGE_SIZE );
+	}
+}
+
+//
+// snapshot_fork() - make s a copy of parent that shares all its pages.
+//
+
+void snapshot_fork( Snapshot &s, const Snapshot &parent ) {
+	s = parent;
+	for( unsigned int p = 0; p < SNAP_PAGES; p++ )
+		s.page[p]->refs++;
+}
+
+//
+// snapshot_poke() - Mem[addr] <- value in s alone, copying the page it
+// is on first if another snapshot shares it.
+//
+
+void snapshot_poke( Snapshot &s, long addr, long value ) {
+	addr &= FAST_MEM_SIZE - 1;
+
+	SnapPage *&page = s.page[addr / SNAP_PAGE_SIZE];
+
+	if( page->refs > 1 ) {
+		SnapPage *copy = new SnapPage;
+
+		copy->refs = 1;
+		memcpy( copy->data, page->data, SNAP_PAGE_SIZE );
+		page->refs--;
+		page = copy;
+	}
+
+	page->data[addr % SNAP_PAGE_SIZE] = value;
+}
+
+//
+// snapshot_restore() - put cpu in the state s holds, with empty caches.
+// The trace writer is left as it is.
+//
+
+void snapshot_restore( FastCpu &cpu, const Snapshot &s ) {
+	fast_reset( cpu );
+
+	cpu.aux = s.aux;
+	cpu.ir = s.ir;
+	cpu.addr = s.addr;
+	cpu.r0 = s.r0;
+	cpu.r1 = s.r1;
+	cpu.pc = s.pc;
+	cpu.pcOverflow = s.pcOverflow;
+	cpu.done = s.done;
+	cpu.immediate = s.immediate;
+	cpu.savedPC = s.savedPC;
+	cpu.savedIR = s.savedIR;
+	cpu.cycles = s.cycles;
+	cpu.instructions = s.instructions;
+
+	for( unsigned int p = 0; p < SNAP_PAGES; p++ )
+		memcpy( cpu.mem + p * SNAP_PAGE_SIZE, s.page[p]->data,
+			SNAP_PAGE_SIZE );
+}
+
+//
+// snapshot_free() - drop s's references to its pages, freeing the ones
+// no other snapshot shares.
+//
+
+void snapshot_free( Snapshot &s ) {
+	for( unsigned int p = 0; p < SNAP_PAGES; p++ ) {
+		if( --s.page[p]->refs == 0 )
+			delete s.page[p];
+		s.page[p] = NULL;
+	}
+}
+
+//
+// snapshot_save() - write s to path.  Returns false if it cannot be
+// written.
+//
+
+bool snapshot_save( Snapshot &s, const char *path ) {
+	unsigned char header[SNAP_HEADER_SIZE];
+	long *reg[SNAP_REGS];
+	FILE *fp = fopen( path, "wb" );
+
+	if( fp == NULL ) {
+		fprintf( stderr, "Cannot create snapshot file %s\n", path );
+		return false;
+	}
+
+	memset( header, 0, sizeof( header ) );
+	memcpy( header, SNAP_MAGIC, sizeof( SNAP_MAGIC ) );
+	header[4] = 1;
+	header[5] = ADDR_BITS;
+	header[6] = DATA_BITS;
+
+	snapshot_regs( s, reg );
+	for( unsigned int r = 0; r < SNAP_REGS; r++ )
+		for( int i = 0; i < 8; i++ )
+			header[8 + 8 * r + i] = (unsigned long)*reg[r] >> ( 8 * i );
+
+	fwrite( header, 1, sizeof( header ), fp );
+	for( unsigned int p = 0; p < SNAP_PAGES; p++ )
+		fwrite( s.page[p]->data, 1, SNAP_PAGE_SIZE, fp );
+
+	if( fclose( fp ) != 0 ) {
+		fprintf( stderr, "Cannot write snapshot file %s\n", path );
+		return false;
+	}
+
+	return true;
+}
+
+//
+// snapshot_load() - read the snapshot in path into s, in pages of its
+// own.  Returns false if the file cannot be read or is not a snapshot
+// of this machine.
+//
+
+bool snapshot_load( Snapshot &s, const char *path ) {
+	unsigned char header[SNAP_HEADER_SIZE];
+	unsigned char mem[FAST_MEM_SIZE];
+	long *reg[SNAP_REGS];
+	FILE *fp = fopen( path, "rb" );
+	bool ok;
+
+	if( fp == NULL ) {
+		fprintf( stderr, "Cannot open snapshot file %s\n", path );
+		return false;
+	}
+
+	ok = fread( header, 1, sizeof( header ), fp ) == sizeof( header ) &&
+		fread( mem, 1, sizeof( mem ), fp ) == sizeof( mem ) &&
+		fgetc( fp ) == EOF;
+	fclose( fp );
+
+	if( !ok || memcmp( header, SNAP_MAGIC, sizeof( SNAP_MAGIC ) ) != 0 ||
+	    header[4] != 1 || header[5] != ADDR_BITS || header[6] != DATA_BITS ) {
+		fprintf( stderr, "%s is not a minVAX snapshot\n", path );
+		return false;
+	}
+
+	snapshot_regs( s, reg );
+	for( unsigned int r = 0; r < SNAP_REGS; r++ ) {
+		unsigned long v = 0;
+
+		for( int i = 0; i < 8; i++ )
+			v |= (unsigned long)header[8 + 8 * r + i] << ( 8 * i );
+		*reg[r] = v;
+	}
+
+	for( unsigned int p = 0; p < SNAP_PAGES; p++ ) {
+		s.page[p] = new SnapPage;
+		s.page[p]->refs = 1;
+		memcpy( s.page[p]->data, mem + p * SNAP_PAGE_SIZE, SNAP_PAGE_SIZE );
+	}
+
+	return true;
+}
+
+//
+// run_save() - run N instructions of objfile on the fast engine, with
+// the trace as usual, and save the machine to savefile.  Stops early if
+// the machine halts.  Returns false if either file fails.
+//
+
+bool run_save( char *objfile, char *savefile, long n ) {
+	FastCpu *cpu = new FastCpu;
+	Snapshot s;
+	bool ok;
+
+	if( trace_file != NULL && !trace_open_binary( cpu->trace, trace_file ) )
+		exit( 1 );
+	if( flight_size > 0 )
+		trace_open_ring( cpu->trace, flight_size );
+	if( fold_trace )
+		trace_open_fold( cpu->trace );
+
+	fast_reset( *cpu );
+	if( !fast_load( *cpu, objfile ) ) {
+		delete cpu;
+		return false;
+	}
+
+	while( !cpu->done && cpu->instructions < n )
+		fast_step( *cpu );
+	trace_end( cpu->trace );
+
+	snapshot_take( s, *cpu );
+	ok = snapshot_save( s, savefile );
+	snapshot_free( s );
+
+	if( ok )
+		printf( "\nSnapshot: %ld instructions, simulated time %ld cycles, "
+			"saved to %s\n", cpu->instructions, cpu->cycles, savefile );
+
+	delete cpu;
+
+	return ok;
+}
+
+//
+// run_restore() - run the machine saved in snapfile on to the halt on
+// the fast engine, with the trace options of a normal run.  Returns false
+// if the snapshot cannot be loaded.
+//
+
+bool run_restore( char *snapfile ) {
+	FastCpu *cpu = new FastCpu;
+	Snapshot s;
+
+	if( !snapshot_load( s, snapfile ) ) {
+		delete cpu;
+		return false;
+	}
+
+	if( trace_file != NULL && !trace_open_binary( cpu->trace, trace_file ) )
+		exit( 1 );
+	if( flight_size > 0 )
+		trace_open_ring( cpu->trace, flight_size );
+	if( fold_trace )
+		trace_open_fold( cpu->trace );
+
+	snapshot_restore( *cpu, s );
+	snapshot_free( s );
+
+	trace_start( cpu->trace, cpu->pc, false );
+	fast_resume( *cpu, snapfile );
+
+	delete cpu;
+
+	return true;
+}
+
+//
+// variant_apply() - apply the changes on one line of a variants list to
+// s: hex "AA=VV" sets Mem[AA], "R0=VV", "R1=VV" and "PC=VV" set a
+// register.  Returns false, leaving s partly changed, if a change does
+// not parse.
+//
+
+static bool variant_apply( Snapshot &s, char *line ) {
+	char *p = line;
+
+	for( ;; ) {
+		char *end;
+		long addr = -1, value;
+		long *reg = NULL;
+
+		while( *p == ' ' || *p == '\t' )
+			p++;
+		if( *p == '\0' )
+			return true;
+
+		if( strncmp( p, "R0=", 3 ) == 0 )
+			reg = &s.r0;
+		else if( strncmp( p, "R1=", 3 ) == 0 )
+			reg = &s.r1;
+		else if( strncmp( p, "PC=", 3 ) == 0 )
+			reg = &s.pc;
+
+		if( reg != NULL )
+			p += 3;
+		else {
+			addr = strtol( p, &end, 16 );
+			if( end == p || *end != '=' )
+				return false;
+			p = end + 1;
+		}
+
+		value = strtol( p, &end, 16 );
+		if( end == p || ( *end != '\0' && *end != ' ' && *end != '\t' ) )
+			return false;
+		p = end;
+
+		if( reg == NULL )
+			snapshot_poke( s, addr, value );
+		else {
+			*reg = value & 0xff;
+			if( reg == &s.pc )
+				s.pcOverflow = false;
+		}
+	}
+}
+
+//
+// variant_halt() - why the machine stopped: the names lanes.cpp uses.
+//
+
+static const char *variant_halt( const FastCpu &cpu ) {
+	const DecodeEntry &e = decode_table[cpu.savedIR & 0xff];
+
+	if( !cpu.done )
+		return "instruction limit";
+	if( e.status == DECODE_INVALID_AM )
+		return "invalid address mode";
+	if( e.status == DECODE_UNKNOWN_AM )
+		return "unknown address mode";
+	if( e.opc == 15 )
+		return "halt instruction";
+	return "PC overflow";
+}
+
+//
+// run_variants() - fork the machine saved in snapfile once for each line
+// of listfile, apply that line's changes to the fork, and run each fork
+// on the fast engine, without a trace, for up to --limit instructions
+// past the snapshot.  Prints one result line per variant, as --lanes
+// does.  Returns the number of variants that could not be parsed, or -1
+// if the snapshot cannot be loaded.
+//
+
+int run_variants( char *snapfile, char *listfile ) {
+	FastCpu *cpu = new FastCpu;
+	Snapshot base;
+	Snapshot *fork;
+	char **line;
+	bool *ok;
+	long count, pages = 0, instructions = 0;
+	int failed = 0;
+	double start, elapsed;
+
+	if( !snapshot_load( base, snapfile ) ) {
+		delete cpu;
+		return -1;
+	}
+
+	count = read_list( listfile, line );
+	fork = new Snapshot[count];
+	ok = new bool[count];
+
+	for( long v = 0; v < count; v++ ) {
+		snapshot_fork( fork[v], base );
+		ok[v] = variant_apply( fork[v], line[v] );
+		if( !ok[v] ) {
+			fprintf( stderr, "Bad variant: %s\n", line[v] );
+			failed++;
+		}
+	}
+
+	// pages the forks had to copy; the rest are still the base's
+	for( long v = 0; v < count; v++ )
+		for( unsigned int p = 0; p < SNAP_PAGES; p++ )
+			if( fork[v].page[p] != base.page[p] )
+				pages++;
+
+	trace_off( cpu->trace );
+	start = host_seconds();
+
+	for( long v = 0; v < count; v++ ) {
+		if( !ok[v] )
+			continue;
+
+		snapshot_restore( *cpu, fork[v] );
+
+		long first = cpu->instructions;
+
+		while( !cpu->done &&
+		       ( lane_limit <= 0 || cpu->instructions - first < lane_limit ) )
+			fast_step( *cpu );
+		instructions += cpu->instructions - first;
+
+		printf( "%s: %ld instructions, simulated time %ld cycles, "
+			"R0=%02x R1=%02x PC=%02x, %s\n", line[v], cpu->instructions,
+			cpu->cycles, cpu->r0, cpu->r1, cpu->pc, variant_halt( *cpu ) );
+	}
+
+	elapsed = host_seconds() - start;
+
+	if( show_stats ) {
+		fflush( stdout );
+		fprintf( stderr, "Variants: %ld forks of %u pages, %ld pages copied "
+			"on write\n", count, SNAP_PAGES, pages );
+		fprintf( stderr, "%ld instructions in %.3f s host time "
+			"(%.0f instructions/sec)\n", instructions, elapsed,
+			elapsed > 0 ? instructions / elapsed : 0.0 );
+	}
+
+	for( long v = 0; v < count; v++ ) {
+		snapshot_free( fork[v] );
+		free( line[v] );
+	}
+	snapshot_free( base );
+	delete [] fork;
+	delete [] ok;
+	delete [] line;
+	delete cpu;
+
+	return failed;
+}
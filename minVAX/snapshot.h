@@ -0,0 +1,61 @@
+// snapshot.h
+//
+// Snapshots of a fast engine machine: every FastCpu register, done, the
+// cycle and instruction counts, and memory.  The decode, block and JIT
+// caches are not part of the state; restoring a snapshot starts them
+// empty.
+//
+// Memory is held in SNAP_PAGE_SIZE-byte pages with a reference count.
+// A fork shares all of its parent's pages, and poking a byte copies only
+// the page it falls in if that page is shared, so any number of variants
+// forked from one warm snapshot cost a page per byte they change.  The
+// counts are not atomic: fork, poke and free a snapshot family on one
+// thread.
+//
+// Snapshot file layout, multi-byte fields little-endian:
+//
+//   0    SNAP_MAGIC
+//   4    bytes per word (1)
+//   5    address bits (ADDR_BITS)
+//   6    data bits (DATA_BITS)
+//   7    0
+//   8    the registers, 8 bytes each, in the order of Snapshot below
+//   112  the words of memory, from address 0
+//
+// The RTL model's arch registers and Memory can only be changed by clock
+// ticks, so snapshots are taken and restored on the fast engine only.
+
+#ifndef _SNAPSHOT_H
+#define _SNAPSHOT_H
+
+const unsigned int SNAP_PAGE_SIZE( 32 );	// bytes per copy-on-write page
+const unsigned int SNAP_PAGES( FAST_MEM_SIZE / SNAP_PAGE_SIZE );
+const unsigned int SNAP_REGS( 13 );			// register fields in the file
+const unsigned int SNAP_HEADER_SIZE( 8 + 8 * SNAP_REGS );
+
+extern const char SNAP_MAGIC[4];	// "MVS1"
+
+struct SnapPage {
+	long refs;				// snapshots sharing this page
+	unsigned char data[SNAP_PAGE_SIZE];
+};
+
+struct Snapshot {
+	long aux;
+	long ir;
+	long addr;
+	long r0;
+	long r1;
+	long pc;
+	long pcOverflow;
+	long done;
+	long immediate;
+	long savedPC;
+	long savedIR;
+	long cycles;
+	long instructions;
+
+	SnapPage *page[SNAP_PAGES];	// memory, shared with forks
+};
+
+#endif
@@ -0,0 +1,270 @@
+// tick_schedule.C
+//
+// --compact: pack each instruction's recorded register transfers into
+// the fewest ticks the buses, the ALU, the memory port and the data
+// dependencies allow, and report the savings.  See tick_schedule.h.
+
+#include "includes.h"
+
+static const char *const sched_names[SCHED_NONE + 1] = {
+	"R0", "R1", "PC", "AUX", "IR", "ADDR", "MAR", "M", "?"
+};
+
+//
+// sched_connects[bus][0] - registers that can drive the bus (its IN);
+// sched_connects[bus][1] - registers that can latch from it (its OUT).
+// The connections make_connections() makes.
+//
+
+#define SCHED_BIT( r )	( 1 << ( r ) )
+
+static const unsigned int sched_connects[2][2] = {
+	{	// abus
+		SCHED_BIT( SCHED_AUX ) | SCHED_BIT( SCHED_PC ) | SCHED_BIT( SCHED_ADDR ),
+		SCHED_BIT( SCHED_AUX ) | SCHED_BIT( SCHED_PC ) | SCHED_BIT( SCHED_ADDR ) |
+			SCHED_BIT( SCHED_MAR )
+	},
+	{	// dbus
+		SCHED_BIT( SCHED_AUX ) | SCHED_BIT( SCHED_ADDR ) | SCHED_BIT( SCHED_R0 ) |
+			SCHED_BIT( SCHED_R1 ),
+		SCHED_BIT( SCHED_IR ) | SCHED_BIT( SCHED_AUX ) | SCHED_BIT( SCHED_ADDR ) |
+			SCHED_BIT( SCHED_R0 ) | SCHED_BIT( SCHED_R1 )
+	}
+};
+
+//
+// schedule_reset() - nothing recorded yet; the next instruction begins
+// at cycle start.
+//
+
+void schedule_reset( TickSchedule &s, long start ) {
+	memset( &s, 0, sizeof( s ) );
+	s.fetched = SCHED_XFERS;
+	s.start = start;
+}
+
+//
+// sched_reads(), sched_writes() - the registers a transfer reads and
+// latches, as a mask of SCHED_BIT()s.
+//
+
+static unsigned int sched_reads( const SchedXfer &x ) {
+	unsigned int r = 0;
+
+	if( x.src != SCHED_NONE )
+		r |= SCHED_BIT( x.src );
+	if( x.src2 != SCHED_NONE )
+		r |= SCHED_BIT( x.src2 );
+	return r;
+}
+
+static unsigned int sched_writes( const SchedXfer &x ) {
+	return ( x.dest != SCHED_NONE ) ? SCHED_BIT( x.dest ) : 0;
+}
+
+//
+// schedule_pack() - place the recorded transfers: at[] gets the tick of
+// each and unit[] the unit it uses.  Returns the ticks the schedule
+// needs.
+//
+// What follows the instruction fetch depends on decoding the op code and
+// address mode, so every transfer after the fetch's is taken to read IR
+// as well.
+//
+
+static long schedule_pack( TickSchedule &s, long *at, int *unit ) {
+	long ticks = 0;
+
+	for( int j = 0; j < s.count; j++ ) {
+		const SchedXfer &x = s.xfer[j];
+		unsigned int reads = sched_reads( x ), writes = sched_writes( x );
+		long t = 0;
+
+		if( j >= s.fetched )
+			reads |= SCHED_BIT( SCHED_IR );
+
+		// data dependencies on the transfers made before it
+		for( int i = 0; i < j; i++ ) {
+			unsigned int wi = sched_writes( s.xfer[i] );
+
+			if( ( wi & ( reads | writes ) ) && at[i] + 1 > t )
+				t = at[i] + 1;
+			else if( ( sched_reads( s.xfer[i] ) & writes ) && at[i] > t )
+				t = at[i];
+		}
+
+		// the first of those ticks with a unit free for it, trying the
+		// bus the routine used before the other one
+		for( ;; t++ ) {
+			int tries[2], n = 0;
+
+			tries[n++] = x.unit;
+			if( x.kind == XFER_BUS ) {
+				int other = ( x.unit == SCHED_ABUS ) ? SCHED_DBUS : SCHED_ABUS;
+
+				if( ( sched_connects[other][0] & SCHED_BIT( x.src ) ) &&
+				    ( sched_connects[other][1] & SCHED_BIT( x.dest ) ) )
+					tries[n++] = other;
+			}
+
+			unit[j] = -1;
+			for( int k = 0; k < n && unit[j] < 0; k++ ) {
+				bool busy = false;
+
+				for( int i = 0; i < j && !busy; i++ )
+					busy = ( at[i] == t && unit[i] == tries[k] &&
+						tries[k] != SCHED_FREE );
+				if( !busy )
+					unit[j] = tries[k];
+			}
+			if( unit[j] >= 0 )
+				break;
+		}
+
+		at[j] = t;
+		if( unit[j] != x.unit )
+			s.moved++;
+		if( t + 1 > ticks )
+			ticks = t + 1;
+	}
+
+	return ticks;
+}
+
+//
+// sched_text() - one transfer, as text.
+//
+
+static void sched_text( char *buf, const SchedXfer &x ) {
+	const char *d = sched_names[x.dest], *a = sched_names[x.src];
+
+	switch( x.kind ) {
+		case XFER_BUS:	 sprintf( buf, "%s<-%s", d, a );					break;
+		case XFER_ALU:	 sprintf( buf, "%s<-alu(%s,%s)", d, a,
+							sched_names[x.src2] );						break;
+		case XFER_READ:	 sprintf( buf, "%s<-M[MAR]", d );					break;
+		case XFER_WRITE: sprintf( buf, "M[MAR]<-%s", sched_names[x.src2] );	break;
+		case XFER_INCR:	 sprintf( buf, "%s+1", d );						break;
+		default:		 sprintf( buf, "%s<-0", d );						break;
+	}
+}
+
+//
+// sched_render() - the schedule in which transfer i goes in tick at[i]
+// into out, ticks separated by " | " and an empty tick shown as "-".
+//
+
+static void sched_render( char *out, const TickSchedule &s, const long *at,
+	long ticks ) {
+	int len = 0;
+
+	out[0] = '\0';
+	for( long t = 0; t < ticks; t++ ) {
+		bool any = false;
+		char tick[SCHED_TEXT];
+
+		tick[0] = '\0';
+		for( int i = 0; i < s.count; i++ ) {
+			char one[32];
+
+			if( at[i] != t )
+				continue;
+			sched_text( one, s.xfer[i] );
+			if( strlen( tick ) + strlen( one ) + 3 >= sizeof( tick ) )
+				break;
+			if( any )
+				strcat( tick, ", " );
+			strcat( tick, one );
+			any = true;
+		}
+
+		if( len + strlen( tick ) + 8 >= (unsigned int)SCHED_TEXT ) {
+			strcpy( out + len, " | ..." );
+			return;
+		}
+		len += sprintf( out + len, "%s%s", ( t > 0 ) ? " | " : "",
+			any ? tick : "-" );
+	}
+}
+
+//
+// schedule_retire() - instruction ir retired with the machine's cycle
+// count at cycles: pack the transfers recorded since it began, add both
+// tick counts to its op code and address mode, and start the next
+// instruction.
+//
+
+void schedule_retire( TickSchedule &s, long ir, long cycles ) {
+	const DecodeEntry &e = decode_table[ir & 0xff];
+	int am = ( e.opc > 0 && e.opc < 10 ) ? e.am : COUNT_NO_AM;
+	long at[SCHED_XFERS];
+	int unit[SCHED_XFERS];
+	long ticks = cycles - s.start;
+	long packed = schedule_pack( s, at, unit );
+
+	if( s.instructions[e.opc][am]++ == 0 ) {
+		long issued[SCHED_XFERS];
+
+		for( int i = 0; i < s.count; i++ )
+			issued[i] = s.xfer[i].tick;
+		sched_render( s.issued[e.opc][am], s, issued, ticks );
+		sched_render( s.compact[e.opc][am], s, at, packed );
+	}
+	s.ticks[e.opc][am] += ticks;
+	s.packed[e.opc][am] += packed;
+
+	s.count = 0;
+	s.fetched = SCHED_XFERS;
+	s.start = cycles;
+}
+
+//
+// schedule_report() - print the ticks issued and packed per instruction
+// for each op code and address mode pair that ran, the totals, and the
+// schedules of the first instance of each pair.
+//
+
+void schedule_report( FILE *out, const TickSchedule &s ) {
+	long instructions = 0, ticks = 0, packed = 0;
+	char name[32];
+
+	fprintf( out, "\nTick compaction:\n  %-16s %12s %10s %10s %10s\n", "",
+		"instructions", "ticks/ins", "packed/ins", "saved/ins" );
+
+	for( int opc = 0; opc < 16; opc++ )
+		for( int am = 0; am <= COUNT_NO_AM; am++ ) {
+			long n = s.instructions[opc][am];
+
+			if( n == 0 )
+				continue;
+			sprintf( name, "%x %s %s", opc, op_mnemonics[opc], am_names[am] );
+			fprintf( out, "  %-16s %12ld %10.2f %10.2f %10.2f\n", name, n,
+				(double)s.ticks[opc][am] / n, (double)s.packed[opc][am] / n,
+				(double)( s.ticks[opc][am] - s.packed[opc][am] ) / n );
+
+			instructions += n;
+			ticks += s.ticks[opc][am];
+			packed += s.packed[opc][am];
+		}
+
+	if( instructions == 0 )
+		return;
+
+	fprintf( out, "  %-16s %12ld %10.2f %10.2f %10.2f\n", "all", instructions,
+		(double)ticks / instructions, (double)packed / instructions,
+		(double)( ticks - packed ) / instructions );
+	fprintf( out, "\n%ld ticks issued in instructions, %ld packed: %ld saved "
+		"(%.1f%%), %ld transfers moved to the other bus\n", ticks, packed,
+		ticks - packed, 100.0 * ( ticks - packed ) / ticks, s.moved );
+
+	fprintf( out, "\nSchedules (first instance of each pair; | separates "
+		"ticks):\n" );
+	for( int opc = 0; opc < 16; opc++ )
+		for( int am = 0; am <= COUNT_NO_AM; am++ ) {
+			if( s.instructions[opc][am] == 0 )
+				continue;
+			fprintf( out, "  %x %s %s\n    issued: %s\n    packed: %s\n", opc,
+				op_mnemonics[opc], am_names[am], s.issued[opc][am],
+				s.compact[opc][am] );
+		}
+}
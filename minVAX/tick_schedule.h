@@ -0,0 +1,196 @@
+// tick_schedule.h
+//
+// Register transfers for the RTL routines, and the tick scheduler for
+// --compact.
+//
+// The RTL routines make their transfers through transfer(),
+// alu_transfer(), memory_read(), memory_write(), register_incr() and
+// register_clear() rather than calling pullFrom() and latchFrom()
+// themselves.  With --compact each one is also recorded, with the tick
+// it was issued in, and when the instruction retires the scheduler packs
+// its transfers into as few ticks as it can:
+//
+//   - a transfer goes at least one tick after one that latches what it
+//     reads or what it latches, and no earlier than one that reads what
+//     it latches (everything latches at the end of the tick);
+//   - nothing after FETCH() goes before IR is latched, since what it is
+//     depends on decoding IR;
+//   - each tick carries at most one transfer on each of abus and dbus,
+//     one ALU operation and one memory read or write;
+//   - a bus transfer may move to the other bus if its source and
+//     destination connect to that bus too; sched_connects[] mirrors
+//     make_connections().
+//
+// Transfers are placed in the order they were made, each in the first
+// tick the rules allow.  The trace and the cycle count are those of the
+// routines as written; the report shows, per op code and address mode,
+// the ticks issued and the ticks the packed schedule needs.
+
+#ifndef _TICK_SCHEDULE_H
+#define _TICK_SCHEDULE_H
+
+// What transfers read and latch.  SCHED_MEM is the memory itself.
+enum SchedReg {
+	SCHED_R0, SCHED_R1, SCHED_PC, SCHED_AUX, SCHED_IR, SCHED_ADDR,
+	SCHED_MAR, SCHED_MEM, SCHED_NONE
+};
+
+// What a tick can do one of.
+enum SchedUnit { SCHED_ABUS, SCHED_DBUS, SCHED_ALU, SCHED_PORT, SCHED_FREE };
+
+enum XferKind {
+	XFER_BUS,		// dest <- src over a bus
+	XFER_ALU,		// dest <- src op src2
+	XFER_READ,		// dest <- Mem[MAR]
+	XFER_WRITE,		// Mem[MAR] <- src
+	XFER_INCR,		// dest <- dest + 1
+	XFER_CLEAR		// dest <- 0
+};
+
+const int SCHED_XFERS( 32 );		// transfers one instruction can record
+const int SCHED_TEXT( 256 );		// longest schedule printed
+
+struct SchedXfer {
+	unsigned char kind;		// XferKind
+	unsigned char dest;		// SchedReg
+	unsigned char src;
+	unsigned char src2;
+	unsigned char unit;		// SchedUnit the routine used
+	long tick;				// ticks after the instruction began
+};
+
+struct TickSchedule {
+	long start;						// cycles when the instruction began
+	int count;						// transfers recorded for it
+	int fetched;					// how many of them FETCH() made
+	SchedXfer xfer[SCHED_XFERS];
+
+	long instructions[16][COUNT_NO_AM + 1];	// [op code][address mode]
+	long ticks[16][COUNT_NO_AM + 1];		// ticks issued
+	long packed[16][COUNT_NO_AM + 1];		// ticks the packed schedules need
+	long moved;								// transfers put on the other bus
+
+	// the first instance of each pair, as issued and packed
+	char issued[16][COUNT_NO_AM + 1][SCHED_TEXT];
+	char compact[16][COUNT_NO_AM + 1][SCHED_TEXT];
+};
+
+//
+// sched_reg() - which register o is.
+//
+
+inline int sched_reg( CpuContext &cpu, StorageObject &o ) {
+	if( &o == &cpu.r0 )				return SCHED_R0;
+	if( &o == &cpu.r1 )				return SCHED_R1;
+	if( &o == &cpu.pc )				return SCHED_PC;
+	if( &o == &cpu.aux )			return SCHED_AUX;
+	if( &o == &cpu.ir )				return SCHED_IR;
+	if( &o == &cpu.addr )			return SCHED_ADDR;
+	if( &o == &cpu.m.MAR() )		return SCHED_MAR;
+	return SCHED_NONE;
+}
+
+//
+// schedule_add() - record a transfer made in the current tick.
+//
+
+inline void schedule_add( CpuContext &cpu, int kind, int dest, int src,
+	int src2, int unit ) {
+	TickSchedule &s = *cpu.schedule;
+
+	if( s.count == SCHED_XFERS )
+		return;
+
+	SchedXfer &x = s.xfer[s.count++];
+
+	x.kind = kind;
+	x.dest = dest;
+	x.src = src;
+	x.src2 = src2;
+	x.unit = unit;
+	x.tick = cpu.cycles - s.start;
+}
+
+//
+// transfer() - dest <- src over bus.
+//
+
+inline void transfer( CpuContext &cpu, Bus &bus, StorageObject &src,
+	StorageObject &dest ) {
+	bus.IN().pullFrom( src );
+	dest.latchFrom( bus.OUT() );
+
+	if( cpu.schedule != NULL )
+		schedule_add( cpu, XFER_BUS, sched_reg( cpu, dest ),
+			sched_reg( cpu, src ), SCHED_NONE,
+			( &bus == &cpu.abus ) ? SCHED_ABUS : SCHED_DBUS );
+}
+
+//
+// alu_transfer() - dest <- op1 op op2 through the ALU.
+//
+
+template<class Op>
+inline void alu_transfer( CpuContext &cpu, Op op, StorageObject &op1,
+	StorageObject &op2, StorageObject &dest ) {
+	cpu.alu.OP1().pullFrom( op1 );
+	cpu.alu.OP2().pullFrom( op2 );
+	cpu.alu.perform( op );
+	dest.latchFrom( cpu.alu.OUT() );
+
+	if( cpu.schedule != NULL )
+		schedule_add( cpu, XFER_ALU, sched_reg( cpu, dest ),
+			sched_reg( cpu, op1 ), sched_reg( cpu, op2 ), SCHED_ALU );
+}
+
+//
+// memory_read() - dest <- Mem[MAR].
+//
+
+inline void memory_read( CpuContext &cpu, StorageObject &dest ) {
+	cpu.m.read();
+	dest.latchFrom( cpu.m.READ() );
+
+	if( cpu.schedule != NULL )
+		schedule_add( cpu, XFER_READ, sched_reg( cpu, dest ), SCHED_MAR,
+			SCHED_MEM, SCHED_PORT );
+}
+
+//
+// memory_write() - Mem[MAR] <- src.
+//
+
+inline void memory_write( CpuContext &cpu, StorageObject &src ) {
+	cpu.m.WRITE().pullFrom( src );
+	cpu.m.write();
+
+	if( cpu.schedule != NULL )
+		schedule_add( cpu, XFER_WRITE, SCHED_MEM, SCHED_MAR,
+			sched_reg( cpu, src ), SCHED_PORT );
+}
+
+//
+// register_incr() - reg <- reg + 1.
+//
+
+inline void register_incr( CpuContext &cpu, Counter &reg ) {
+	reg.incr();
+
+	if( cpu.schedule != NULL )
+		schedule_add( cpu, XFER_INCR, sched_reg( cpu, reg ),
+			sched_reg( cpu, reg ), SCHED_NONE, SCHED_FREE );
+}
+
+//
+// register_clear() - reg <- 0.
+//
+
+inline void register_clear( CpuContext &cpu, Counter &reg ) {
+	reg.clear();
+
+	if( cpu.schedule != NULL )
+		schedule_add( cpu, XFER_CLEAR, sched_reg( cpu, reg ), SCHED_NONE,
+			SCHED_NONE, SCHED_FREE );
+}
+
+#endif
@@ -0,0 +1,806 @@
+// trace_writer.C
+//
+// Buffered trace output for minVAX, and the binary trace format.  See
+// trace_writer.h.
+
+#include "includes.h"
+
+#define HEX_ROW( h ) \
+	h "0" h "1" h "2" h "3" h "4" h "5" h "6" h "7" \
+	h "8" h "9" h "a" h "b" h "c" h "d" h "e" h "f"
+
+const char hex_pairs[2 * 256 + 1] =
+	HEX_ROW( "0" ) HEX_ROW( "1" ) HEX_ROW( "2" ) HEX_ROW( "3" )
+	HEX_ROW( "4" ) HEX_ROW( "5" ) HEX_ROW( "6" ) HEX_ROW( "7" )
+	HEX_ROW( "8" ) HEX_ROW( "9" ) HEX_ROW( "a" ) HEX_ROW( "b" )
+	HEX_ROW( "c" ) HEX_ROW( "d" ) HEX_ROW( "e" ) HEX_ROW( "f" );
+
+const char TRACE_MAGIC[4] = { 'M', 'V', 'T', '1' };
+
+//
+// Mnemonic for each op code, as printed in the trace.
+//
+
+const char *const op_mnemonics[16] = {
+	"NOP", "ADD", "AND", "SRA", "SLL", "LDR", "STR", "JMP",
+	"BEZ", "BLT", "NOP", "CLR", "CMP", "INC", "DMP", "HLT"
+};
+
+//
+// trace_info[] - the Decode<IR> fields the trace needs, for each
+// instruction byte.  decode_table[] has them too, but also points at
+// the handlers, which minvax-trace does not link with.
+//
+
+struct TraceInfo {
+	unsigned char opc;
+	unsigned char am;
+	unsigned char ra;
+	unsigned char length;
+	unsigned char status;
+	unsigned char trace;
+};
+
+#define TRACE_INFO_ENTRY( n ) \
+	{ Decode<n>::opc, Decode<n>::am, Decode<n>::ra, Decode<n>::length, \
+	  Decode<n>::status, Decode<n>::trace },
+
+static const TraceInfo trace_info[256] = {
+	DECODE_EACH( TRACE_INFO_ENTRY )
+};
+
+//
+// Loop folding.  An instruction waits in pend until it is known not to
+// be the start of a loop: when the last 2P instructions are the same P
+// twice over (by address, instruction byte, immediate and branch
+// outcome), they become the body of a loop, the second pass telling how
+// the values and store addresses shown move from one iteration to the
+// next.  Each instruction after that has to be exactly the one the body
+// predicts, and the loop is printed when one is not.
+//
+
+const long FOLD_MAX_BODY( 64 );		// longest loop folded
+const long FOLD_PEND( 2 * FOLD_MAX_BODY );
+const long FOLD_MIN_COUNT( 3 );		// shorter loops are printed in full
+
+// One instruction, with R0 and R1 after it.  Fields its trace line does
+// not show are 0.
+struct FoldEntry {
+	unsigned char pc;
+	unsigned char ir;
+	unsigned char imm;
+	unsigned char value;
+	unsigned char addr;
+	bool taken;
+	unsigned char r0;
+	unsigned char r1;
+};
+
+struct TraceFold {
+	FoldEntry pend[FOLD_PEND];	// not printed yet: pend[i % FOLD_PEND]
+	long pendStart;				// for pendStart <= i < pendEnd
+	long pendEnd;
+	long lastSeen[256];			// index of the last one at each address
+	long period;				// distance back to the last one at this address
+	long run;					// how many in a row matched one period back
+	unsigned char r0, r1;		// after the last instruction printed
+
+	bool folding;				// in a loop?
+	FoldEntry body[FOLD_MAX_BODY];	// its first iteration
+	unsigned char valueStep[FOLD_MAX_BODY];
+	unsigned char addrStep[FOLD_MAX_BODY];
+	FoldEntry part[FOLD_MAX_BODY];	// the iteration under way
+	long length;				// instructions in body
+	long count;					// iterations done
+	long partLength;
+	unsigned char entry0, entry1;	// R0 and R1 before the loop
+	unsigned char exit0, exit1;		// and after its last iteration
+};
+
+//
+// TraceWriter() - an empty buffer, writing text to stdout.
+//
+
+TraceWriter::TraceWriter() :
+	out( stdout ),
+	mode( TRACE_TEXT ),
+	ring( NULL ),
+	ringSize( 0 ),
+	ringNext( 0 ),
+	ringCount( 0 ),
+	fold( NULL ),
+	used( 0 ) {
+
+	trace_codec_reset( codec, 0 );
+}
+
+//
+// ~TraceWriter() - write out whatever is left, and close a binary trace
+// file.
+//
+
+TraceWriter::~TraceWriter() {
+	trace_end( *this );
+	if( mode == TRACE_BINARY )
+		fclose( out );
+	delete [] ring;
+	delete fold;
+}
+
+//
+// trace_flush() - write the buffered text to out in one chunk.
+//
+
+void trace_flush( TraceWriter &tw ) {
+	if( tw.used > 0 )
+		fwrite( tw.buf, 1, tw.used, tw.out );
+	tw.used = 0;
+}
+
+//
+// trace_open_binary() - send binary trace records to file path instead
+// of text to out.  Returns false if the file cannot be created.
+//
+
+bool trace_open_binary( TraceWriter &tw, const char *path ) {
+	FILE *fp = fopen( path, "wb" );
+
+	if( fp == NULL ) {
+		fprintf( stderr, "Cannot create trace file %s\n", path );
+		return false;
+	}
+
+	trace_flush( tw );
+	tw.out = fp;
+	tw.mode = TRACE_BINARY;
+	memcpy( tw.buf, TRACE_MAGIC, sizeof( TRACE_MAGIC ) );
+	tw.used = sizeof( TRACE_MAGIC );
+
+	return true;
+}
+
+//
+// trace_open_ring() - record the last size instructions instead of
+// printing them.
+//
+
+void trace_open_ring( TraceWriter &tw, long size ) {
+	delete [] tw.ring;
+	tw.ring = new TraceRingEntry[size];
+	tw.ringSize = size;
+	tw.ringNext = 0;
+	tw.ringCount = 0;
+	tw.mode = TRACE_RING;
+}
+
+//
+// trace_ring_dump() - print the instructions in the ring, oldest first,
+// as trace_render() would have printed them.
+//
+
+static void trace_ring_dump( TraceWriter &tw ) {
+	long n = ( tw.ringCount < tw.ringSize ) ? tw.ringCount : tw.ringSize;
+	long i = ( tw.ringNext - n + tw.ringSize ) % tw.ringSize;
+
+	if( tw.ringCount > n ) {
+		char note[64];
+
+		sprintf( note, "[%ld earlier instructions not recorded]\n",
+			tw.ringCount - n );
+		trace_str( tw, note );
+	}
+
+	while( n-- > 0 ) {
+		const TraceRingEntry &e = tw.ring[i];
+		TraceRecord rec;
+
+		rec.imm = e.imm;
+		rec.value = e.value;
+		rec.addr = e.addr;
+		rec.taken = e.taken;
+		trace_render( tw, e.pc, e.ir, rec );
+
+		if( ++i == tw.ringSize )
+			i = 0;
+	}
+}
+
+//
+// trace_codec_reset() - no history; the first instruction is predicted
+// to be at entry.
+//
+
+void trace_codec_reset( TraceCodec &c, long entry ) {
+	c.next = entry;
+	c.branch = -1;
+	memset( c.ir, 0, sizeof( c.ir ) );
+	memset( c.imm, 0, sizeof( c.imm ) );
+	memset( c.value, 0, sizeof( c.value ) );
+	memset( c.addr, 0, sizeof( c.addr ) );
+	memset( c.target, 0, sizeof( c.target ) );
+}
+
+//
+// trace_fields() - the TRACE_HAS_ bits (and TRACE_TAKEN) for the record
+// fields that the trace line of instruction byte ir shows.
+//
+
+static int trace_fields( long ir ) {
+	const TraceInfo &d = trace_info[ir];
+	int fields = 0;
+
+	if( d.status != DECODE_OK )
+		return 0;
+
+	if( d.trace >= TRACE_REG && d.length == 2 )
+		fields |= TRACE_HAS_IMM;
+	if( d.trace == TRACE_REG || d.trace == TRACE_STORE || d.opc == 14 )
+		fields |= TRACE_HAS_VALUE;
+	if( d.trace == TRACE_STORE )
+		fields |= TRACE_HAS_ADDR;
+	if( d.trace == TRACE_BRANCH )
+		fields |= TRACE_TAKEN;
+
+	return fields;
+}
+
+//
+// trace_predict() - after the instruction at pc, where the next one
+// should be.  Both ends call this with the same arguments.
+//
+
+static void trace_predict( TraceCodec &c, long pc, long ir, bool taken ) {
+	if( taken ) {
+		c.branch = pc;
+		c.next = c.target[pc];
+	}
+	else {
+		c.branch = -1;
+		c.next = ( pc + trace_info[ir].length ) & 0xff;
+	}
+}
+
+//
+// fold_same() - whether a and b are the same instruction by what a loop
+// must repeat.
+//
+
+static bool fold_same( const FoldEntry &a, const FoldEntry &b ) {
+	return a.pc == b.pc && a.ir == b.ir && a.imm == b.imm &&
+		a.taken == b.taken;
+}
+
+//
+// fold_step() - instruction k of the body as it is in iteration c,
+// counting from 0.
+//
+
+static FoldEntry fold_step( const TraceFold &f, long k, long c ) {
+	FoldEntry e = f.body[k];
+
+	e.value += c * f.valueStep[k];
+	e.addr += c * f.addrStep[k];
+	return e;
+}
+
+//
+// fold_print() - print the trace line of e.
+//
+
+static void fold_print( TraceWriter &tw, const FoldEntry &e ) {
+	TraceRecord rec;
+
+	rec.imm = e.imm;
+	rec.value = e.value;
+	rec.addr = e.addr;
+	rec.taken = e.taken;
+	trace_render( tw, e.pc, e.ir, rec );
+
+	tw.fold->r0 = e.r0;
+	tw.fold->r1 = e.r1;
+}
+
+//
+// fold_open() - the P instructions from index start, and the P after
+// them, are two passes of a loop.  Print what came before and start
+// folding.
+//
+
+static void fold_open( TraceWriter &tw, long start, long p ) {
+	TraceFold &f = *tw.fold;
+
+	while( f.pendStart < start )
+		fold_print( tw, f.pend[f.pendStart++ % FOLD_PEND] );
+
+	for( long k = 0; k < p; k++ ) {
+		const FoldEntry &a = f.pend[( start + k ) % FOLD_PEND];
+		const FoldEntry &b = f.pend[( start + p + k ) % FOLD_PEND];
+
+		f.body[k] = a;
+		f.valueStep[k] = b.value - a.value;
+		f.addrStep[k] = b.addr - a.addr;
+	}
+
+	const FoldEntry &last = f.pend[( start + 2 * p - 1 ) % FOLD_PEND];
+
+	f.entry0 = f.r0;
+	f.entry1 = f.r1;
+	f.exit0 = last.r0;
+	f.exit1 = last.r1;
+	f.length = p;
+	f.count = 2;
+	f.partLength = 0;
+	f.folding = true;
+
+	f.pendStart = f.pendEnd;
+	f.period = f.run = 0;
+}
+
+//
+// fold_close() - the loop has ended; print its iterations, folded if
+// there were enough of them.  The unfinished iteration in part is left
+// to the caller.
+//
+
+static void fold_close( TraceWriter &tw ) {
+	TraceFold &f = *tw.fold;
+	char note[96];
+	bool steps = false;
+
+	f.folding = false;
+
+	if( f.count < FOLD_MIN_COUNT ) {
+		for( long c = 0; c < f.count; c++ )
+			for( long k = 0; k < f.length; k++ )
+				fold_print( tw, fold_step( f, k, c ) );
+		f.r0 = f.exit0;
+		f.r1 = f.exit1;
+		return;
+	}
+
+	sprintf( note, "loop of %ld instructions, %ld iterations, "
+		"entry R0=%02x R1=%02x {\n", f.length, f.count, f.entry0, f.entry1 );
+	trace_str( tw, note );
+
+	for( long k = 0; k < f.length; k++ )
+		fold_print( tw, f.body[k] );
+
+	trace_char( tw, '}' );
+	for( long k = 0; k < f.length; k++ ) {
+		if( f.addrStep[k] == 0 && f.valueStep[k] == 0 )
+			continue;
+
+		sprintf( note, "%s line %ld", steps ? "," : " per iteration:", k + 1 );
+		trace_str( tw, note );
+		if( f.addrStep[k] != 0 ) {
+			trace_str( tw, " address +" );
+			trace_hex( tw, f.addrStep[k], 2 );
+		}
+		if( f.valueStep[k] != 0 ) {
+			trace_str( tw, " value +" );
+			trace_hex( tw, f.valueStep[k], 2 );
+		}
+		steps = true;
+	}
+
+	sprintf( note, "%s exit R0=%02x R1=%02x\n", steps ? ";" : "", f.exit0,
+		f.exit1 );
+	trace_str( tw, note );
+
+	f.r0 = f.exit0;
+	f.r1 = f.exit1;
+}
+
+//
+// fold_push() - take the next instruction.
+//
+
+static void fold_push( TraceWriter &tw, const FoldEntry &e ) {
+	TraceFold &f = *tw.fold;
+
+	if( f.folding ) {
+		FoldEntry want = fold_step( f, f.partLength, f.count );
+
+		if( fold_same( e, want ) && e.value == want.value &&
+		    e.addr == want.addr ) {
+			f.part[f.partLength++] = e;
+			if( f.partLength == f.length ) {
+				f.count++;
+				f.exit0 = e.r0;
+				f.exit1 = e.r1;
+				f.partLength = 0;
+			}
+			return;
+		}
+
+		// out of the loop; what ran of its last iteration may be
+		// the start of another
+		FoldEntry rest[FOLD_MAX_BODY];
+		long n = f.partLength;
+
+		memcpy( rest, f.part, n * sizeof( FoldEntry ) );
+		fold_close( tw );
+		for( long k = 0; k < n; k++ )
+			fold_push( tw, rest[k] );
+		fold_push( tw, e );
+		return;
+	}
+
+	if( tw.mode == TRACE_OFF )
+		return;
+
+	if( f.pendEnd - f.pendStart == FOLD_PEND )
+		fold_print( tw, f.pend[f.pendStart++ % FOLD_PEND] );
+
+	long i = f.pendEnd++;
+	long prev = f.lastSeen[e.pc];
+
+	f.pend[i % FOLD_PEND] = e;
+	f.lastSeen[e.pc] = i;
+
+	if( prev < 0 || i - prev > FOLD_MAX_BODY ) {
+		f.period = f.run = 0;
+		return;
+	}
+
+	long p = i - prev;
+	bool match = i - p >= f.pendStart &&
+		fold_same( f.pend[( i - p ) % FOLD_PEND], e );
+
+	if( p != f.period ) {
+		f.period = p;
+		f.run = 0;
+	}
+	f.run = match ? f.run + 1 : 0;
+
+	if( f.run >= p && i - 2 * p + 1 >= f.pendStart )
+		fold_open( tw, i - 2 * p + 1, p );
+}
+
+//
+// fold_drain() - print everything still waiting.
+//
+
+static void fold_drain( TraceWriter &tw ) {
+	TraceFold &f = *tw.fold;
+
+	if( f.folding ) {
+		fold_close( tw );
+		for( long k = 0; k < f.partLength; k++ )
+			fold_print( tw, f.part[k] );
+	}
+	while( f.pendStart < f.pendEnd )
+		fold_print( tw, f.pend[f.pendStart++ % FOLD_PEND] );
+
+	f.period = f.run = 0;
+}
+
+//
+// trace_open_fold() - print the trace with its loops folded.
+//
+
+void trace_open_fold( TraceWriter &tw ) {
+	delete tw.fold;
+	tw.fold = new TraceFold;
+
+	TraceFold &f = *tw.fold;
+
+	f.pendStart = f.pendEnd = 0;
+	for( int pc = 0; pc < 256; pc++ )
+		f.lastSeen[pc] = -1;
+	f.period = f.run = 0;
+	f.r0 = f.r1 = 0;
+	f.folding = false;
+	tw.mode = TRACE_FOLD;
+}
+
+//
+// trace_off() - print and record nothing, not even the halt messages.
+//
+
+void trace_off( TraceWriter &tw ) {
+	tw.mode = TRACE_OFF;
+}
+
+//
+// trace_end() - the run is over; print whatever loop folding is holding
+// back and write out the buffer.
+//
+
+void trace_end( TraceWriter &tw ) {
+	if( tw.mode == TRACE_FOLD )
+		fold_drain( tw );
+	trace_flush( tw );
+}
+
+//
+// trace_start() - the program has been loaded and starts at entry.  In
+// text mode the "Memory sets starting address" line is printed only if
+// echo is set; the RTL model leaves it to Memory::load().
+//
+
+void trace_start( TraceWriter &tw, long entry, bool echo ) {
+	if( tw.mode == TRACE_OFF )
+		return;
+
+	if( tw.mode == TRACE_BINARY ) {
+		trace_room( tw, 2 );
+		tw.buf[tw.used++] = TRACE_START;
+		tw.buf[tw.used++] = entry;
+		trace_codec_reset( tw.codec, entry & 0xff );
+	}
+	else if( echo ) {
+		trace_str( tw, "Memory sets starting address to " );
+		trace_hex( tw, entry, 1 );
+		trace_char( tw, '\n' );
+	}
+}
+
+//
+// trace_retire() - the instruction ir at pc is finished, leaving r0 and
+// r1 in R0 and R1, and tw.rec holds what its trace line shows; print the
+// line, append its binary record, put it in the ring (which is printed
+// if the instruction halted the machine with an error) or hand it to
+// loop folding.
+//
+
+void trace_retire( TraceWriter &tw, long pc, long ir, long r0, long r1 ) {
+	if( tw.mode == TRACE_TEXT ) {
+		trace_render( tw, pc, ir, tw.rec );
+		return;
+	}
+
+	if( tw.mode == TRACE_FOLD ) {
+		int fields = trace_fields( ir & 0xff );
+		FoldEntry e;
+
+		e.pc = pc;
+		e.ir = ir;
+		e.imm = ( fields & TRACE_HAS_IMM ) ? tw.rec.imm : 0;
+		e.value = ( fields & TRACE_HAS_VALUE ) ? tw.rec.value : 0;
+		e.addr = ( fields & TRACE_HAS_ADDR ) ? tw.rec.addr : 0;
+		e.taken = ( fields & TRACE_TAKEN ) && tw.rec.taken;
+		e.r0 = r0;
+		e.r1 = r1;
+		fold_push( tw, e );
+		return;
+	}
+
+	if( tw.mode == TRACE_OFF )
+		return;
+
+	if( tw.mode == TRACE_RING ) {
+		// an error halt prints no trace line, so it takes no slot:
+		// the ring still shows the last ringSize instructions before it
+		if( trace_info[ir & 0xff].status != DECODE_OK ) {
+			trace_ring_dump( tw );
+			trace_render( tw, pc, ir, tw.rec );
+			return;
+		}
+
+		TraceRingEntry &e = tw.ring[tw.ringNext];
+
+		e.pc = pc;
+		e.ir = ir;
+		e.imm = tw.rec.imm;
+		e.value = tw.rec.value;
+		e.addr = tw.rec.addr;
+		e.taken = tw.rec.taken;
+		if( ++tw.ringNext == tw.ringSize )
+			tw.ringNext = 0;
+		tw.ringCount++;
+		return;
+	}
+
+	TraceCodec &c = tw.codec;
+	const TraceRecord &r = tw.rec;
+	int fields = trace_fields( ir & 0xff );
+	unsigned char tag = TRACE_INSTR;
+	unsigned char field[5];
+	int n = 0;
+
+	pc &= 0xff;
+	ir &= 0xff;
+
+	if( pc != c.next ) {
+		tag |= TRACE_HAS_PC;
+		field[n++] = pc;
+	}
+	if( c.branch >= 0 )
+		c.target[c.branch] = pc;
+
+	if( ir != c.ir[pc] ) {
+		tag |= TRACE_HAS_IR;
+		field[n++] = c.ir[pc] = ir;
+	}
+	if( ( fields & TRACE_HAS_IMM ) && (unsigned char)r.imm != c.imm[pc] ) {
+		tag |= TRACE_HAS_IMM;
+		field[n++] = c.imm[pc] = r.imm;
+	}
+	if( ( fields & TRACE_HAS_VALUE ) && (unsigned char)r.value != c.value[pc] ) {
+		tag |= TRACE_HAS_VALUE;
+		field[n++] = c.value[pc] = r.value;
+	}
+	if( ( fields & TRACE_HAS_ADDR ) && (unsigned char)r.addr != c.addr[pc] ) {
+		tag |= TRACE_HAS_ADDR;
+		field[n++] = c.addr[pc] = r.addr;
+	}
+	if( ( fields & TRACE_TAKEN ) && r.taken )
+		tag |= TRACE_TAKEN;
+
+	trace_room( tw, n + 1 );
+	tw.buf[tw.used++] = tag;
+	memcpy( tw.buf + tw.used, field, n );
+	tw.used += n;
+
+	trace_predict( c, pc, ir, ( tag & TRACE_TAKEN ) != 0 );
+}
+
+//
+// trace_overflow() - the machine halted because PC wrapped around.
+//
+
+void trace_overflow( TraceWriter &tw ) {
+	if( tw.mode == TRACE_OFF )
+		return;
+
+	if( tw.mode == TRACE_BINARY ) {
+		trace_room( tw, 1 );
+		tw.buf[tw.used++] = TRACE_OVERFLOW;
+		return;
+	}
+
+	if( tw.mode == TRACE_RING )
+		trace_ring_dump( tw );
+	if( tw.mode == TRACE_FOLD )
+		fold_drain( tw );
+	trace_str( tw, "\nMACHINE HALTED due to PC overflow\n\n" );
+}
+
+//
+// trace_limit() - the machine was stopped after --limit instructions.
+// Only --batch sets a limit, and it never writes a binary trace.
+//
+
+void trace_limit( TraceWriter &tw ) {
+	if( tw.mode == TRACE_OFF || tw.mode == TRACE_BINARY )
+		return;
+
+	if( tw.mode == TRACE_RING )
+		trace_ring_dump( tw );
+	if( tw.mode == TRACE_FOLD )
+		fold_drain( tw );
+	trace_str( tw, "\nMACHINE HALTED due to instruction limit\n\n" );
+}
+
+//
+// trace_render() - the text of instruction ir at pc: its trace line, or
+// the halt message, and the newline that ends it.
+//
+// Instructions with an address mode the op code does not allow, or an
+// unknown one, halt the machine without a trace line.  DMP and HLT have
+// a form of their own.
+//
+
+void trace_render( TraceWriter &tw, long pc, long ir, const TraceRecord &rec ) {
+	const TraceInfo &d = trace_info[ir & 0xff];
+
+	if( d.status == DECODE_INVALID_AM )
+		trace_str( tw, "\nMACHINE HALTED due to invalid address mode\n" );
+	else if( d.status == DECODE_UNKNOWN_AM )
+		trace_str( tw, "\nMACHINE HALTED due to unknown address mode\n" );
+	else {
+		trace_hex( tw, pc, 2 );
+		trace_str( tw, ":  " );
+		trace_hex( tw, ir, 2 );
+		trace_str( tw, " = " );
+		trace_str( tw, op_mnemonics[d.opc], 3 );
+		trace_char( tw, ' ' );
+		trace_hex( tw, d.ra, 1 );
+		trace_char( tw, ' ' );
+		trace_hex( tw, d.am, 1 );
+
+		if( d.opc == 14 ) {
+			trace_str( tw, "    R" );
+			trace_hex( tw, d.ra, 1 );
+			trace_char( tw, '=' );
+			trace_hex( tw, rec.value, 2 );
+		}
+		else if( d.opc == 15 )
+			trace_str( tw, "   \n\nMACHINE HALTED due to halt instruction\n" );
+		else if( d.trace == TRACE_PLAIN )
+			trace_str( tw, "   " );
+		else {
+			if( d.length == 2 ) {
+				trace_char( tw, ' ' );
+				trace_hex( tw, rec.imm, 2 );
+				trace_char( tw, ' ' );
+			}
+			else
+				trace_str( tw, "    " );
+
+			if( d.trace == TRACE_REG ) {
+				trace_char( tw, 'R' );
+				trace_hex( tw, d.ra, 1 );
+				trace_char( tw, '=' );
+				trace_hex( tw, rec.value, 2 );
+			}
+			else if( d.trace == TRACE_BRANCH ) {
+				if( rec.taken )
+					trace_str( tw, "BRANCH TAKEN" );
+				else
+					trace_str( tw, "BRANCH NOT TAKEN" );
+			}
+			else {
+				trace_str( tw, "MEM[" );
+				trace_hex( tw, rec.addr, 1 );
+				trace_str( tw, "]=" );
+				trace_hex( tw, rec.value, 2 );
+			}
+		}
+	}
+
+	trace_char( tw, '\n' );
+}
+
+//
+// trace_decode() - decode the binary record at p, of at most n bytes,
+// into kind (a TraceTag kind) and, for TRACE_START, the entry point in
+// pc, or for TRACE_INSTR pc, ir and rec.  Returns the length of the
+// record, or 0 if it is cut short or not a record.
+//
+
+long trace_decode( const unsigned char *p, long n, TraceCodec &c, int &kind,
+	long &pc, long &ir, TraceRecord &rec ) {
+	long used = 1;
+	int tag;
+
+	if( n < 1 )
+		return 0;
+
+	tag = p[0];
+	kind = tag & 0x3;
+
+	if( kind == TRACE_START ) {
+		if( n < 2 || tag != TRACE_START )
+			return 0;
+		pc = p[1];
+		trace_codec_reset( c, pc );
+		return 2;
+	}
+	if( kind == TRACE_OVERFLOW )
+		return ( tag == TRACE_OVERFLOW ) ? 1 : 0;
+	if( kind != TRACE_INSTR )
+		return 0;
+
+	// every field bit set means one more byte
+	for( int bit = TRACE_HAS_PC; bit <= TRACE_HAS_ADDR; bit <<= 1 )
+		if( tag & bit )
+			used++;
+	if( n < used )
+		return 0;
+
+	used = 1;
+	pc = ( tag & TRACE_HAS_PC ) ? p[used++] : c.next;
+	if( c.branch >= 0 )
+		c.target[c.branch] = pc;
+
+	if( tag & TRACE_HAS_IR )
+		c.ir[pc] = p[used++];
+	if( tag & TRACE_HAS_IMM )
+		c.imm[pc] = p[used++];
+	if( tag & TRACE_HAS_VALUE )
+		c.value[pc] = p[used++];
+	if( tag & TRACE_HAS_ADDR )
+		c.addr[pc] = p[used++];
+
+	ir = c.ir[pc];
+	rec.imm = c.imm[pc];
+	rec.value = c.value[pc];
+	rec.addr = c.addr[pc];
+	rec.taken = ( tag & TRACE_TAKEN ) != 0;
+
+	trace_predict( c, pc, ir, rec.taken );
+
+	return used;
+}
@@ -0,0 +1,203 @@
+// trace_writer.h
+//
+// Buffered trace output for minVAX.
+//
+// The trace is built up in a large buffer with the inline routines
+// below, which format hex fields with table lookups instead of printf,
+// and is written out only when the buffer fills, at halt, or when the
+// writer is destroyed (so an ArchLibError that unwinds the machine still
+// gets the trace out before main() prints the cause).  The text is the
+// same as the printf calls it replaces produced.
+//
+// The engines do not format trace lines themselves.  While an
+// instruction executes they fill in the writer's TraceRecord, and when
+// it retires trace_retire() either renders the line or, with
+// --trace-file, appends a binary record to the file instead.  The
+// minvax-trace tool renders a binary trace with the same code.
+//
+// With --flight=N the writer is a flight recorder: it keeps the raw
+// records of the last N instructions in a ring and formats nothing until
+// the machine halts on an error (an invalid or unknown address mode, or
+// PC overflow), when it prints the ring as the trace would have shown
+// it.  A run that ends at HLT prints no trace at all.
+//
+// With --fold the writer folds loops.  When the same run of instructions
+// (the same addresses and instruction bytes, immediates and branch
+// outcomes) comes round three times or more, it prints the first pass
+// once, between a line giving the length of the loop, how many times it
+// went round and R0 and R1 on entry, and a line giving R0 and R1 on exit
+// and how much each store address and value shown grows per iteration
+// (mod 0x100).  Every line of the full trace can be rebuilt from that.
+//
+// Binary trace format: the TRACE_MAGIC bytes, then one record per
+// event.  The first byte of a record is a tag; bits 1:0 give the kind.
+//
+//   TRACE_START      entry point byte follows
+//   TRACE_INSTR      bits 7:2 say which fields follow, in this order:
+//                    PC, IR, immediate, value, store address; a field
+//                    that is absent is the one predicted (see TraceCodec)
+//   TRACE_OVERFLOW   machine halted on PC overflow
+//
+// Most instructions in a loop are one or two bytes.
+
+#ifndef _TRACE_WRITER_H
+#define _TRACE_WRITER_H
+
+const unsigned int TRACE_BUFFER_SIZE( 1 << 16 );
+
+extern const char TRACE_MAGIC[4];	// "MVT1"
+
+// Record kinds and the field bits of a TRACE_INSTR tag.
+enum TraceTag {
+	TRACE_START = 0,
+	TRACE_INSTR = 1,
+	TRACE_OVERFLOW = 2,
+
+	TRACE_HAS_PC = 0x04,
+	TRACE_HAS_IR = 0x08,
+	TRACE_HAS_IMM = 0x10,
+	TRACE_HAS_VALUE = 0x20,
+	TRACE_HAS_ADDR = 0x40,
+	TRACE_TAKEN = 0x80
+};
+
+// What the trace line of an instruction shows besides its address and
+// instruction byte.  Which fields matter depends on its TraceKind.
+struct TraceRecord {
+	long imm;			// immediate byte, if the instruction has one
+	long value;			// RA (TRACE_REG, DMP) or the byte stored (TRACE_STORE)
+	long addr;			// where TRACE_STORE stored it
+	bool taken;			// TRACE_BRANCH outcome
+};
+
+// Predictions shared by the binary trace encoder and decoder, which
+// update them the same way after every record: each field is predicted
+// to be what it was the last time the instruction at that address ran,
+// and the next address to be the one after the instruction, or after a
+// taken branch wherever that branch went last time.
+struct TraceCodec {
+	long next;					// predicted address of the next instruction
+	long branch;				// address of the branch just taken, or -1
+	unsigned char ir[256];
+	unsigned char imm[256];
+	unsigned char value[256];
+	unsigned char addr[256];
+	unsigned char target[256];	// where a taken branch went
+};
+
+// Where trace_retire() sends an instruction.
+enum TraceMode {
+	TRACE_TEXT,			// render it to out
+	TRACE_BINARY,		// append its binary record to the file out
+	TRACE_RING,			// keep it in the flight recorder ring
+	TRACE_FOLD,			// render it, folding loops
+	TRACE_OFF			// drop it; the caller reports the result
+};
+
+// A flight recorder entry: the raw record of one instruction.
+struct TraceRingEntry {
+	unsigned char pc;
+	unsigned char ir;
+	unsigned char imm;
+	unsigned char value;
+	unsigned char addr;
+	bool taken;
+};
+
+struct TraceFold;				// loop folding state; see trace_writer.C
+
+struct TraceWriter {
+	TraceWriter();
+	~TraceWriter();
+
+	FILE *out;					// where the trace goes
+	int mode;					// TraceMode
+	TraceRecord rec;			// the instruction being executed
+	TraceCodec codec;			// binary encoder state
+	TraceRingEntry *ring;		// flight recorder, ringSize entries
+	long ringSize;
+	long ringNext;				// where the next entry goes
+	long ringCount;				// instructions recorded so far
+	TraceFold *fold;			// --fold state, or NULL
+	unsigned int used;			// bytes waiting in buf
+	char buf[TRACE_BUFFER_SIZE];
+};
+
+extern const char hex_pairs[2 * 256 + 1];	// "000102...feff"
+
+void trace_flush( TraceWriter & );
+bool trace_open_binary( TraceWriter &, const char * );
+void trace_open_ring( TraceWriter &, long );
+void trace_open_fold( TraceWriter & );
+void trace_off( TraceWriter & );
+void trace_end( TraceWriter & );
+void trace_codec_reset( TraceCodec &, long );
+void trace_start( TraceWriter &, long, bool );
+void trace_retire( TraceWriter &, long, long, long, long );
+void trace_overflow( TraceWriter & );
+void trace_limit( TraceWriter & );
+void trace_render( TraceWriter &, long, long, const TraceRecord & );
+long trace_decode( const unsigned char *, long, TraceCodec &, int &, long &,
+	long &, TraceRecord & );
+
+//
+// trace_room() - make sure n more bytes fit in the buffer.
+//
+
+inline void trace_room( TraceWriter &tw, unsigned int n ) {
+	if( tw.used + n > TRACE_BUFFER_SIZE )
+		trace_flush( tw );
+}
+
+//
+// trace_char() - append c.
+//
+
+inline void trace_char( TraceWriter &tw, char c ) {
+	trace_room( tw, 1 );
+	tw.buf[tw.used++] = c;
+}
+
+//
+// trace_str() - append s, right-justified in width columns ("%*s").
+//
+
+inline void trace_str( TraceWriter &tw, const char *s, unsigned int width = 0 ) {
+	unsigned int n = strlen( s );
+
+	trace_room( tw, ( n < width ? width : n ) );
+	while( n < width ) {
+		tw.buf[tw.used++] = ' ';
+		width--;
+	}
+	memcpy( tw.buf + tw.used, s, n );
+	tw.used += n;
+}
+
+//
+// trace_hex() - append v in hex, at least digits long ("%0*lx").
+//
+
+inline void trace_hex( TraceWriter &tw, unsigned long v, unsigned int digits ) {
+	char tmp[2 * sizeof( v )];
+	unsigned int n = 0;
+
+	// two digits per byte from the pair table, least significant first
+	do {
+		tmp[n++] = hex_pairs[2 * ( v & 0xff ) + 1];
+		tmp[n++] = hex_pairs[2 * ( v & 0xff )];
+		v >>= 8;
+	} while( v != 0 );
+
+	// the top byte may have only one significant digit
+	if( n > 1 && tmp[n - 1] == '0' )
+		n--;
+	while( n < digits )
+		tmp[n++] = '0';
+
+	trace_room( tw, n );
+	while( n > 0 )
+		tw.buf[tw.used++] = tmp[--n];
+}
+
+#endif
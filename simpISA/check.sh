@@ -0,0 +1,78 @@
+#!/bin/sh
+#
+# check.sh - run the test programs on both engines and compare them
+#
+# Each program (writeup_example.obj and tests/*.obj by default) runs on
+# the RTL model, and its trace must match the .out captured next to it.
+# The fast engine must print the same trace, and --variants (on the
+# program saved before its first instruction) must stop it after the
+# instructions and cycles the fast engine reported.
+#
+# The arch library's own lines (its banner and simulated time) are left
+# out of the comparison; its cycle count is not the model's.  A trace is
+# cut off at MAXLINES lines, so a program that no longer halts fails
+# instead of filling the disk.
+#
+# usage: check.sh [object-file...]
+#
+
+SIMPISA=./simpISA
+MAXLINES=10000
+TMP=${TMPDIR:-/tmp}/simpisa-check.$$
+mkdir $TMP || exit 1
+trap 'rm -rf $TMP' 0
+
+if [ $# -eq 0 ]; then
+	set -- writeup_example.obj tests/*.obj
+fi
+
+checked=0
+failed=0
+
+#
+# fail() - report a difference for the current program.
+#
+
+fail() {
+	echo "$obj: $1"
+	failed=`expr $failed + 1`
+}
+
+echo AC=0000 > $TMP/variants
+
+for obj in "$@"; do
+	checked=`expr $checked + 1`
+	sed -e 1,3d -e '/^Simulated time /,$d' ${obj%.obj}.out > $TMP/expect
+
+	# the RTL model
+
+	$SIMPISA --mode=rtl $obj | head -$MAXLINES > $TMP/rtl
+	sed -e 1,3d -e '/^Simulated time /,$d' $TMP/rtl > $TMP/got
+	if ! cmp -s $TMP/expect $TMP/got; then
+		fail "--mode=rtl trace differs from ${obj%.obj}.out"
+		diff $TMP/expect $TMP/got | head -10
+	fi
+
+	# the fast engine, traced
+
+	$SIMPISA --mode=fast $obj | head -$MAXLINES > $TMP/fast
+	sed '/^Fast engine: /,$d' $TMP/fast > $TMP/got
+	if ! cmp -s $TMP/expect $TMP/got; then
+		fail "--mode=fast trace differs from ${obj%.obj}.out"
+		diff $TMP/expect $TMP/got | head -10
+	fi
+	summary=`sed -n 's/^Fast engine: //p' $TMP/fast`
+
+	# and untraced
+
+	$SIMPISA --save=$TMP/snapshot $obj > /dev/null
+	got=`$SIMPISA --restore=$TMP/snapshot --variants=$TMP/variants |
+		sed 's/^AC=0000: //'`
+	case "$got" in
+	"$summary, "*)	;;
+	*)		fail "--variants: $got, not $summary" ;;
+	esac
+done
+
+echo "$checked programs checked, $failed differences"
+[ $failed -eq 0 ]
@@ -0,0 +1,26 @@
+// cpu_context.C
+//
+// Construction of a simpISA machine.  See cpu_context.h.
+
+#include "includes.h"
+
+//
+// CpuContext() - build the components of one machine, in their
+// power-on state.  make_connections() still has to wire them up.
+//
+
+CpuContext::CpuContext() :
+	abus( "ADDRBUS", ADDR_BITS ),
+	dbus( "DATABUS", DATA_BITS ),
+	ir( "IR", DATA_BITS ),
+	mdr( "MDR", DATA_BITS ),
+	ac( "AC", DATA_BITS ),
+	pc( "PC", ADDR_BITS ),
+	m( "Memory", ADDR_BITS, DATA_BITS ),
+	alu( "Adder", DATA_BITS ),
+	done( false ),
+	cycles( 0 ),
+	fetchStarted( false ),
+	overlapped( 0 ),
+	cache( NULL ) {
+}
@@ -0,0 +1,59 @@
+// cpu_context.h
+//
+// The state of one simulated simpISA machine: its buses, registers,
+// memory and ALU, and the simulation control flag that used to be
+// globals.  The op code routines, fetch_into(), make_connections() and
+// run_simulation() all work on the CpuContext they are given, so a
+// process can hold any number of machines.
+//
+// The arch Clock is still shared: every component in the process moves
+// on each Clock::tick(), and the simulated time printed at exit is the
+// total for all machines.  Machines must therefore be stepped from one
+// thread at a time.
+
+#ifndef _CPU_CONTEXT_H
+#define _CPU_CONTEXT_H
+
+struct MemCache;		// --cache model; see mem_cache.h
+
+struct CpuContext {
+	CpuContext();
+
+	// Buses
+	Bus abus;			// bus to carry memory addresses
+	Bus dbus;			// bus to carry data and instructions
+
+	// Registers
+	StorageObject ir;	// instruction register
+	Counter mdr;		// memory data register
+	Clearable ac;		// accumulator
+	Counter pc;			// program counter
+
+	// Other components
+	Memory m;			// primary memory
+	BusALU alu;			// arithmetic logic unit
+
+	// Simulation control
+	bool done;			// is the simulation over?
+	TraceWriter trace;	// buffered trace output
+
+	// Counter for --profile
+	long cycles;		// clock ticks this machine has issued
+
+	// --overlap
+	bool fetchStarted;	// the last tick did the next fetch's MAR <- PC
+	long overlapped;	// ticks saved by overlapping
+
+	MemCache *cache;	// --cache, --icache, --dcache model, or NULL
+};
+
+//
+// cpu_tick() - Clock::tick(), counted against this machine.
+//
+
+inline void cpu_tick( CpuContext &cpu ) {
+	Clock::tick();
+	cpu.cycles++;
+}
+
+#endif
@@ -11,6 +11,19 @@
 
 #include "includes.h"
 
+//
+// trace_instr() - record what the trace of the instruction in IR shows:
+// its mnemonic, its address field and the AC as it is now.
+//
+
+void trace_instr( CpuContext &cpu, const char *mnemonic ) {
+	TraceRecord &rec = cpu.trace.rec;
+
+	rec.mnemonic = mnemonic;
+	rec.addr = cpu.ir( DATA_BITS - 4, 0 );
+	rec.ac = cpu.ac.value();
+}
+
 //
 // load_to_ac() - load accumulator from memory address given.
 // 
@@ -22,7 +35,7 @@
 // Code 0
 //
 
-void load_to_ac() {
+void load_to_ac( CpuContext &cpu ) {
 
 	/*
 	Without using fetch_into().
@@ -30,12 +43,12 @@ void load_to_ac() {
 	// MAR <- IR[11-0]
 	abus.IN().pullFrom(ir); // buses are pull from
 	m.MAR().latchFrom(abus.OUT()); // registers are latch from; have to specify IN/OUT for buses (not storage objects, i.e. register)
-	Clock::tick();
+	cpu_tick( cpu );
 	
 	// MDR <- Mem[MAR]
 	m.read();
 	mdr.latchFrom(m.READ());
-	Clock::tick();
+	cpu_tick( cpu );
 
 	// AC <- MDR
 	dbus.IN().pullFrom(mdr);
@@ -44,11 +57,11 @@ void load_to_ac() {
 
 	// Using fetch_into().
 	// MAR <- IR[11-0] and MDR <- Mem[MAR]
-	fetch_into(ir, abus, mdr);
+	fetch_into(cpu, cpu.ir, cpu.abus, cpu.mdr);
 
 	// AC <- MDR
-	dbus.IN().pullFrom(mdr);
-	ac.latchFrom(dbus.OUT());
+	cpu.dbus.IN().pullFrom(cpu.mdr);
+	cpu.ac.latchFrom(cpu.dbus.OUT());
 
 }
 
@@ -62,21 +75,23 @@ void load_to_ac() {
 // Code 1
 //
 
-void store_to_mem() {
+void store_to_mem( CpuContext &cpu ) {
 
 	// MAR <- IR[11-0], MDR <- AC
 	// The parallelization is simulated by the Clock::tick() for this CPU.
-	abus.IN().pullFrom(ir);
-	m.MAR().latchFrom(abus.OUT());
+	cpu.abus.IN().pullFrom(cpu.ir);
+	cpu.m.MAR().latchFrom(cpu.abus.OUT());
 
-	dbus.IN().pullFrom(ac);
-	mdr.latchFrom(dbus.OUT());
+	cpu.dbus.IN().pullFrom(cpu.ac);
+	cpu.mdr.latchFrom(cpu.dbus.OUT());
 
-	Clock::tick();
+	cpu_tick( cpu );
 
-	// Mem[MAR] <- MDR
-	m.WRITE().pullFrom(mdr);
-	m.write();
+	// Mem[MAR] <- MDR, after any cache miss
+	if( cpu.cache != NULL )
+		cache_write( cpu );
+	cpu.m.WRITE().pullFrom(cpu.mdr);
+	cpu.m.write();
 
 }
 
@@ -96,22 +111,24 @@ void store_to_mem() {
 // Code 2
 //
 
-void increment_skip_if_result_equals_zero() {
+void increment_skip_if_result_equals_zero( CpuContext &cpu ) {
 
 	// MAR <- IR[11-0] and MDR <- Mem[MAR]
-	fetch_into(ir, abus, mdr);
+	fetch_into(cpu, cpu.ir, cpu.abus, cpu.mdr);
 
 	// MDR <- MDR + 1
-	mdr.incr();
-	Clock::tick();
+	cpu.mdr.incr();
+	cpu_tick( cpu );
 
-	// Mem[MAR] <- MDR
-	m.WRITE().pullFrom(mdr);
-	m.write();
+	// Mem[MAR] <- MDR, after any cache miss
+	if( cpu.cache != NULL )
+		cache_write( cpu );
+	cpu.m.WRITE().pullFrom(cpu.mdr);
+	cpu.m.write();
 
 	// if MDR == 0 then PC <- PC + 1
-	if (mdr.value() == 0)
-		pc.incr();
+	if (cpu.mdr.value() == 0)
+		cpu.pc.incr();
 
 }
 
@@ -125,11 +142,11 @@ void increment_skip_if_result_equals_zero() {
 // Code 3
 //
 
-void jump() {
+void jump( CpuContext &cpu ) {
 
 	// PC <- IR[11-0]
-	abus.IN().pullFrom(ir);
-	pc.latchFrom(abus.OUT());
+	cpu.abus.IN().pullFrom(cpu.ir);
+	cpu.pc.latchFrom(cpu.abus.OUT());
 
 }
 
@@ -142,11 +159,10 @@ void jump() {
 // Code 4
 //
 
-void halt() {
+void halt( CpuContext &cpu ) {
 
-	printf("%5s %03x   AC=%04x\n", "HALT", ir(DATA_BITS - 4, 0), ac.value());
-	cout << endl << "MACHINE HALTED due to halt instruction" << endl;
-	done = true;
+	trace_instr( cpu, "HALT" );
+	cpu.done = true;
 
 }
 
@@ -160,13 +176,13 @@ void halt() {
 // Code 5
 //
 
-void branch_if_ac_equals_zero() {
+void branch_if_ac_equals_zero( CpuContext &cpu ) {
 
 	// if AC == 0 then PC <- IR[11-0]
-	if (ac.value() == 0) {
+	if (cpu.ac.value() == 0) {
 		// abus.IN().pullFrom(ir);
 		// pc.latchFrom(abus.OUT());
-		jump();
+		jump( cpu );
 	}
 
 }
@@ -182,18 +198,18 @@ void branch_if_ac_equals_zero() {
 // Code 6
 //
 
-void add_to_ac() {
+void add_to_ac( CpuContext &cpu ) {
 
 	// Get memory operand using address in IR[11,0].
 	// MAR <- IR[11-0] and MDR <- Mem[MAR]
-	fetch_into(ir, abus, mdr);
+	fetch_into(cpu, cpu.ir, cpu.abus, cpu.mdr);
 
 	// Set up the addition.
 	// AC <- AC + MDR
-	alu.OP1().pullFrom(ac);
-	alu.OP2().pullFrom(mdr);
-	ac.latchFrom(alu.OUT());
-	alu.perform(BusALU::op_add);
+	cpu.alu.OP1().pullFrom(cpu.ac);
+	cpu.alu.OP2().pullFrom(cpu.mdr);
+	cpu.ac.latchFrom(cpu.alu.OUT());
+	cpu.alu.perform(BusALU::op_add);
 
 }
 
@@ -209,28 +225,30 @@ void add_to_ac() {
 // Code 7
 //
 
-void swap_mem_with_ac() {
+void swap_mem_with_ac( CpuContext &cpu ) {
 
-	printf("%5s %03x   AC=%04x", "SWP", ir(DATA_BITS - 4, 0), ac.value());
+	trace_instr( cpu, "SWP" );
 	
 	// MAR <- IR[11-0] and MDR <- Mem[MAR]
-	fetch_into(ir, abus, mdr);
+	fetch_into(cpu, cpu.ir, cpu.abus, cpu.mdr);
 
 	// AC <- MDR, MDR <- AC
 	// Value of AC goes to Dbus, Dbus goes to MDR.
-	dbus.IN().pullFrom(ac);
-	mdr.latchFrom(dbus.OUT());
+	cpu.dbus.IN().pullFrom(cpu.ac);
+	cpu.mdr.latchFrom(cpu.dbus.OUT());
 
 	// MDR goes to ALU, ALU does pass through op_rop2. ALU goes to AC.
-	alu.OP2().pullFrom(mdr);
-	alu.perform(BusALU::op_rop2); // ALU does not transfer data unless if there is an operation to perform.
-	ac.latchFrom(alu.OUT());
-	Clock::tick();
+	cpu.alu.OP2().pullFrom(cpu.mdr);
+	cpu.alu.perform(BusALU::op_rop2); // ALU does not transfer data unless if there is an operation to perform.
+	cpu.ac.latchFrom(cpu.alu.OUT());
+	cpu_tick( cpu );
 
-	// Mem[MAR] <- MDR
+	// Mem[MAR] <- MDR, after any cache miss
 	// Inflow is WRITE(); write() is to specify to memory to do the operation.
-	m.WRITE().pullFrom(mdr);
-	m.write();
+	if( cpu.cache != NULL )
+		cache_write( cpu );
+	cpu.m.WRITE().pullFrom(cpu.mdr);
+	cpu.m.write();
 
 }
 
@@ -240,55 +258,8 @@ void swap_mem_with_ac() {
 // Code 8
 //
 
-void clear_ac() {
-
-	ac.clear();
-
-}
-
-//
-// execute() - decode and execute the instruction
-//
-
-void execute() {
-	long opc;
-	const char* mnemonic;
-
-	// In each case, note that the last set of operations aren't actually performed 
-	// until we leave the switch statement.
-	//
-	// instr format:  opcode = bits 14:12, address = bits 11:0
-
-	opc = ir( DATA_BITS-1, DATA_BITS-3 );
-
-	switch( opc ) {
-
-		case 0: load_to_ac();							 mnemonic = "LOAD";		break;
-
-		case 1: store_to_mem();							 mnemonic = "STORE";	break;
-
-		case 2: increment_skip_if_result_equals_zero();  mnemonic = "ISZ";		break;
-
-		case 3: jump();									 mnemonic = "JUMP";		break;
-
-		case 4: halt();									 mnemonic = "HALT";		break;
-
-		case 5: branch_if_ac_equals_zero();				 mnemonic = "BZAC";		break;
-
-		case 6:	add_to_ac();							 mnemonic = "ADD";		break;
-
-		case 7: swap_mem_with_ac();						 mnemonic = "SWP";		break;
-
-		// case 8: clear_ac();								 mnemonic = "CLEAR";	break;
-
-		default:
-			cout << endl << "MACHINE HALTED due to unknown op code" << opc << endl;
-			done = true;
-	}
-
-	if (opc != 4 && opc != 7)
-		printf("%5s %03x   AC=%04x", mnemonic, ir(DATA_BITS - 4, 0), ac.value());
+void clear_ac( CpuContext &cpu ) {
 
-	Clock::tick();
+	cpu.ac.clear();
 
 }
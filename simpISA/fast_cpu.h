@@ -0,0 +1,36 @@
+// fast_cpu.h
+//
+// Machine state for the functional ("fast path") simpISA engine.
+//
+// The RTL model moves every value through the arch buses and registers
+// one clock tick at a time, and its memory can only be filled by
+// Memory::load() from a text object file.  The fast engine keeps the
+// registers as plain words and memory as a flat array, which a memory
+// image is copied straight into, and charges each instruction the
+// number of ticks the RTL model would have issued for it.
+
+#ifndef _FAST_CPU_H
+#define _FAST_CPU_H
+
+const unsigned int FAST_MEM_SIZE( 4096 );	// 12-bit address => 4096 words
+
+enum { LOAD, STORE, ISZ, JUMP, HALT, BZAC, ADD, SWP };	// op codes, IR[14-12]
+
+extern const char *const op_mnemonics[8];	// mnemonic for each op code
+
+struct FastCpu {
+	unsigned int ir;		// instruction register
+	unsigned int ac;		// accumulator
+	unsigned int pc;		// program counter
+
+	unsigned short mem[FAST_MEM_SIZE];	// primary memory
+
+	bool done;				// is the simulation over?
+
+	long cycles;			// RTL clock ticks this run would have taken
+	long instructions;		// instructions executed
+
+	TraceWriter trace;		// trace and halt messages; out is stdout by default
+};
+
+#endif
@@ -0,0 +1,242 @@
+// fast_engine.C
+//
+// Functional ("fast path") execution engine for simpISA.
+//
+// Implements the same op codes as the routines in execute.cpp, but on
+// the plain registers and flat memory of a FastCpu instead of the arch
+// components, so a program can be loaded from a memory image without
+// parsing text.  The trace output is identical to the RTL model, and every instruction is
+// charged the number of clock ticks the RTL model issues for it.
+
+#include "includes.h"
+
+const char *const op_mnemonics[8] = {
+	"LOAD", "STORE", "ISZ", "JUMP", "HALT", "BZAC", "ADD", "SWP"
+};
+
+//
+// RTL ticks for each op code after the fetch, which is 4 (fetch_into()
+// 2, PC+1 and IR <- MDR): the op's own ticks plus the final one.
+//
+
+static const long op_ticks[8] = {
+	3,		// LOAD   fetch_into(), AC <- MDR
+	2,		// STORE  MAR/MDR, Mem[MAR] <- MDR
+	4,		// ISZ    fetch_into(), MDR + 1, Mem[MAR] <- MDR
+	1,		// JUMP
+	1,		// HALT
+	1,		// BZAC
+	3,		// ADD    fetch_into(), AC <- AC + MDR
+	4		// SWP    fetch_into(), swap, Mem[MAR] <- MDR
+};
+
+//
+// fast_reset() - power-on state, matching the arch components.
+//
+
+void fast_reset( FastCpu &cpu ) {
+	cpu.ir = cpu.ac = cpu.pc = 0;
+
+	for( unsigned int i = 0; i < FAST_MEM_SIZE; i++ )
+		cpu.mem[i] = 0;
+
+	cpu.done = false;
+	cpu.cycles = 0;
+	cpu.instructions = 0;
+}
+
+//
+// fast_load() - load an object file or memory image into the fast
+// engine's memory and set PC to its entry point, as steps 1 and 2 of
+// run_simulation() do.
+//
+
+bool fast_load( FastCpu &cpu, char *objfile ) {
+	long entry;
+
+	if( !load_object( objfile, cpu.mem, entry ) )
+		return false;
+
+	trace_start( cpu.trace, entry );
+
+	cpu.pc = entry & ( FAST_MEM_SIZE - 1 );
+	cpu.cycles += 1;
+
+	return true;
+}
+
+//
+// fast_interpret() - run until the machine halts, or until it has
+// executed stop instructions in all (never, if stop is negative).
+//
+// As in run_simulation(), PC overflow is caught after the fetch_into()
+// of the word at the last address, and that word is not executed.  The
+// AC a trace line shows is the one before the instruction.
+//
+
+void fast_interpret( FastCpu &cpu, long stop ) {
+	const unsigned int mask = ( 1 << DATA_BITS ) - 1;
+	TraceRecord &rec = cpu.trace.rec;
+
+	while( !cpu.done && cpu.instructions != stop ) {
+		if( cpu.pc == FAST_MEM_SIZE - 1 ) {
+			cpu.cycles += 2;
+			trace_overflow( cpu.trace );
+			cpu.done = true;
+			break;
+		}
+
+		cpu.ir = cpu.mem[cpu.pc];
+		rec.pc = cpu.pc;
+		rec.ir = cpu.ir;
+		cpu.pc = ( cpu.pc + 1 ) & ( FAST_MEM_SIZE - 1 );
+
+		unsigned int opc = ( cpu.ir >> ( DATA_BITS - 3 ) ) & 7;
+		unsigned int addr = cpu.ir & ( FAST_MEM_SIZE - 1 );
+
+		rec.mnemonic = op_mnemonics[opc];
+		rec.addr = addr;
+		rec.ac = cpu.ac;
+
+		cpu.cycles += 4 + op_ticks[opc];
+		cpu.instructions++;
+
+		switch( opc ) {
+			case LOAD:
+				cpu.ac = cpu.mem[addr];
+				break;
+
+			case STORE:
+				cpu.mem[addr] = cpu.ac;
+				break;
+
+			case ISZ:
+				cpu.mem[addr] = ( cpu.mem[addr] + 1 ) & mask;
+				if( cpu.mem[addr] == 0 )
+					cpu.pc = ( cpu.pc + 1 ) & ( FAST_MEM_SIZE - 1 );
+				break;
+
+			case JUMP:
+				cpu.pc = addr;
+				break;
+
+			case HALT:
+				trace_halt( cpu.trace );
+				cpu.done = true;
+				continue;
+
+			case BZAC:
+				if( cpu.ac == 0 )
+					cpu.pc = addr;
+				break;
+
+			case ADD:
+				cpu.ac = ( cpu.ac + cpu.mem[addr] ) & mask;
+				break;
+
+			case SWP: {
+				unsigned int word = cpu.mem[addr];
+
+				cpu.mem[addr] = cpu.ac;
+				cpu.ac = word;
+				break;
+			}
+		}
+
+		trace_retire( cpu.trace, cpu.ac );
+	}
+}
+
+//
+// run_profiled() - run the machine until it halts one instruction at a
+// time, adding each one's ticks and where PC went to p.
+//
+
+static void run_profiled( FastCpu &cpu, Profile &p ) {
+	while( !cpu.done ) {
+		long cycles = cpu.cycles;
+		long instructions = cpu.instructions;
+
+		fast_interpret( cpu, instructions + 1 );
+
+		if( cpu.instructions != instructions )
+			profile_add( p, cpu.trace.rec.pc, cpu.ir, cpu.cycles - cycles,
+				cpu.pc );
+	}
+}
+
+//
+// fast_resume() - run the machine from its current state until it
+// halts, and print the summary.  name is the program's, for the
+// --profile-folded stacks.
+//
+
+void fast_resume( FastCpu &cpu, const char *name ) {
+	FILE *out = cpu.trace.out;
+	long first = cpu.instructions;
+	Profile *profile = NULL;
+	double start;
+
+	if( show_profile || profile_file != NULL ) {
+		profile = new Profile;
+		profile_reset( *profile, cpu.pc );
+	}
+
+	start = host_seconds();
+
+	if( profile != NULL )
+		run_profiled( cpu, *profile );
+	else
+		fast_interpret( cpu, -1 );
+
+	trace_end( cpu.trace );
+
+	fprintf( out, "\nFast engine: %ld instructions, simulated time %ld cycles\n",
+		cpu.instructions, cpu.cycles );
+
+	if( show_stats ) {
+		double elapsed = host_seconds() - start;
+		long ran = cpu.instructions - first;
+
+		fprintf( out, "%ld instructions in %.3f s host time (%.0f instructions/sec)\n",
+			ran, elapsed, elapsed > 0 ? ran / elapsed : 0.0 );
+	}
+
+	if( profile != NULL ) {
+		profile_done( out, *profile, cpu.cycles, name );
+		delete profile;
+	}
+}
+
+//
+// fast_run() - load and run one program on the given machine; the
+// counterpart of run_simulation().  Returns false if the object file
+// could not be loaded.
+//
+
+bool fast_run( FastCpu &cpu, char *objfile ) {
+	fast_reset( cpu );
+	if( !fast_load( cpu, objfile ) )
+		return false;
+
+	fast_resume( cpu, objfile );
+
+	return true;
+}
+
+//
+// run_fast() - run one program with the fast engine, writing to stdout,
+// or to the --flight ring, or folded.
+//
+
+void run_fast( char *objfile ) {
+	FastCpu cpu;
+
+	if( flight_size > 0 )
+		trace_open_ring( cpu.trace, flight_size );
+	if( fold_trace )
+		trace_open_fold( cpu.trace );
+
+	if( !fast_run( cpu, objfile ) )
+		exit( 1 );
+}
@@ -6,7 +6,8 @@
 //	2000/11/29:	wrc, restructured code
 //	2001/12/10:	wrc, modified simulation control
 //
-// Global variables for the dummest little computer.
+// Global variables for the dummest little computer.  The machine
+// itself is a CpuContext; see cpu_context.h.
 
 #include "includes.h"
 
@@ -17,31 +18,20 @@
 const unsigned int ADDR_BITS( 12 ); // 12-bit address => 4096 units of memory
 const unsigned int DATA_BITS( 15 ); // 15-bit unit size
 
-//
-// Buses
-//
-
-Bus abus( "ADDRBUS", ADDR_BITS ); // bus to carry memory addresses
-Bus dbus( "DATABUS", DATA_BITS ); // bus to carry data and instructions
-
-//
-// Registers
-//
-
-StorageObject ir( "IR", DATA_BITS );        // instruction register
-Counter mdr( "MDR", DATA_BITS );      	    // memory data register
-Clearable ac( "AC", DATA_BITS );            // accumulator
-Counter pc( "PC", ADDR_BITS );              // program counter
-
-// 
-// Other components
-//
-
-Memory m( "Memory", ADDR_BITS, DATA_BITS ); // primary memory
-BusALU alu( "Adder", DATA_BITS );           // arithmetic logic unit
-
 //
 // Runtime control variables
 //
 
-bool done ( false );		// is the simulation over?
+SimMode sim_mode ( MODE_RTL );	// which engine runs the program
+bool show_stats ( false );	// print run statistics at halt?
+long flight_size ( 0 );		// --flight ring entries (0 = full trace)
+bool fold_trace ( false );	// --fold: print loops in the trace folded
+long variant_limit ( 1000000 );	// --variants instruction limit (0 = none)
+bool show_profile ( false );	// --profile: print the hot spot report
+char *profile_file ( NULL );	// --profile-folded file, or NULL
+bool overlap_fetch ( false );	// --overlap: reads go in parallel with the next transfer
+char *cache_spec ( NULL );	// --cache: unified cache SIZE,WAYS,LINE, or NULL
+char *icache_spec ( NULL );	// --icache: instruction cache, or NULL
+char *dcache_spec ( NULL );	// --dcache: data cache, or NULL
+bool write_through ( false );	// --write-through: caches write every store to memory
+long miss_ticks ( 10 );		// --miss: ticks a cache miss stalls for
@@ -15,16 +15,19 @@
 extern const unsigned int ADDR_BITS; // 12-bit address => 4096 units of memory
 extern const unsigned int DATA_BITS; // 15-bit unit size
 
-extern Bus abus; // bus to carry memory addresses
-extern Bus dbus; // bus to carry data and instructions
-
-extern StorageObject ir;  // instruction register
-extern Counter mdr; 	  // memory data register
-extern Clearable ac;      // accumulator
-extern Counter pc;        // program counter
-extern Memory m;          // primary memory
-extern BusALU alu;        // arithmetic logic unit
-
-extern bool done;	  // is the simulation over?
+enum SimMode { MODE_RTL, MODE_FAST };
+extern SimMode sim_mode;  // which engine runs the program
+extern bool show_stats;	  // print run statistics at halt?
+extern long flight_size;  // --flight ring entries (0 = full trace)
+extern bool fold_trace;   // --fold: print loops in the trace folded
+extern long variant_limit; // --variants instruction limit (0 = none)
+extern bool show_profile; // --profile: print the hot spot report
+extern char *profile_file; // --profile-folded file, or NULL
+extern bool overlap_fetch; // --overlap: reads go in parallel with the next transfer
+extern char *cache_spec;  // --cache: unified cache SIZE,WAYS,LINE, or NULL
+extern char *icache_spec; // --icache: instruction cache, or NULL
+extern char *dcache_spec; // --dcache: data cache, or NULL
+extern bool write_through; // --write-through: caches write every store to memory
+extern long miss_ticks;   // --miss: ticks a cache miss stalls for
 
 #endif
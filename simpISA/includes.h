@@ -12,6 +12,7 @@
 
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
 
 // 'arch' library
@@ -28,7 +29,14 @@ using namespace std;
 
 // program-specific includes
 
+#include "trace_writer.h"
+#include "cpu_context.h"
+#include "fast_cpu.h"
+#include "loader.h"
+#include "snapshot.h"
 #include "globals.h"
+#include "profiler.h"
+#include "mem_cache.h"
 #include "prototypes.h"
 
 #endif
@@ -11,26 +11,26 @@
 
 #include "includes.h"
 
-void make_connections() {
+void make_connections( CpuContext &cpu ) {
 
-	m.MAR().connectsTo( abus.OUT() );
+	cpu.m.MAR().connectsTo( cpu.abus.OUT() );
 
-	mdr.connectsTo( m.WRITE() );
-	mdr.connectsTo( m.READ() );
-	mdr.connectsTo( dbus.IN() );
-	mdr.connectsTo( dbus.OUT() );
-	mdr.connectsTo( alu.OP2() );
+	cpu.mdr.connectsTo( cpu.m.WRITE() );
+	cpu.mdr.connectsTo( cpu.m.READ() );
+	cpu.mdr.connectsTo( cpu.dbus.IN() );
+	cpu.mdr.connectsTo( cpu.dbus.OUT() );
+	cpu.mdr.connectsTo( cpu.alu.OP2() );
 
-	ir.connectsTo( abus.IN() );
-	ir.connectsTo( dbus.OUT() );
+	cpu.ir.connectsTo( cpu.abus.IN() );
+	cpu.ir.connectsTo( cpu.dbus.OUT() );
 
-	ac.connectsTo( dbus.IN() );
-	ac.connectsTo( dbus.OUT() );
-	ac.connectsTo( alu.OP1() );
-	ac.connectsTo( alu.OUT() );
+	cpu.ac.connectsTo( cpu.dbus.IN() );
+	cpu.ac.connectsTo( cpu.dbus.OUT() );
+	cpu.ac.connectsTo( cpu.alu.OP1() );
+	cpu.ac.connectsTo( cpu.alu.OUT() );
 
-	pc.connectsTo( abus.IN() );
-	pc.connectsTo( abus.OUT() );
-	pc.connectsTo( m.READ() );
+	cpu.pc.connectsTo( cpu.abus.IN() );
+	cpu.pc.connectsTo( cpu.abus.OUT() );
+	cpu.pc.connectsTo( cpu.m.READ() );
 
 }
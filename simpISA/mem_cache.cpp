@@ -0,0 +1,238 @@
+// mem_cache.C
+//
+// --cache, --icache and --dcache: the cache model in front of the RTL
+// model's memory, and its report.  See mem_cache.h.
+
+#include "includes.h"
+
+static const char *const side_names[2] = { "fetch", "data" };
+
+//
+// cache_parse() - read a SIZE,WAYS,LINE cache description.  Returns
+// false unless all three are powers of two, a set fits in the cache and
+// the cache fits in memory.
+//
+
+bool cache_parse( const char *spec, long &size, long &ways, long &line ) {
+	char extra;
+
+	if( sscanf( spec, "%ld,%ld,%ld%c", &size, &ways, &line, &extra ) != 3 )
+		return false;
+	if( size <= 0 || ways <= 0 || line <= 0 || ( size & ( size - 1 ) ) ||
+	    ( ways & ( ways - 1 ) ) || ( line & ( line - 1 ) ) )
+		return false;
+
+	return ways * line <= size && size <= (long)CACHE_MEM_SIZE;
+}
+
+//
+// cache_init() - cache c, as spec describes it, empty.
+//
+
+static void cache_init( Cache &c, const char *name, const char *spec ) {
+	memset( &c, 0, sizeof( c ) );
+	c.name = name;
+	cache_parse( spec, c.size, c.ways, c.line );
+	c.sets = c.size / ( c.ways * c.line );
+
+	for( unsigned int i = 0; i < CACHE_MEM_SIZE; i++ ) {
+		c.block[i] = -1;
+		c.used[i] = -1;
+	}
+}
+
+//
+// cache_reset() - the caches the options describe, all empty.
+//
+
+void cache_reset( MemCache &mc ) {
+	memset( &mc, 0, sizeof( mc ) );
+	mc.writeThrough = write_through;
+	mc.missTicks = miss_ticks;
+
+	if( cache_spec != NULL ) {
+		cache_init( mc.cache[0], "unified", cache_spec );
+		mc.side[CACHE_FETCH] = mc.side[CACHE_DATA] = &mc.cache[0];
+		return;
+	}
+
+	if( icache_spec != NULL ) {
+		cache_init( mc.cache[0], "I-cache", icache_spec );
+		mc.side[CACHE_FETCH] = &mc.cache[0];
+	}
+	if( dcache_spec != NULL ) {
+		cache_init( mc.cache[1], "D-cache", dcache_spec );
+		mc.side[CACHE_DATA] = &mc.cache[1];
+	}
+}
+
+//
+// cache_access() - look up a read or write of addr from side in its
+// cache, if it has one, and update the cache.  Returns the ticks it
+// stalls the machine for.
+//
+
+static long cache_access( MemCache &mc, int side, long addr, bool write ) {
+	Cache *c = mc.side[side];
+
+	if( c == NULL )
+		return 0;
+
+	long block = addr / c->line;
+	long first = ( block % c->sets ) * c->ways;
+	long victim = first;
+
+	mc.clock++;
+	c->accesses[side]++;
+	mc.accesses[side][addr]++;
+
+	for( long i = first; i < first + c->ways; i++ ) {
+		if( c->block[i] == block ) {
+			c->used[i] = mc.clock;
+			if( write && !mc.writeThrough )
+				c->dirty[i] = true;
+			return ( write && mc.writeThrough ) ? mc.missTicks : 0;
+		}
+		if( c->used[i] < c->used[victim] )
+			victim = i;
+	}
+
+	c->misses[side]++;
+	mc.misses[side][addr]++;
+
+	// write-through does not allocate on a write miss
+	if( write && mc.writeThrough )
+		return mc.missTicks;
+
+	long ticks = mc.missTicks;
+
+	if( c->block[victim] >= 0 && c->dirty[victim] ) {
+		c->writebacks++;
+		ticks += mc.missTicks;
+	}
+
+	c->block[victim] = block;
+	c->used[victim] = mc.clock;
+	c->dirty[victim] = write;
+
+	return ticks;
+}
+
+//
+// cache_stall() - tick cpu, idle, for ticks ticks.
+//
+
+static void cache_stall( CpuContext &cpu, long ticks ) {
+	cpu.cache->stalls += ticks;
+	while( ticks-- > 0 )
+		cpu_tick( cpu );
+}
+
+//
+// cache_read() - MAR holds the address of a read from side that is
+// about to be made: look it up, and stall for a miss.
+//
+
+void cache_read( CpuContext &cpu, int side ) {
+	cache_stall( cpu, cache_access( *cpu.cache, side,
+		cpu.m.MAR().value(), false ) );
+}
+
+//
+// cache_write() - MAR holds the address of a write that is about to be
+// made: look it up, and stall for a miss or for writing it through.
+//
+
+void cache_write( CpuContext &cpu ) {
+	cache_stall( cpu, cache_access( *cpu.cache, CACHE_DATA,
+		cpu.m.MAR().value(), true ) );
+}
+
+//
+// by_misses() - qsort() order for the addresses of one side: most
+// misses first, then most accesses, then lowest address.
+//
+
+static const MemCache *sort_cache;
+static int sort_side;
+
+static int by_misses( const void *a, const void *b ) {
+	long x = *(const long *)a, y = *(const long *)b;
+	const long *misses = sort_cache->misses[sort_side];
+	const long *accesses = sort_cache->accesses[sort_side];
+
+	if( misses[x] != misses[y] )
+		return ( misses[x] > misses[y] ) ? -1 : 1;
+	if( accesses[x] != accesses[y] )
+		return ( accesses[x] > accesses[y] ) ? -1 : 1;
+	return ( x < y ) ? -1 : ( x > y );
+}
+
+//
+// cache_report() - print each cache's accesses and misses per side, the
+// write-backs and stall ticks, and the accesses and misses of every
+// address, most missed first.  cycles is the run's cycle count.
+//
+
+void cache_report( FILE *out, const MemCache &mc, long cycles ) {
+	long order[CACHE_MEM_SIZE];
+	long writebacks = 0, dirty = 0;
+
+	fprintf( out, "\nCaches (%s, a miss costs %ld ticks):\n"
+		"  %-8s %-5s %5s %5s %5s %12s %12s %9s\n",
+		mc.writeThrough ? "write-through" : "write-back", mc.missTicks, "",
+		"", "size", "ways", "line", "accesses", "misses", "miss rate" );
+
+	for( int n = 0; n < 2; n++ ) {
+		const Cache &c = mc.cache[n];
+
+		if( c.name == NULL )
+			continue;
+		for( int side = 0; side < 2; side++ ) {
+			if( mc.side[side] != &c )
+				continue;
+			fprintf( out, "  %-8s %-5s %5ld %5ld %5ld %12ld %12ld %8.2f%%\n",
+				c.name, side_names[side], c.size, c.ways, c.line,
+				c.accesses[side], c.misses[side], c.accesses[side] > 0 ?
+				100.0 * c.misses[side] / c.accesses[side] : 0.0 );
+		}
+
+		writebacks += c.writebacks;
+		for( long i = 0; i < c.sets * c.ways; i++ )
+			if( c.block[i] >= 0 && c.dirty[i] )
+				dirty++;
+	}
+
+	if( !mc.writeThrough )
+		fprintf( out, "  %ld dirty lines written back, %ld dirty at halt\n",
+			writebacks, dirty );
+	fprintf( out, "  %ld stall ticks, %.1f%% of %ld cycles\n", mc.stalls,
+		cycles > 0 ? 100.0 * mc.stalls / cycles : 0.0, cycles );
+
+	for( int side = 0; side < 2; side++ ) {
+		long n = 0;
+
+		if( mc.side[side] == NULL )
+			continue;
+
+		for( unsigned int a = 0; a < CACHE_MEM_SIZE; a++ )
+			if( mc.accesses[side][a] > 0 )
+				order[n++] = a;
+		if( n == 0 )
+			continue;
+		sort_cache = &mc;
+		sort_side = side;
+		qsort( order, n, sizeof( order[0] ), by_misses );
+
+		fprintf( out, "\n%s by %s address, most missed first:\n"
+			"  %-4s %12s %12s %9s\n", mc.side[side]->name, side_names[side],
+			"addr", "accesses", "misses", "miss rate" );
+		for( long i = 0; i < n; i++ ) {
+			long a = order[i];
+
+			fprintf( out, "  %03lx  %12ld %12ld %8.2f%%\n", a,
+				mc.accesses[side][a], mc.misses[side][a],
+				100.0 * mc.misses[side][a] / mc.accesses[side][a] );
+		}
+	}
+}
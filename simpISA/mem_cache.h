@@ -0,0 +1,60 @@
+// mem_cache.h
+//
+// Cache model for --cache, --icache and --dcache.
+//
+// The arch Memory answers every read and write in one tick.  With a
+// cache configured, every read fetch_into() makes and every write of
+// STORE, ISZ and SWP is first looked up in a model of a cache in front
+// of it: instruction fetches go to the instruction side and operands to
+// the data side, which are either one unified cache or an I-cache and a
+// D-cache.  A side with no cache goes straight to memory, as before.
+//
+// The model keeps tags only; the data is still in the Memory.  A miss
+// stalls the machine for --miss=N idle ticks (default 10) before the
+// access, on top of its usual tick:
+//
+//   write-back      a write allocates the line; a miss that evicts a
+//   (default)       dirty line costs another N ticks to write it back
+//   --write-through every write goes on to memory and costs N ticks; a
+//                   write miss does not allocate the line
+//
+// Lines are replaced least recently used.  Sizes are in 15-bit memory
+// words and must be powers of two.
+
+#ifndef _MEM_CACHE_H
+#define _MEM_CACHE_H
+
+const unsigned int CACHE_MEM_SIZE( FAST_MEM_SIZE );	// words of memory
+
+enum CacheSide { CACHE_FETCH, CACHE_DATA };
+
+struct Cache {
+	const char *name;
+	long size;						// words
+	long ways;
+	long line;						// words per line
+	long sets;
+
+	long block[CACHE_MEM_SIZE];		// [set * ways + way]: memory block held, or -1
+	bool dirty[CACHE_MEM_SIZE];
+	long used[CACHE_MEM_SIZE];		// when it was last hit or filled
+
+	long accesses[2];				// [CacheSide]
+	long misses[2];
+	long writebacks;				// dirty lines written back
+};
+
+struct MemCache {
+	Cache cache[2];					// I-cache and D-cache, or unified in [0]
+	Cache *side[2];					// [CacheSide]: its cache, or NULL
+	bool writeThrough;
+	long missTicks;
+	long clock;						// accesses so far, for LRU
+	long stalls;					// idle ticks the misses cost
+
+	// per fetch address (PC) and per data address
+	long accesses[2][CACHE_MEM_SIZE];
+	long misses[2][CACHE_MEM_SIZE];
+};
+
+#endif
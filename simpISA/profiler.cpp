@@ -0,0 +1,211 @@
+// profiler.C
+//
+// --profile and --profile-folded: the hot-spot report and folded-stack
+// file for a guest program.  See profiler.h.
+//
+// The folded-stack file has one line per executed instruction,
+//
+//   program;block_LLL;AAA_MNE cycles
+//
+// where LL is the address of the basic block the instruction at AA is
+// in, so flamegraph.pl and similar tools draw each block as a frame with
+// its instructions on top, sized by simulated cycles.
+
+#include "includes.h"
+
+struct ProfileBlock {
+	long start;				// leader address
+	long last;				// address of its last instruction
+	long instructions;		// how many instructions it has
+	long count;				// executions of the leader
+	long cycles;			// ticks of all its instructions
+};
+
+//
+// profile_reset() - nothing executed yet; the program starts at entry.
+//
+
+void profile_reset( Profile &p, long entry ) {
+	for( unsigned int pc = 0; pc < PROFILE_SIZE; pc++ ) {
+		p.count[pc] = 0;
+		p.cycles[pc] = 0;
+		p.target[pc] = -1;
+		p.ir[pc] = 0;
+		p.leader[pc] = false;
+	}
+	p.leader[entry & ( PROFILE_SIZE - 1 )] = true;
+}
+
+//
+// profile_blocks() - cut the executed addresses into basic blocks,
+// filling in block[] and, for each executed address, the index of its
+// block in owner[].  Returns the number of blocks.
+//
+// A block runs from a leader through the instructions that follow it
+// until one is a branch or HALT, or the next is a leader or never ran.
+// Executed instructions no leader reaches start blocks of their own.
+//
+
+static long profile_blocks( const Profile &p, ProfileBlock *block,
+	long *owner ) {
+	long blocks = 0;
+
+	for( unsigned int pc = 0; pc < PROFILE_SIZE; pc++ )
+		owner[pc] = -1;
+
+	for( int pass = 0; pass < 2; pass++ )
+		for( unsigned int start = 0; start < PROFILE_SIZE; start++ ) {
+			if( p.count[start] == 0 || owner[start] >= 0 )
+				continue;
+			if( pass == 0 && !p.leader[start] )
+				continue;
+
+			ProfileBlock &b = block[blocks];
+			long pc = start;
+
+			b.start = start;
+			b.instructions = 0;
+			b.count = p.count[start];
+			b.cycles = 0;
+
+			for( ;; ) {
+				unsigned int opc = profile_opc( p.ir[pc] );
+				long next = pc + 1;
+
+				owner[pc] = blocks;
+				b.last = pc;
+				b.instructions++;
+				b.cycles += p.cycles[pc];
+
+				if( profile_branch( opc ) || opc == HALT ||
+				    next >= (long)PROFILE_SIZE || p.count[next] == 0 ||
+				    p.leader[next] || owner[next] >= 0 )
+					break;
+				pc = next;
+			}
+
+			blocks++;
+		}
+
+	return blocks;
+}
+
+//
+// by_cycles() - qsort() order for addresses and blocks: most cycles
+// first, then lowest address.
+//
+
+static const Profile *sort_profile;
+
+static int by_cycles( const void *a, const void *b ) {
+	long x = *(const long *)a, y = *(const long *)b;
+
+	if( sort_profile->cycles[x] != sort_profile->cycles[y] )
+		return ( sort_profile->cycles[x] > sort_profile->cycles[y] ) ? -1 : 1;
+	return ( x < y ) ? -1 : ( x > y );
+}
+
+static int by_block_cycles( const void *a, const void *b ) {
+	const ProfileBlock *x = (const ProfileBlock *)a;
+	const ProfileBlock *y = (const ProfileBlock *)b;
+
+	if( x->cycles != y->cycles )
+		return ( x->cycles > y->cycles ) ? -1 : 1;
+	return ( x->start < y->start ) ? -1 : ( x->start > y->start );
+}
+
+//
+// profile_report() - print the executed addresses and the basic blocks,
+// hottest first.  total is the run's cycle count, for the percentages.
+//
+
+void profile_report( FILE *out, const Profile &p, long total ) {
+	ProfileBlock block[PROFILE_SIZE];
+	long owner[PROFILE_SIZE];
+	long order[PROFILE_SIZE];
+	long blocks, n = 0;
+	double scale = total > 0 ? 100.0 / total : 0.0;
+
+	for( unsigned int pc = 0; pc < PROFILE_SIZE; pc++ )
+		if( p.count[pc] > 0 )
+			order[n++] = pc;
+	sort_profile = &p;
+	qsort( order, n, sizeof( order[0] ), by_cycles );
+
+	fprintf( out, "\nHot spots by address:\n  %-4s %-4s %-5s %12s %12s %7s\n",
+		"addr", "ir", "op", "executions", "cycles", "% time" );
+	for( long i = 0; i < n; i++ ) {
+		long pc = order[i];
+
+		fprintf( out, "  %03lx  %04x %-5s %12ld %12ld %6.2f%%\n", pc,
+			p.ir[pc], op_mnemonics[profile_opc( p.ir[pc] )], p.count[pc],
+			p.cycles[pc], p.cycles[pc] * scale );
+	}
+
+	blocks = profile_blocks( p, block, owner );
+	qsort( block, blocks, sizeof( block[0] ), by_block_cycles );
+
+	fprintf( out, "\nHot basic blocks:\n  %-7s %6s %12s %12s %7s  %s\n",
+		"block", "instrs", "executions", "cycles", "% time", "exit" );
+	for( long i = 0; i < blocks; i++ ) {
+		const ProfileBlock &b = block[i];
+		unsigned int opc = profile_opc( p.ir[b.last] );
+
+		fprintf( out, "  %03lx-%03lx %6ld %12ld %12ld %6.2f%%  ", b.start,
+			b.last, b.instructions, b.count, b.cycles, b.cycles * scale );
+		if( p.target[b.last] >= 0 )
+			fprintf( out, "%s to %03lx\n", op_mnemonics[opc],
+				p.target[b.last] );
+		else if( profile_branch( opc ) )
+			fprintf( out, "%s never taken\n", op_mnemonics[opc] );
+		else if( opc == HALT )
+			fprintf( out, "HALT\n" );
+		else
+			fprintf( out, "falls through\n" );
+	}
+}
+
+//
+// profile_folded() - write the folded stacks for the program called
+// name to path.  Returns false if the file cannot be written.
+//
+
+bool profile_folded( const char *path, const Profile &p, const char *name ) {
+	ProfileBlock block[PROFILE_SIZE];
+	long owner[PROFILE_SIZE];
+	const char *base = strrchr( name, '/' );
+	FILE *fp = fopen( path, "w" );
+
+	if( fp == NULL ) {
+		fprintf( stderr, "Cannot create profile file %s\n", path );
+		return false;
+	}
+
+	base = ( base != NULL ) ? base + 1 : name;
+	profile_blocks( p, block, owner );
+
+	for( unsigned int pc = 0; pc < PROFILE_SIZE; pc++ )
+		if( p.count[pc] > 0 && p.cycles[pc] > 0 )
+			fprintf( fp, "%s;block_%03lx;%03x_%s %ld\n", base,
+				block[owner[pc]].start, pc,
+				op_mnemonics[profile_opc( p.ir[pc] )], p.cycles[pc] );
+
+	if( fclose( fp ) != 0 ) {
+		fprintf( stderr, "Cannot write profile file %s\n", path );
+		return false;
+	}
+
+	return true;
+}
+
+//
+// profile_done() - the run of the program called name is over: print
+// the report for --profile and write the file for --profile-folded.
+//
+
+void profile_done( FILE *out, const Profile &p, long total, const char *name ) {
+	if( show_profile )
+		profile_report( out, p, total );
+	if( profile_file != NULL )
+		profile_folded( profile_file, p, name );
+}
@@ -0,0 +1,63 @@
+// profiler.h
+//
+// Guest program hot-spot profiler for --profile and --profile-folded.
+//
+// Every instruction that retires adds one execution and the clock ticks
+// it took (fetch included) to the address it was fetched from.  A JUMP,
+// BZAC or ISZ also marks both where it went and the address after it as
+// basic block leaders, as does the entry point, so when the run is over
+// the executed addresses can be cut into the basic blocks the program
+// actually ran, each ending at a branch, a HALT, or the next leader.
+
+#ifndef _PROFILER_H
+#define _PROFILER_H
+
+const unsigned int PROFILE_SIZE( FAST_MEM_SIZE );	// one slot per address
+
+struct Profile {
+	long count[PROFILE_SIZE];	// executions of the instruction at each address
+	long cycles[PROFILE_SIZE];	// ticks they took
+	long target[PROFILE_SIZE];	// where a branch there last went, or -1
+	unsigned short ir[PROFILE_SIZE];	// instruction word last executed there
+	bool leader[PROFILE_SIZE];	// does a basic block start here?
+};
+
+//
+// profile_opc() - the op code of instruction word ir.
+//
+
+inline unsigned int profile_opc( long ir ) {
+	return ( ir >> ( DATA_BITS - 3 ) ) & 7;
+}
+
+//
+// profile_branch() - can op code opc send PC somewhere other than the
+// next address?  ISZ can skip it.
+//
+
+inline bool profile_branch( unsigned int opc ) {
+	return opc == JUMP || opc == BZAC || opc == ISZ;
+}
+
+//
+// profile_add() - instruction ir at pc retired after the given ticks,
+// leaving PC at next.
+//
+
+inline void profile_add( Profile &p, long pc, long ir, long cycles,
+	long next ) {
+	pc &= PROFILE_SIZE - 1;
+	p.count[pc]++;
+	p.cycles[pc] += cycles;
+	p.ir[pc] = ir;
+
+	if( profile_branch( profile_opc( ir ) ) ) {
+		next &= PROFILE_SIZE - 1;
+		p.leader[next] = true;
+		p.leader[( pc + 1 ) & ( PROFILE_SIZE - 1 )] = true;
+		if( next != (long)( ( pc + 1 ) & ( PROFILE_SIZE - 1 ) ) )
+			p.target[pc] = next;
+	}
+}
+
+#endif
@@ -10,11 +10,51 @@
 #ifndef _PROTOTYPES_H
 #define _PROTOTYPES_H
 
-void clear_ac();
-void add_to_ac();
-void execute();
-void fetch_into( StorageObject &, Bus &, StorageObject & );
-void make_connections();
-void run_simulation( char * );
+void load_to_ac( CpuContext & );
+void store_to_mem( CpuContext & );
+void increment_skip_if_result_equals_zero( CpuContext & );
+void jump( CpuContext & );
+void halt( CpuContext & );
+void branch_if_ac_equals_zero( CpuContext & );
+void add_to_ac( CpuContext & );
+void swap_mem_with_ac( CpuContext & );
+void clear_ac( CpuContext & );
+void trace_instr( CpuContext &, const char * );
+void fetch_into( CpuContext &, StorageObject &, Bus &, StorageObject & );
+void fetch_overlapped( CpuContext &, StorageObject &, Bus &,
+	StorageObject & );
+void fetch_start( CpuContext & );
+void make_connections( CpuContext & );
+void run_simulation( CpuContext &, char * );
+double host_seconds();
+
+void fast_reset( FastCpu & );
+bool fast_load( FastCpu &, char * );
+void fast_interpret( FastCpu &, long );
+void fast_resume( FastCpu &, const char * );
+bool fast_run( FastCpu &, char * );
+void run_fast( char * );
+bool load_object( char *, unsigned short *, long & );
+bool is_image( const char * );
+bool write_image( const char *, const unsigned short *, long );
+void snapshot_take( Snapshot &, const FastCpu & );
+void snapshot_fork( Snapshot &, const Snapshot & );
+void snapshot_poke( Snapshot &, long, long );
+void snapshot_restore( FastCpu &, const Snapshot & );
+void snapshot_free( Snapshot & );
+bool snapshot_save( Snapshot &, const char * );
+bool snapshot_load( Snapshot &, const char * );
+bool run_save( char *, char *, long );
+bool run_restore( char * );
+int run_variants( char *, char * );
+void profile_reset( Profile &, long );
+void profile_report( FILE *, const Profile &, long );
+bool profile_folded( const char *, const Profile &, const char * );
+void profile_done( FILE *, const Profile &, long, const char * );
+bool cache_parse( const char *, long &, long &, long & );
+void cache_reset( MemCache & );
+void cache_read( CpuContext &, int );
+void cache_write( CpuContext & );
+void cache_report( FILE *, const MemCache &, long );
 
 #endif
@@ -11,50 +11,212 @@
 
 #include "includes.h"
 
-void run_simulation( char *objfile ) {
+#include <sys/time.h>
+
+//
+// host_seconds() - wall clock time, for the instructions per second
+// figure printed with --stats.
+//
+
+double host_seconds() {
+	struct timeval tv;
+
+	gettimeofday( &tv, NULL );
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+//
+// The fetch-execute loop is written once with these macros and compiled
+// either as a direct-threaded interpreter (GCC computed gotos: the code
+// for every op code ends with its own fetch and indirect jump to the
+// next instruction) or as a portable loop around a switch.  Define
+// NO_THREADED_DISPATCH to get the switch with GCC as well.
+//
+//   FETCH()      fetch the next instruction into ir, stop on PC overflow,
+//                record its address and value for the trace, bump PC;
+//                sets opc.  With --overlap the read goes with the PC
+//                increment, and if START() has moved PC into MAR
+//                already, the first tick is skipped
+//   INSTR( l )   start the code for op code label l
+//   START()      with --overlap, start the next instruction's fetch in
+//                the final tick; only for LOAD, ADD and an untaken BZAC,
+//                whose final tick leaves PC, MAR and the address bus alone
+//   NEXT()       go on with the next instruction
+//   PROFILE()    with --profile, add the instruction's ticks since
+//                FETCH() and where PC went to the profile
+//
+// HALT and SWP record their own trace, and the others record theirs
+// before the final tick.
+//
+
+#if defined( __GNUC__ ) && !defined( NO_THREADED_DISPATCH )
+#define THREADED_DISPATCH
+#endif
+
+#define FETCH() \
+	cycles = cpu.cycles; \
+	fetch_overlapped( cpu, cpu.pc, cpu.abus, cpu.mdr ); \
+	if( cpu.pc.value() == 0xfff ) \
+		goto overflow; \
+	cpu.trace.rec.pc = cpu.pc.value(); \
+	cpu.pc.incr(); \
+	cpu_tick( cpu ); \
+	cpu.trace.rec.ir = cpu.mdr.value(); \
+	cpu.dbus.IN().pullFrom( cpu.mdr ); \
+	cpu.ir.latchFrom( cpu.dbus.OUT() ); \
+	cpu_tick( cpu ); \
+	opc = cpu.ir( DATA_BITS-1, DATA_BITS-3 ); \
+	count++
+
+#define START() \
+	if( overlap_fetch ) \
+		fetch_start( cpu )
+
+#define PROFILE() \
+	if( profile != NULL ) \
+		profile_add( *profile, cpu.trace.rec.pc, cpu.trace.rec.ir, \
+			cpu.cycles - cycles, cpu.pc.value() )
+
+#ifdef THREADED_DISPATCH
+#define INSTR( l )	L_##l:
+#define NEXT()		cpu_tick( cpu ); \
+					trace_retire( cpu.trace, cpu.ac.value() ); \
+					PROFILE(); FETCH(); goto *dispatch[opc]
+#else
+#define INSTR( l )	case l:
+#define NEXT()		cpu_tick( cpu ); \
+					trace_retire( cpu.trace, cpu.ac.value() ); \
+					PROFILE(); continue
+#endif
+
+void run_simulation( CpuContext &cpu, char *objfile ) {
+	long opc;
+	long count = 0, cycles;
+	Profile *profile = NULL;
+	double start;
 
 	// step 1:  load the object file
 
-	m.load( objfile );
+	cpu.m.load( objfile );
+	cpu.fetchStarted = false;
 
 	// step 2:  set the entry point
 
-	pc.latchFrom( m.READ() );
-	Clock::tick();
+	cpu.pc.latchFrom( cpu.m.READ() );
+	cpu_tick( cpu );
 
 	// step 3:  continue fetching, decoding, and executing instructions
 	// until we stop the simulation
 
-	while( !done ) {
+	if( show_profile || profile_file != NULL ) {
+		profile = new Profile;
+		profile_reset( *profile, cpu.pc.value() );
+	}
 
-		// instruction fetch
+	if( cache_spec != NULL || icache_spec != NULL || dcache_spec != NULL ) {
+		cpu.cache = new MemCache;
+		cache_reset( *cpu.cache );
+	}
+
+	start = host_seconds();
+
+#ifdef THREADED_DISPATCH
+	static void *const dispatch[8] = {
+		&&L_LOAD, &&L_STORE, &&L_ISZ, &&L_JUMP,
+		&&L_HALT, &&L_BZAC, &&L_ADD, &&L_SWP
+	};
 
-		fetch_into( pc, abus, mdr );
+	FETCH();
+	goto *dispatch[opc];
+#else
+	for( ;; ) {
+		FETCH();
+
+		switch( opc ) {
+#endif
+
+		// decode and execute
 
-		// check for PC overflow
-		if (pc.value() == 0xfff) {
-			cout << endl << "MACHINE HALTED due to PC overflow" << endl << endl;
-			done = true;
-			break;
+		INSTR( LOAD )
+			load_to_ac( cpu );
+			trace_instr( cpu, "LOAD" );
+			START();
+			NEXT();
+
+		INSTR( STORE )
+			store_to_mem( cpu );
+			trace_instr( cpu, "STORE" );
+			NEXT();
+
+		INSTR( ISZ )
+			increment_skip_if_result_equals_zero( cpu );
+			trace_instr( cpu, "ISZ" );
+			NEXT();
+
+		INSTR( JUMP )
+			jump( cpu );
+			trace_instr( cpu, "JUMP" );
+			NEXT();
+
+		INSTR( BZAC )
+			branch_if_ac_equals_zero( cpu );
+			trace_instr( cpu, "BZAC" );
+			if( cpu.ac.value() != 0 )
+				START();
+			NEXT();
+
+		INSTR( ADD )
+			add_to_ac( cpu );
+			trace_instr( cpu, "ADD" );
+			START();
+			NEXT();
+
+		INSTR( SWP )
+			swap_mem_with_ac( cpu );
+			NEXT();
+
+		INSTR( HALT )
+			halt( cpu );
+			cpu_tick( cpu );
+			trace_halt( cpu.trace );
+			PROFILE();
+			goto halted;
+
+#ifndef THREADED_DISPATCH
 		}
+	}
+#endif
 
-		// print the instruction's address (pc) and data (memory data register) values in hexadecimal
-		printf("%03x:  %04x = ", pc.value(), mdr.value());
+overflow:
+	trace_overflow( cpu.trace );
+	cpu.done = true;
 
-		// bump PC for next instruction
+halted:
+	trace_end( cpu.trace );
 
-		pc.incr();
-		Clock::tick();
+	if( show_stats ) {
+		double elapsed = host_seconds() - start;
 
-		// move instruction into IR
+		printf( "%ld instructions in %.3f s host time (%.0f instructions/sec)\n",
+			count, elapsed, elapsed > 0 ? count / elapsed : 0.0 );
+	}
 
-		dbus.IN().pullFrom( mdr );
-		ir.latchFrom( dbus.OUT() );
-		Clock::tick();
+	if( overlap_fetch ) {
+		long baseline = cpu.cycles + cpu.overlapped;
 
-		// decode and execute
+		printf( "\nFetch overlap: %ld cycles, %ld without overlap (%ld saved,"
+			" %.1f%%)\n", cpu.cycles, baseline, cpu.overlapped,
+			baseline > 0 ? 100.0 * cpu.overlapped / baseline : 0.0 );
+	}
+
+	if( profile != NULL ) {
+		profile_done( stdout, *profile, cpu.cycles, objfile );
+		delete profile;
+	}
 
-		execute();
-		printf("\n");
+	if( cpu.cache != NULL ) {
+		cache_report( stdout, *cpu.cache, cpu.cycles );
+		delete cpu.cache;
+		cpu.cache = NULL;
 	}
 }
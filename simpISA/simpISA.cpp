@@ -23,20 +23,197 @@ int main ( int argc, char *argv[] ) {
 
 	// CPUObject::debug |= CPUObject::trace | CPUObject::memload;
 
-	// make sure we've been given an object file name
+	// pick up the options, and make sure we've been given an object
+	// file name
+	//
+	//   --mode=rtl    run the arch register-transfer model (default)
+	//   --mode=fast   run the functional engine in fast_engine.cpp, which
+	//                 also loads memory images made by simpisa-image
+	//   --stats       print run statistics when the machine halts
+	//   --flight=N    keep only the last N instructions of the trace, and
+	//                 print them only if the machine halts on an error
+	//   --fold        print each loop in the trace once, with how many
+	//                 times it went round
+	//   --save=FILE   run the first N (--at=N, default 0) instructions on
+	//                 the fast engine and save the machine to FILE
+	//   --restore=FILE
+	//                 run the machine saved in FILE on to the halt on the
+	//                 fast engine, in place of an object file
+	//   --variants=LIST
+	//                 --restore: run a copy of the saved machine for each
+	//                 line of LIST, with the memory words (AAA=VVVV) and
+	//                 registers (AC=VVVV, PC=VVV) it gives changed
+	//   --limit=N     --variants: stop each copy after N instructions
+	//                 (default 1000000, 0 = no limit)
+	//   --profile     print executions and cycles per address and per
+	//                 basic block of the program, hottest first, at halt
+	//   --profile-folded=FILE
+	//                 write the cycles per instruction to FILE as folded
+	//                 stacks (program;block;instruction), for flame graphs
+	//   --overlap     RTL model: do memory reads in parallel with the next
+	//                 register transfer, and start each fetch in the final
+	//                 tick of the instruction before when it can; print the
+	//                 cycles with and without
+	//   --cache=SIZE,WAYS,LINE
+	//                 RTL model: put a unified cache of SIZE words, WAYS
+	//                 ways and LINE-word lines in front of memory, and
+	//                 print its misses per fetch and data address at halt
+	//   --icache=SIZE,WAYS,LINE, --dcache=SIZE,WAYS,LINE
+	//                 RTL model: the same, with separate instruction and
+	//                 data caches (or either one alone)
+	//   --write-through
+	//                 caches write every store on to memory instead of
+	//                 writing dirty lines back when they are replaced
+	//   --miss=N      ticks a cache miss stalls for (default 10)
+
+	char *objfile = NULL;
+	char *savefile = NULL;
+	char *restorefile = NULL;
+	char *variantfile = NULL;
+	long saveAt = 0;
+	bool badArgs = false;
+
+	for( int i = 1; i < argc; i++ ) {
+		if( strcmp( argv[i], "--mode=rtl" ) == 0 )
+			sim_mode = MODE_RTL;
+		else if( strcmp( argv[i], "--mode=fast" ) == 0 )
+			sim_mode = MODE_FAST;
+		else if( strcmp( argv[i], "--stats" ) == 0 )
+			show_stats = true;
+		else if( strncmp( argv[i], "--flight=", 9 ) == 0 ) {
+			flight_size = atol( argv[i] + 9 );
+			if( flight_size <= 0 )
+				badArgs = true;
+		}
+		else if( strcmp( argv[i], "--fold" ) == 0 )
+			fold_trace = true;
+		else if( strncmp( argv[i], "--save=", 7 ) == 0 )
+			savefile = argv[i] + 7;
+		else if( strncmp( argv[i], "--at=", 5 ) == 0 )
+			saveAt = atol( argv[i] + 5 );
+		else if( strncmp( argv[i], "--restore=", 10 ) == 0 )
+			restorefile = argv[i] + 10;
+		else if( strncmp( argv[i], "--variants=", 11 ) == 0 )
+			variantfile = argv[i] + 11;
+		else if( strncmp( argv[i], "--limit=", 8 ) == 0 )
+			variant_limit = atol( argv[i] + 8 );
+		else if( strcmp( argv[i], "--profile" ) == 0 )
+			show_profile = true;
+		else if( strncmp( argv[i], "--profile-folded=", 17 ) == 0 )
+			profile_file = argv[i] + 17;
+		else if( strcmp( argv[i], "--overlap" ) == 0 )
+			overlap_fetch = true;
+		else if( strncmp( argv[i], "--cache=", 8 ) == 0 )
+			cache_spec = argv[i] + 8;
+		else if( strncmp( argv[i], "--icache=", 9 ) == 0 )
+			icache_spec = argv[i] + 9;
+		else if( strncmp( argv[i], "--dcache=", 9 ) == 0 )
+			dcache_spec = argv[i] + 9;
+		else if( strcmp( argv[i], "--write-through" ) == 0 )
+			write_through = true;
+		else if( strncmp( argv[i], "--miss=", 7 ) == 0 ) {
+			miss_ticks = atol( argv[i] + 7 );
+			if( miss_ticks < 0 )
+				badArgs = true;
+		}
+		else if( argv[i][0] != '-' && objfile == NULL )
+			objfile = argv[i];
+		else
+			badArgs = true;
+	}
 
-	if( argc != 2 ) {
-		cerr << "Usage:  " << argv[0] << " object-file-name\n\n";
+	if( fold_trace && flight_size > 0 )
+		badArgs = true;
+	if( ( objfile != NULL ) + ( restorefile != NULL ) != 1 )
+		badArgs = true;
+
+	// a snapshot is of one machine, and variants start from one
+	if( savefile != NULL && objfile == NULL )
+		badArgs = true;
+	if( variantfile != NULL &&
+	    ( restorefile == NULL || flight_size > 0 || fold_trace ) )
+		badArgs = true;
+
+	// the profile is of one run
+	if( ( show_profile || profile_file != NULL ) && variantfile != NULL )
+		badArgs = true;
+
+	// overlapping changes the RTL model's timing only
+	if( overlap_fetch && ( sim_mode != MODE_RTL || objfile == NULL ||
+	    savefile != NULL ) )
+		badArgs = true;
+
+	// the caches are one unified one or a split pair, each SIZE,WAYS,LINE
+	const char *caches[3] = { cache_spec, icache_spec, dcache_spec };
+	long size, ways, line;
+
+	if( cache_spec != NULL && ( icache_spec != NULL || dcache_spec != NULL ) )
+		badArgs = true;
+	for( int i = 0; i < 3; i++ )
+		if( caches[i] != NULL && !cache_parse( caches[i], size, ways, line ) )
+			badArgs = true;
+
+	// they stall the RTL model's reads and writes
+	if( ( cache_spec != NULL || icache_spec != NULL || dcache_spec != NULL ) &&
+	    ( sim_mode != MODE_RTL || objfile == NULL || savefile != NULL ) )
+		badArgs = true;
+	if( write_through && cache_spec == NULL && icache_spec == NULL &&
+	    dcache_spec == NULL )
+		badArgs = true;
+
+	if( badArgs ) {
+		cerr << "Usage:  " << argv[0]
+		     << " [--mode=rtl|--mode=fast] [--stats] [--flight=N|--fold]"
+		     << " [--profile] [--profile-folded=FILE] [--overlap]"
+		     << " [--cache=S,W,L|--icache=S,W,L --dcache=S,W,L]"
+		     << " [--write-through] [--miss=N] object-file-name\n"
+		     << "        " << argv[0]
+		     << " --save=FILE [--at=N] [--flight=N|--fold] object-file-name\n"
+		     << "        " << argv[0]
+		     << " --restore=FILE [--stats] [--flight=N|--fold] [--profile]"
+		     << " [--profile-folded=FILE]\n"
+		     << "        " << argv[0]
+		     << " --restore=FILE --variants=LIST [--limit=N] [--stats]\n\n";
 		exit( 1 );
 	}
 
+	if( savefile != NULL )
+		return( run_save( objfile, savefile, saveAt ) ? 0 : 1 );
+	if( variantfile != NULL )
+		return( run_variants( restorefile, variantfile ) == 0 ? 0 : 1 );
+	if( restorefile != NULL )
+		return( run_restore( restorefile ) ? 0 : 1 );
+
 	cout << hex; // change base for future printing
 
 	try {
 
-		make_connections();
+		if( sim_mode == MODE_FAST ) {
+
+			run_fast( objfile );
+
+		}
+		else {
+
+			// Memory::load() reads text object files only
+			if( is_image( objfile ) ) {
+				cerr << objfile << " is a memory image; run it with"
+				     << " --mode=fast\n";
+				return( 1 );
+			}
+
+			CpuContext cpu;
+
+			if( flight_size > 0 )
+				trace_open_ring( cpu.trace, flight_size );
+			if( fold_trace )
+				trace_open_fold( cpu.trace );
+
+			make_connections( cpu );
+
+			run_simulation( cpu, objfile );
 
-		run_simulation( argv[1] );
+		}
 
 	}
 
@@ -0,0 +1,366 @@
+// simpisa_bench.C
+//
+// simpisa-bench: simulated instructions per second for every op code,
+// on the RTL model and the fast engine.
+//
+//   simpisa-bench [--time=S] [--engine=rtl|fast]... [json-file]
+//
+// For each op code but HALT it builds a program whose loop body is
+// BENCH_BODY copies of the instruction, run BENCH_ITERATIONS times by an
+// ISZ on a counter word, and runs it with the trace off until at least S
+// host seconds (default 0.1) have gone by.  It prints million
+// instructions per second per op code and engine, and with json-file
+// also writes every result, with ns per instruction, as JSON for
+// comparing builds.
+//
+// JUMP and BZAC go to the next instruction, ISZ counts up a word that
+// does not reach zero in one run, and the others work on BENCH_DATA.
+
+#include "includes.h"
+
+#include <unistd.h>
+
+const int BENCH_BODY( 64 );				// copies of the instruction per pass
+const int BENCH_ITERATIONS( 256 );		// passes: the counter reaches 0
+const unsigned int BENCH_COUNTER( 0x800 );	// the ISZ loop counter
+const unsigned int BENCH_DATA( 0x801 );	// what LOAD, STORE, ADD and SWP use
+const unsigned int BENCH_COUNT( 0x802 );	// what the ISZ under test counts
+
+enum BenchEngine { BENCH_RTL, BENCH_FAST, BENCH_ENGINES };
+
+static const char *const engine_names[BENCH_ENGINES] = { "rtl", "fast" };
+
+struct BenchResult {
+	long instructions;		// instructions run, all runs
+	long runs;				// times the program was run
+	double seconds;			// host time they took
+};
+
+//
+// usage() - print the usage message and exit.
+//
+
+static void usage( char *name ) {
+	cerr << "Usage:  " << name
+	     << " [--time=S] [--engine=rtl|fast]... [json-file]\n\n";
+	exit( 1 );
+}
+
+//
+// bench_program() - build the program for op code opc in mem.  Returns
+// the instructions one run executes, or 0 if opc is not benchmarked.
+//
+
+static long bench_program( int opc, unsigned short *mem ) {
+	unsigned int pc = 0;
+
+	if( opc == HALT )
+		return 0;
+
+	memset( mem, 0, FAST_MEM_SIZE * sizeof( mem[0] ) );
+
+	for( int i = 0; i < BENCH_BODY; i++ ) {
+		unsigned int addr = BENCH_DATA;
+
+		if( opc == JUMP || opc == BZAC )
+			addr = pc + 1;
+		else if( opc == ISZ )
+			addr = BENCH_COUNT;
+		mem[pc++] = ( opc << ( DATA_BITS - 3 ) ) | addr;
+	}
+
+	mem[pc++] = ( ISZ << ( DATA_BITS - 3 ) ) | BENCH_COUNTER;
+	mem[pc++] = ( JUMP << ( DATA_BITS - 3 ) ) | 0;
+	mem[pc++] = HALT << ( DATA_BITS - 3 );
+
+	mem[BENCH_COUNTER] = ( 1 << DATA_BITS ) - BENCH_ITERATIONS;
+	mem[BENCH_DATA] = 1;
+	mem[BENCH_COUNT] = 1;
+
+	return BENCH_ITERATIONS * ( BENCH_BODY + 2 );
+}
+
+//
+// write_object() - write every 16-word block of mem that is not all
+// zero as a text object file for Memory::load(), entry point 0.
+// Returns false if it cannot be written.
+//
+
+static bool write_object( const char *path, const unsigned short *mem ) {
+	FILE *fp = fopen( path, "w" );
+
+	if( fp == NULL ) {
+		fprintf( stderr, "Cannot create object file %s\n", path );
+		return false;
+	}
+
+	for( unsigned int addr = 0; addr < FAST_MEM_SIZE; addr += 16 ) {
+		bool used = false;
+
+		for( unsigned int i = 0; i < 16; i++ )
+			used = used || mem[addr + i] != 0;
+		if( !used )
+			continue;
+
+		fprintf( fp, "%x 10", addr );
+		for( unsigned int i = 0; i < 16; i++ )
+			fprintf( fp, " %x", mem[addr + i] );
+		fprintf( fp, "\n" );
+	}
+	fprintf( fp, "0\n" );
+
+	return fclose( fp ) == 0;
+}
+
+//
+// bench_fast() - run the program in image on the fast engine until min
+// seconds have gone by.  Returns false if a run did not execute expect
+// instructions.
+//
+
+static bool bench_fast( FastCpu &cpu, const unsigned short *image,
+	double min, long expect, BenchResult &r ) {
+	do {
+		fast_reset( cpu );
+		trace_off( cpu.trace );
+		memcpy( cpu.mem, image, sizeof( cpu.mem ) );
+		cpu.pc = 0;
+
+		double start = host_seconds();
+
+		fast_interpret( cpu, -1 );
+		r.seconds += host_seconds() - start;
+		r.instructions += cpu.instructions;
+		r.runs++;
+
+		if( cpu.instructions != expect )
+			return false;
+	} while( r.seconds < min );
+
+	return true;
+}
+
+//
+// bench_rtl() - run the object file on the RTL model until min seconds
+// have gone by.  The time includes Memory::load().
+//
+
+static void bench_rtl( CpuContext &cpu, char *objfile, double min,
+	long expect, BenchResult &r ) {
+	do {
+		double start = host_seconds();
+
+		cpu.done = false;
+		run_simulation( cpu, objfile );
+		r.seconds += host_seconds() - start;
+		r.instructions += expect;
+		r.runs++;
+	} while( r.seconds < min );
+}
+
+//
+// mips() - million instructions per host second.
+//
+
+static double mips( const BenchResult &r ) {
+	return r.seconds > 0 ? r.instructions / r.seconds / 1e6 : 0.0;
+}
+
+//
+// json_result() - one result object, for op code opc, or with opc -1
+// for an engine's total.  last leaves off the comma.
+//
+
+static void json_result( FILE *fp, BenchEngine engine, int opc,
+	const BenchResult &r, bool last ) {
+	fprintf( fp, "    { \"engine\": \"%s\", ", engine_names[engine] );
+	if( opc >= 0 )
+		fprintf( fp, "\"opc\": %d, \"op\": \"%s\", ", opc, op_mnemonics[opc] );
+	fprintf( fp, "\"instructions\": %ld, \"runs\": %ld, \"seconds\": %.6f, "
+		"\"mips\": %.3f, \"ns_per_instruction\": %.2f }%s\n", r.instructions,
+		r.runs, r.seconds, mips( r ),
+		r.instructions > 0 ? r.seconds * 1e9 / r.instructions : 0.0,
+		last ? "" : "," );
+}
+
+int main( int argc, char *argv[] ) {
+	BenchResult result[8][BENCH_ENGINES];
+	BenchResult total[BENCH_ENGINES];
+	bool wanted[BENCH_ENGINES];
+	bool anyEngine = false;
+	char *jsonfile = NULL;
+	double min = 0.1;
+
+	for( int i = 0; i < BENCH_ENGINES; i++ )
+		wanted[i] = false;
+
+	for( int i = 1; i < argc; i++ ) {
+		if( strncmp( argv[i], "--time=", 7 ) == 0 ) {
+			min = atof( argv[i] + 7 );
+			if( min < 0 )
+				usage( argv[0] );
+		}
+		else if( strncmp( argv[i], "--engine=", 9 ) == 0 ) {
+			int n;
+
+			for( n = 0; n < BENCH_ENGINES; n++ )
+				if( strcmp( argv[i] + 9, engine_names[n] ) == 0 )
+					break;
+			if( n == BENCH_ENGINES )
+				usage( argv[0] );
+			wanted[n] = anyEngine = true;
+		}
+		else if( argv[i][0] != '-' && jsonfile == NULL )
+			jsonfile = argv[i];
+		else
+			usage( argv[0] );
+	}
+
+	if( !anyEngine )
+		for( int i = 0; i < BENCH_ENGINES; i++ )
+			wanted[i] = true;
+
+	memset( result, 0, sizeof( result ) );
+	memset( total, 0, sizeof( total ) );
+
+	FastCpu *cpu = new FastCpu;
+	char objfile[] = "/tmp/simpisa-bench-XXXXXX";
+	int fd = mkstemp( objfile );
+
+	if( fd < 0 ) {
+		fprintf( stderr, "Cannot create a temporary object file\n" );
+		return( 1 );
+	}
+	close( fd );
+
+	try {
+
+		CpuContext rtl;
+
+		trace_off( rtl.trace );
+		make_connections( rtl );
+
+		for( int opc = 0; opc < 8; opc++ ) {
+			static unsigned short image[FAST_MEM_SIZE];
+			long expect = bench_program( opc, image );
+
+			if( expect == 0 )
+				continue;
+
+			for( int n = 0; n < BENCH_ENGINES; n++ ) {
+				if( !wanted[n] )
+					continue;
+
+				if( n == BENCH_RTL ) {
+					if( !write_object( objfile, image ) )
+						return( 1 );
+					bench_rtl( rtl, objfile, min, expect, result[opc][n] );
+				}
+				else if( !bench_fast( *cpu, image, min, expect,
+				    result[opc][n] ) ) {
+					fprintf( stderr, "%s ran %ld instructions on the fast "
+						"engine, not %ld\n", op_mnemonics[opc],
+						cpu->instructions, expect );
+					unlink( objfile );
+					return( 1 );
+				}
+
+				total[n].instructions += result[opc][n].instructions;
+				total[n].runs += result[opc][n].runs;
+				total[n].seconds += result[opc][n].seconds;
+			}
+		}
+
+	}
+
+	catch( ArchLibError &err ) {
+
+		cout << endl
+		     << "Simulation aborted - ArchLib runtime error"
+		     << endl
+		     << "Cause:  " << err.what() << endl;
+		unlink( objfile );
+		return( 1 );
+
+	}
+
+	unlink( objfile );
+	delete cpu;
+
+	// the table, million instructions per second
+	printf( "\nMillion simulated instructions per second:\n  %-5s", "op" );
+	for( int n = 0; n < BENCH_ENGINES; n++ )
+		if( wanted[n] )
+			printf( " %9s", engine_names[n] );
+	printf( "\n" );
+
+	for( int opc = 0; opc < 8; opc++ ) {
+		if( opc == HALT )
+			continue;
+
+		printf( "  %-5s", op_mnemonics[opc] );
+		for( int n = 0; n < BENCH_ENGINES; n++ )
+			if( wanted[n] )
+				printf( " %9.3f", mips( result[opc][n] ) );
+		printf( "\n" );
+	}
+
+	printf( "  %-5s", "all" );
+	for( int n = 0; n < BENCH_ENGINES; n++ )
+		if( wanted[n] )
+			printf( " %9.3f", mips( total[n] ) );
+	printf( "\n" );
+
+	if( jsonfile == NULL )
+		return( 0 );
+
+	FILE *fp = fopen( jsonfile, "w" );
+	char host[256];
+	char date[64];
+	time_t now = time( NULL );
+	int last = -1;
+
+	if( fp == NULL ) {
+		fprintf( stderr, "Cannot create JSON file %s\n", jsonfile );
+		return( 1 );
+	}
+
+	if( gethostname( host, sizeof( host ) ) != 0 )
+		strcpy( host, "unknown" );
+	host[sizeof( host ) - 1] = '\0';
+	strftime( date, sizeof( date ), "%Y-%m-%dT%H:%M:%SZ", gmtime( &now ) );
+
+	fprintf( fp, "{\n  \"benchmark\": \"simpisa-bench\",\n"
+		"  \"date\": \"%s\",\n  \"host\": \"%s\",\n  \"body\": %d,\n"
+		"  \"iterations\": %d,\n  \"min_seconds\": %.3f,\n"
+		"  \"results\": [\n", date, host, BENCH_BODY, BENCH_ITERATIONS, min );
+
+	for( int opc = 0; opc < 8; opc++ )
+		for( int n = 0; n < BENCH_ENGINES; n++ )
+			if( result[opc][n].runs > 0 )
+				last = opc * BENCH_ENGINES + n;
+
+	for( int opc = 0; opc < 8; opc++ )
+		for( int n = 0; n < BENCH_ENGINES; n++ )
+			if( result[opc][n].runs > 0 )
+				json_result( fp, (BenchEngine)n, opc, result[opc][n],
+					opc * BENCH_ENGINES + n == last );
+
+	fprintf( fp, "  ],\n  \"engines\": [\n" );
+
+	for( int n = 0; n < BENCH_ENGINES; n++ )
+		if( wanted[n] )
+			last = n;
+	for( int n = 0; n < BENCH_ENGINES; n++ )
+		if( wanted[n] )
+			json_result( fp, (BenchEngine)n, -1, total[n], n == last );
+
+	fprintf( fp, "  ]\n}\n" );
+
+	if( fclose( fp ) != 0 ) {
+		fprintf( stderr, "Cannot write JSON file %s\n", jsonfile );
+		return( 1 );
+	}
+
+	return( 0 );
+}
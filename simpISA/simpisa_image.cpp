@@ -0,0 +1,28 @@
+// simpisa_image.C
+//
+// simpisa-image: convert a simpISA text object file into a binary memory
+// image, which simpISA --mode=fast loads by copying it instead of
+// parsing it.
+//
+//   simpisa-image object-file image-file
+//
+// See loader.h for the image layout.
+
+#include "includes.h"
+
+int main( int argc, char *argv[] ) {
+	static unsigned short mem[FAST_MEM_SIZE];
+	long entry;
+
+	if( argc != 3 ) {
+		cerr << "Usage:  " << argv[0] << " object-file image-file\n\n";
+		exit( 1 );
+	}
+
+	if( !load_object( argv[1], mem, entry ) )
+		return( 1 );
+	if( !write_image( argv[2], mem, entry ) )
+		return( 1 );
+
+	return( 0 );
+}
@@ -0,0 +1,473 @@
+// snapshot.C
+//
+// Machine snapshots for the fast engine: taking, forking with
+// copy-on-write memory pages, poking, restoring, and saving to and
+// loading from a file (see snapshot.h), and the three ways simpISA uses
+// them:
+//
+//   --save=FILE --at=N      run N instructions and save the machine
+//   --restore=FILE          run a saved machine on to the halt
+//   --variants=LIST         run one fork of the saved machine per line
+//                           of LIST, each with its own changes
+
+#include "includes.h"
+
+const char SNAP_MAGIC[4] = { 'S', 'I', 'S', '1' };
+
+//
+// snapshot_regs() - the register fields of s, in file order.
+//
+
+static void snapshot_regs( Snapshot &s, long *reg[SNAP_REGS] ) {
+	reg[0] = &s.ir;
+	reg[1] = &s.ac;
+	reg[2] = &s.pc;
+	reg[3] = &s.done;
+	reg[4] = &s.cycles;
+	reg[5] = &s.instructions;
+}
+
+//
+// snapshot_take() - the state of cpu, in pages of its own.
+//
+
+void snapshot_take( Snapshot &s, const FastCpu &cpu ) {
+	s.ir = cpu.ir;
+	s.ac = cpu.ac;
+	s.pc = cpu.pc;
+	s.done = cpu.done;
+	s.cycles = cpu.cycles;
+	s.instructions = cpu.instructions;
+
+	for( unsigned int p = 0; p < SNAP_PAGES; p++ ) {
+		s.page[p] = new SnapPage;
+		s.page[p]->refs = 1;
+		memcpy( s.page[p]->data, cpu.mem + p * SNAP_PAGE_SIZE,
+			sizeof( s.page[p]->data ) );
+	}
+}
+
+//
+// snapshot_fork() - make s a copy of parent that shares all its pages.
+//
+
+void snapshot_fork( Snapshot &s, const Snapshot &parent ) {
+	s = parent;
+	for( unsigned int p = 0; p < SNAP_PAGES; p++ )
+		s.page[p]->refs++;
+}
+
+//
+// snapshot_poke() - Mem[addr] <- value in s alone, copying the page it
+// is on first if another snapshot shares it.
+//
+
+void snapshot_poke( Snapshot &s, long addr, long value ) {
+	addr &= FAST_MEM_SIZE - 1;
+
+	SnapPage *&page = s.page[addr / SNAP_PAGE_SIZE];
+
+	if( page->refs > 1 ) {
+		SnapPage *copy = new SnapPage;
+
+		copy->refs = 1;
+		memcpy( copy->data, page->data, sizeof( page->data ) );
+		page->refs--;
+		page = copy;
+	}
+
+	page->data[addr % SNAP_PAGE_SIZE] = value & ( ( 1 << DATA_BITS ) - 1 );
+}
+
+//
+// snapshot_restore() - put cpu in the state s holds.  The trace writer
+// is left as it is.
+//
+
+void snapshot_restore( FastCpu &cpu, const Snapshot &s ) {
+	cpu.ir = s.ir;
+	cpu.ac = s.ac;
+	cpu.pc = s.pc;
+	cpu.done = s.done;
+	cpu.cycles = s.cycles;
+	cpu.instructions = s.instructions;
+
+	for( unsigned int p = 0; p < SNAP_PAGES; p++ )
+		memcpy( cpu.mem + p * SNAP_PAGE_SIZE, s.page[p]->data,
+			sizeof( s.page[p]->data ) );
+}
+
+//
+// snapshot_free() - drop s's references to its pages, freeing the ones
+// no other snapshot shares.
+//
+
+void snapshot_free( Snapshot &s ) {
+	for( unsigned int p = 0; p < SNAP_PAGES; p++ ) {
+		if( --s.page[p]->refs == 0 )
+			delete s.page[p];
+		s.page[p] = NULL;
+	}
+}
+
+//
+// snapshot_save() - write s to path.  Returns false if it cannot be
+// written.
+//
+
+bool snapshot_save( Snapshot &s, const char *path ) {
+	unsigned char header[SNAP_HEADER_SIZE];
+	unsigned char mem[2 * FAST_MEM_SIZE];
+	long *reg[SNAP_REGS];
+	FILE *fp = fopen( path, "wb" );
+
+	if( fp == NULL ) {
+		fprintf( stderr, "Cannot create snapshot file %s\n", path );
+		return false;
+	}
+
+	memset( header, 0, sizeof( header ) );
+	memcpy( header, SNAP_MAGIC, sizeof( SNAP_MAGIC ) );
+	header[4] = 2;
+	header[5] = ADDR_BITS;
+	header[6] = DATA_BITS;
+
+	snapshot_regs( s, reg );
+	for( unsigned int r = 0; r < SNAP_REGS; r++ )
+		for( int i = 0; i < 8; i++ )
+			header[8 + 8 * r + i] = (unsigned long)*reg[r] >> ( 8 * i );
+
+	for( unsigned int a = 0; a < FAST_MEM_SIZE; a++ ) {
+		unsigned int word = s.page[a / SNAP_PAGE_SIZE]->data[a % SNAP_PAGE_SIZE];
+
+		mem[2 * a] = word;
+		mem[2 * a + 1] = word >> 8;
+	}
+
+	fwrite( header, 1, sizeof( header ), fp );
+	fwrite( mem, 1, sizeof( mem ), fp );
+
+	if( fclose( fp ) != 0 ) {
+		fprintf( stderr, "Cannot write snapshot file %s\n", path );
+		return false;
+	}
+
+	return true;
+}
+
+//
+// snapshot_load() - read the snapshot in path into s, in pages of its
+// own.  Returns false if the file cannot be read or is not a snapshot
+// of this machine.
+//
+
+bool snapshot_load( Snapshot &s, const char *path ) {
+	unsigned char header[SNAP_HEADER_SIZE];
+	unsigned char mem[2 * FAST_MEM_SIZE];
+	long *reg[SNAP_REGS];
+	FILE *fp = fopen( path, "rb" );
+	bool ok;
+
+	if( fp == NULL ) {
+		fprintf( stderr, "Cannot open snapshot file %s\n", path );
+		return false;
+	}
+
+	ok = fread( header, 1, sizeof( header ), fp ) == sizeof( header ) &&
+		fread( mem, 1, sizeof( mem ), fp ) == sizeof( mem ) &&
+		fgetc( fp ) == EOF;
+	fclose( fp );
+
+	if( !ok || memcmp( header, SNAP_MAGIC, sizeof( SNAP_MAGIC ) ) != 0 ||
+	    header[4] != 2 || header[5] != ADDR_BITS || header[6] != DATA_BITS ) {
+		fprintf( stderr, "%s is not a simpISA snapshot\n", path );
+		return false;
+	}
+
+	snapshot_regs( s, reg );
+	for( unsigned int r = 0; r < SNAP_REGS; r++ ) {
+		unsigned long v = 0;
+
+		for( int i = 0; i < 8; i++ )
+			v |= (unsigned long)header[8 + 8 * r + i] << ( 8 * i );
+		*reg[r] = v;
+	}
+
+	for( unsigned int p = 0; p < SNAP_PAGES; p++ ) {
+		s.page[p] = new SnapPage;
+		s.page[p]->refs = 1;
+		for( unsigned int i = 0; i < SNAP_PAGE_SIZE; i++ ) {
+			unsigned int a = p * SNAP_PAGE_SIZE + i;
+
+			s.page[p]->data[i] = mem[2 * a] | ( mem[2 * a + 1] << 8 );
+		}
+	}
+
+	return true;
+}
+
+//
+// run_save() - run N instructions of objfile on the fast engine, with
+// the trace as usual, and save the machine to savefile.  Stops early if
+// the machine halts.  Returns false if either file fails.
+//
+
+bool run_save( char *objfile, char *savefile, long n ) {
+	FastCpu *cpu = new FastCpu;
+	Snapshot s;
+	bool ok;
+
+	if( flight_size > 0 )
+		trace_open_ring( cpu->trace, flight_size );
+	if( fold_trace )
+		trace_open_fold( cpu->trace );
+
+	fast_reset( *cpu );
+	if( !fast_load( *cpu, objfile ) ) {
+		delete cpu;
+		return false;
+	}
+
+	fast_interpret( *cpu, n );
+	trace_end( cpu->trace );
+
+	snapshot_take( s, *cpu );
+	ok = snapshot_save( s, savefile );
+	snapshot_free( s );
+
+	if( ok )
+		printf( "\nSnapshot: %ld instructions, simulated time %ld cycles, "
+			"saved to %s\n", cpu->instructions, cpu->cycles, savefile );
+
+	delete cpu;
+
+	return ok;
+}
+
+//
+// run_restore() - run the machine saved in snapfile on to the halt on
+// the fast engine, with the trace options of a normal run.  Returns false
+// if the snapshot cannot be loaded.
+//
+
+bool run_restore( char *snapfile ) {
+	FastCpu *cpu = new FastCpu;
+	Snapshot s;
+
+	if( !snapshot_load( s, snapfile ) ) {
+		delete cpu;
+		return false;
+	}
+
+	if( flight_size > 0 )
+		trace_open_ring( cpu->trace, flight_size );
+	if( fold_trace )
+		trace_open_fold( cpu->trace );
+
+	snapshot_restore( *cpu, s );
+	snapshot_free( s );
+
+	fast_resume( *cpu, snapfile );
+
+	delete cpu;
+
+	return true;
+}
+
+//
+// read_variants() - the lines of listfile, as a new[]'d array of
+// strdup()'d strings, with blank lines and lines starting with '#'
+// skipped.  Returns the number of lines.
+//
+
+static long read_variants( char *listfile, char **&line ) {
+	FILE *fp;
+	char text[1024];
+	long count = 0, size = 16;
+
+	fp = fopen( listfile, "r" );
+	if( fp == NULL ) {
+		fprintf( stderr, "Cannot open variants file %s\n", listfile );
+		exit( 1 );
+	}
+
+	line = new char *[size];
+
+	while( fgets( text, sizeof( text ), fp ) != NULL ) {
+		char *p = text;
+		char *end;
+
+		while( *p == ' ' || *p == '\t' )
+			p++;
+		end = p + strlen( p );
+		while( end > p && ( end[-1] == '\n' || end[-1] == '\r' ||
+		       end[-1] == ' ' || end[-1] == '\t' ) )
+			*--end = '\0';
+
+		if( *p == '\0' || *p == '#' )
+			continue;
+
+		if( count == size ) {
+			char **bigger = new char *[size * 2];
+
+			for( long i = 0; i < count; i++ )
+				bigger[i] = line[i];
+			delete [] line;
+			line = bigger;
+			size *= 2;
+		}
+
+		line[count++] = strdup( p );
+	}
+
+	fclose( fp );
+
+	return count;
+}
+
+//
+// variant_apply() - apply the changes on one line of a variants list to
+// s: hex "AAA=VVVV" sets Mem[AAA], "AC=VVVV" and "PC=VVV" set a
+// register.  Returns false, leaving s partly changed, if a change does
+// not parse.
+//
+
+static bool variant_apply( Snapshot &s, char *line ) {
+	char *p = line;
+
+	for( ;; ) {
+		char *end;
+		long addr = -1, value;
+		long *reg = NULL;
+
+		while( *p == ' ' || *p == '\t' )
+			p++;
+		if( *p == '\0' )
+			return true;
+
+		if( strncmp( p, "AC=", 3 ) == 0 )
+			reg = &s.ac;
+		else if( strncmp( p, "PC=", 3 ) == 0 )
+			reg = &s.pc;
+
+		if( reg != NULL )
+			p += 3;
+		else {
+			addr = strtol( p, &end, 16 );
+			if( end == p || *end != '=' )
+				return false;
+			p = end + 1;
+		}
+
+		value = strtol( p, &end, 16 );
+		if( end == p || ( *end != '\0' && *end != ' ' && *end != '\t' ) )
+			return false;
+		p = end;
+
+		if( reg == NULL )
+			snapshot_poke( s, addr, value );
+		else if( reg == &s.ac )
+			s.ac = value & ( ( 1 << DATA_BITS ) - 1 );
+		else
+			s.pc = value & ( FAST_MEM_SIZE - 1 );
+	}
+}
+
+//
+// variant_halt() - why the machine stopped.  The fast engine catches PC
+// overflow before it fetches, so IR is a HALT only if that stopped it.
+//
+
+static const char *variant_halt( const FastCpu &cpu ) {
+	if( !cpu.done )
+		return "instruction limit";
+	if( ( ( cpu.ir >> ( DATA_BITS - 3 ) ) & 7 ) == 4 )
+		return "halt instruction";
+	return "PC overflow";
+}
+
+//
+// run_variants() - fork the machine saved in snapfile once for each line
+// of listfile, apply that line's changes to the fork, and run each fork
+// on the fast engine, without a trace, for up to --limit instructions
+// past the snapshot.  Prints one result line per variant.  Returns the
+// number of variants that could not be parsed, or -1 if the snapshot
+// cannot be loaded.
+//
+
+int run_variants( char *snapfile, char *listfile ) {
+	FastCpu *cpu = new FastCpu;
+	Snapshot base;
+	Snapshot *fork;
+	char **line;
+	bool *ok;
+	long count, pages = 0, instructions = 0;
+	int failed = 0;
+	double start, elapsed;
+
+	if( !snapshot_load( base, snapfile ) ) {
+		delete cpu;
+		return -1;
+	}
+
+	count = read_variants( listfile, line );
+	fork = new Snapshot[count];
+	ok = new bool[count];
+
+	for( long v = 0; v < count; v++ ) {
+		snapshot_fork( fork[v], base );
+		ok[v] = variant_apply( fork[v], line[v] );
+		if( !ok[v] ) {
+			fprintf( stderr, "Bad variant: %s\n", line[v] );
+			failed++;
+		}
+	}
+
+	// pages the forks had to copy; the rest are still the base's
+	for( long v = 0; v < count; v++ )
+		for( unsigned int p = 0; p < SNAP_PAGES; p++ )
+			if( fork[v].page[p] != base.page[p] )
+				pages++;
+
+	trace_off( cpu->trace );
+	start = host_seconds();
+
+	for( long v = 0; v < count; v++ ) {
+		if( !ok[v] )
+			continue;
+
+		snapshot_restore( *cpu, fork[v] );
+
+		long first = cpu->instructions;
+
+		fast_interpret( *cpu, variant_limit > 0 ? first + variant_limit : -1 );
+		instructions += cpu->instructions - first;
+
+		printf( "%s: %ld instructions, simulated time %ld cycles, "
+			"AC=%04x PC=%03x, %s\n", line[v], cpu->instructions,
+			cpu->cycles, cpu->ac, cpu->pc, variant_halt( *cpu ) );
+	}
+
+	elapsed = host_seconds() - start;
+
+	if( show_stats ) {
+		fflush( stdout );
+		fprintf( stderr, "Variants: %ld forks of %u pages, %ld pages copied "
+			"on write\n", count, SNAP_PAGES, pages );
+		fprintf( stderr, "%ld instructions in %.3f s host time "
+			"(%.0f instructions/sec)\n", instructions, elapsed,
+			elapsed > 0 ? instructions / elapsed : 0.0 );
+	}
+
+	for( long v = 0; v < count; v++ ) {
+		snapshot_free( fork[v] );
+		free( line[v] );
+	}
+	snapshot_free( base );
+	delete [] fork;
+	delete [] ok;
+	delete [] line;
+	delete cpu;
+
+	return failed;
+}
@@ -0,0 +1,52 @@
+// snapshot.h
+//
+// Snapshots of a fast engine machine: IR, AC, PC, done, the cycle and
+// instruction counts, and memory.
+//
+// Memory is held in SNAP_PAGE_SIZE-word pages with a reference count.
+// A fork shares all of its parent's pages, and poking a word copies only
+// the page it falls in if that page is shared, so any number of variants
+// forked from one warm snapshot cost a page per word they change.  The
+// counts are not atomic: fork, poke and free a snapshot family on one
+// thread.
+//
+// Snapshot file layout, multi-byte fields little-endian:
+//
+//   0    SNAP_MAGIC
+//   4    bytes per word (2)
+//   5    address bits (ADDR_BITS)
+//   6    data bits (DATA_BITS)
+//   7    0
+//   8    the registers, 8 bytes each, in the order of Snapshot below
+//   56   the words of memory, from address 0, 2 bytes each
+//
+// The RTL model's arch registers and Memory can only be changed by clock
+// ticks, so snapshots are taken and restored on the fast engine only.
+
+#ifndef _SNAPSHOT_H
+#define _SNAPSHOT_H
+
+const unsigned int SNAP_PAGE_SIZE( 64 );	// words per copy-on-write page
+const unsigned int SNAP_PAGES( FAST_MEM_SIZE / SNAP_PAGE_SIZE );
+const unsigned int SNAP_REGS( 6 );			// register fields in the file
+const unsigned int SNAP_HEADER_SIZE( 8 + 8 * SNAP_REGS );
+
+extern const char SNAP_MAGIC[4];	// "SIS1"
+
+struct SnapPage {
+	long refs;				// snapshots sharing this page
+	unsigned short data[SNAP_PAGE_SIZE];
+};
+
+struct Snapshot {
+	long ir;
+	long ac;
+	long pc;
+	long done;
+	long cycles;
+	long instructions;
+
+	SnapPage *page[SNAP_PAGES];	// memory, shared with forks
+};
+
+#endif
@@ -0,0 +1,460 @@
+// trace_writer.C
+//
+// Buffered trace output for simpISA.  See trace_writer.h.
+
+#include "includes.h"
+
+#define HEX_ROW( h ) \
+	h "0" h "1" h "2" h "3" h "4" h "5" h "6" h "7" \
+	h "8" h "9" h "a" h "b" h "c" h "d" h "e" h "f"
+
+const char hex_pairs[2 * 256 + 1] =
+	HEX_ROW( "0" ) HEX_ROW( "1" ) HEX_ROW( "2" ) HEX_ROW( "3" )
+	HEX_ROW( "4" ) HEX_ROW( "5" ) HEX_ROW( "6" ) HEX_ROW( "7" )
+	HEX_ROW( "8" ) HEX_ROW( "9" ) HEX_ROW( "a" ) HEX_ROW( "b" )
+	HEX_ROW( "c" ) HEX_ROW( "d" ) HEX_ROW( "e" ) HEX_ROW( "f" );
+
+//
+// Loop folding.  An instruction waits in pend until it is known not to
+// be the start of a loop: when the last 2P instructions are the same P
+// twice over (by address and instruction), they become the body of a
+// loop, the second pass telling how the AC shown moves from one
+// iteration to the next.  Each instruction after that has to be exactly
+// the one the body predicts, and the loop is printed when one is not.
+//
+
+const long FOLD_MAX_BODY( 64 );		// longest loop folded
+const long FOLD_PEND( 2 * FOLD_MAX_BODY );
+const long FOLD_MIN_COUNT( 3 );		// shorter loops are printed in full
+
+// One instruction, with AC after it.
+struct FoldEntry {
+	TraceRecord rec;
+	long ac;
+};
+
+struct TraceFold {
+	FoldEntry pend[FOLD_PEND];	// not printed yet: pend[i % FOLD_PEND]
+	long pendStart;				// for pendStart <= i < pendEnd
+	long pendEnd;
+	long *lastSeen;				// index of the last one at each address
+	long period;				// distance back to the last one at this address
+	long run;					// how many in a row matched one period back
+	long ac;					// after the last instruction printed
+
+	bool folding;				// in a loop?
+	FoldEntry body[FOLD_MAX_BODY];	// its first iteration
+	long acStep[FOLD_MAX_BODY];
+	FoldEntry part[FOLD_MAX_BODY];	// the iteration under way
+	long length;				// instructions in body
+	long count;					// iterations done
+	long partLength;
+	long entryAC;				// AC before the loop
+	long exitAC;				// and after its last iteration
+};
+
+//
+// TraceWriter() - an empty buffer, writing to stdout.
+//
+
+TraceWriter::TraceWriter() :
+	out( stdout ),
+	ring( NULL ),
+	ringSize( 0 ),
+	ringNext( 0 ),
+	ringCount( 0 ),
+	fold( NULL ),
+	off( false ),
+	used( 0 ) {
+}
+
+//
+// ~TraceWriter() - write out whatever is left.
+//
+
+TraceWriter::~TraceWriter() {
+	trace_end( *this );
+	delete [] ring;
+	if( fold != NULL )
+		delete [] fold->lastSeen;
+	delete fold;
+}
+
+//
+// trace_flush() - write the buffered text to out in one chunk.
+//
+
+void trace_flush( TraceWriter &tw ) {
+	if( tw.used > 0 )
+		fwrite( tw.buf, 1, tw.used, tw.out );
+	tw.used = 0;
+}
+
+//
+// trace_open_ring() - record the last size instructions instead of
+// printing them.
+//
+
+void trace_open_ring( TraceWriter &tw, long size ) {
+	delete [] tw.ring;
+	tw.ring = new TraceRecord[size];
+	tw.ringSize = size;
+	tw.ringNext = 0;
+	tw.ringCount = 0;
+}
+
+//
+// trace_head() - the "pc:  ir = " start of a trace line.
+//
+
+static void trace_head( TraceWriter &tw, const TraceRecord &rec ) {
+	trace_hex( tw, rec.pc, 3 );
+	trace_str( tw, ":  " );
+	trace_hex( tw, rec.ir, 4 );
+	trace_str( tw, " = " );
+}
+
+//
+// trace_line() - the trace line of rec ("%5s %03x   AC=%04x" after the
+// head), without the newline.
+//
+
+static void trace_line( TraceWriter &tw, const TraceRecord &rec ) {
+	trace_head( tw, rec );
+	trace_str( tw, rec.mnemonic, 5 );
+	trace_char( tw, ' ' );
+	trace_hex( tw, rec.addr, 3 );
+	trace_str( tw, "   AC=" );
+	trace_hex( tw, rec.ac, 4 );
+}
+
+//
+// trace_ring_dump() - print the instructions in the ring, oldest first,
+// as the trace would have printed them.
+//
+
+static void trace_ring_dump( TraceWriter &tw ) {
+	long n = ( tw.ringCount < tw.ringSize ) ? tw.ringCount : tw.ringSize;
+	long i = ( tw.ringNext - n + tw.ringSize ) % tw.ringSize;
+
+	if( tw.ringCount > n ) {
+		char note[64];
+
+		sprintf( note, "[%ld earlier instructions not recorded]\n",
+			tw.ringCount - n );
+		trace_str( tw, note );
+	}
+
+	while( n-- > 0 ) {
+		trace_line( tw, tw.ring[i] );
+		trace_char( tw, '\n' );
+
+		if( ++i == tw.ringSize )
+			i = 0;
+	}
+}
+
+//
+// fold_same() - whether a and b are the same instruction by what a loop
+// must repeat.
+//
+
+static bool fold_same( const FoldEntry &a, const FoldEntry &b ) {
+	return a.rec.pc == b.rec.pc && a.rec.ir == b.rec.ir;
+}
+
+//
+// fold_step() - instruction k of the body as it is in iteration c,
+// counting from 0.
+//
+
+static FoldEntry fold_step( const TraceFold &f, long k, long c ) {
+	FoldEntry e = f.body[k];
+
+	e.rec.ac = ( e.rec.ac + c * f.acStep[k] ) & ( ( 1 << DATA_BITS ) - 1 );
+	return e;
+}
+
+//
+// fold_print() - print the trace line of e.
+//
+
+static void fold_print( TraceWriter &tw, const FoldEntry &e ) {
+	trace_line( tw, e.rec );
+	trace_char( tw, '\n' );
+	tw.fold->ac = e.ac;
+}
+
+//
+// fold_open() - the P instructions from index start, and the P after
+// them, are two passes of a loop.  Print what came before and start
+// folding.
+//
+
+static void fold_open( TraceWriter &tw, long start, long p ) {
+	TraceFold &f = *tw.fold;
+
+	while( f.pendStart < start )
+		fold_print( tw, f.pend[f.pendStart++ % FOLD_PEND] );
+
+	for( long k = 0; k < p; k++ ) {
+		const FoldEntry &a = f.pend[( start + k ) % FOLD_PEND];
+		const FoldEntry &b = f.pend[( start + p + k ) % FOLD_PEND];
+
+		f.body[k] = a;
+		f.acStep[k] = ( b.rec.ac - a.rec.ac ) & ( ( 1 << DATA_BITS ) - 1 );
+	}
+
+	f.entryAC = f.ac;
+	f.exitAC = f.pend[( start + 2 * p - 1 ) % FOLD_PEND].ac;
+	f.length = p;
+	f.count = 2;
+	f.partLength = 0;
+	f.folding = true;
+
+	f.pendStart = f.pendEnd;
+	f.period = f.run = 0;
+}
+
+//
+// fold_close() - the loop has ended; print its iterations, folded if
+// there were enough of them.  The unfinished iteration in part is left
+// to the caller.
+//
+
+static void fold_close( TraceWriter &tw ) {
+	TraceFold &f = *tw.fold;
+	bool steps = false;
+
+	f.folding = false;
+
+	if( f.count < FOLD_MIN_COUNT ) {
+		for( long c = 0; c < f.count; c++ )
+			for( long k = 0; k < f.length; k++ )
+				fold_print( tw, fold_step( f, k, c ) );
+		f.ac = f.exitAC;
+		return;
+	}
+
+	char note[96];
+
+	sprintf( note, "loop of %ld instructions, %ld iterations, "
+		"entry AC=%04lx {\n", f.length, f.count, f.entryAC );
+	trace_str( tw, note );
+
+	for( long k = 0; k < f.length; k++ )
+		fold_print( tw, f.body[k] );
+
+	trace_char( tw, '}' );
+	for( long k = 0; k < f.length; k++ ) {
+		if( f.acStep[k] == 0 )
+			continue;
+
+		sprintf( note, "%s line %ld AC +%04lx",
+			steps ? "," : " per iteration:", k + 1, f.acStep[k] );
+		trace_str( tw, note );
+		steps = true;
+	}
+
+	sprintf( note, "%s exit AC=%04lx\n", steps ? ";" : "", f.exitAC );
+	trace_str( tw, note );
+
+	f.ac = f.exitAC;
+}
+
+//
+// fold_push() - take the next instruction.
+//
+
+static void fold_push( TraceWriter &tw, const FoldEntry &e ) {
+	TraceFold &f = *tw.fold;
+
+	if( f.folding ) {
+		FoldEntry want = fold_step( f, f.partLength, f.count );
+
+		if( fold_same( e, want ) && e.rec.ac == want.rec.ac ) {
+			f.part[f.partLength++] = e;
+			if( f.partLength == f.length ) {
+				f.count++;
+				f.exitAC = e.ac;
+				f.partLength = 0;
+			}
+			return;
+		}
+
+		// out of the loop; what ran of its last iteration may be
+		// the start of another
+		FoldEntry rest[FOLD_MAX_BODY];
+		long n = f.partLength;
+
+		for( long k = 0; k < n; k++ )
+			rest[k] = f.part[k];
+		fold_close( tw );
+		for( long k = 0; k < n; k++ )
+			fold_push( tw, rest[k] );
+		fold_push( tw, e );
+		return;
+	}
+
+	if( f.pendEnd - f.pendStart == FOLD_PEND )
+		fold_print( tw, f.pend[f.pendStart++ % FOLD_PEND] );
+
+	long i = f.pendEnd++;
+	long prev = f.lastSeen[e.rec.pc];
+
+	f.pend[i % FOLD_PEND] = e;
+	f.lastSeen[e.rec.pc] = i;
+
+	if( prev < 0 || i - prev > FOLD_MAX_BODY ) {
+		f.period = f.run = 0;
+		return;
+	}
+
+	long p = i - prev;
+	bool match = i - p >= f.pendStart &&
+		fold_same( f.pend[( i - p ) % FOLD_PEND], e );
+
+	if( p != f.period ) {
+		f.period = p;
+		f.run = 0;
+	}
+	f.run = match ? f.run + 1 : 0;
+
+	if( f.run >= p && i - 2 * p + 1 >= f.pendStart )
+		fold_open( tw, i - 2 * p + 1, p );
+}
+
+//
+// fold_drain() - print everything still waiting.
+//
+
+static void fold_drain( TraceWriter &tw ) {
+	TraceFold &f = *tw.fold;
+
+	if( f.folding ) {
+		fold_close( tw );
+		for( long k = 0; k < f.partLength; k++ )
+			fold_print( tw, f.part[k] );
+	}
+	while( f.pendStart < f.pendEnd )
+		fold_print( tw, f.pend[f.pendStart++ % FOLD_PEND] );
+
+	f.period = f.run = 0;
+}
+
+//
+// trace_open_fold() - print the trace with its loops folded.
+//
+
+void trace_open_fold( TraceWriter &tw ) {
+	long words = 1L << ADDR_BITS;
+
+	if( tw.fold != NULL )
+		delete [] tw.fold->lastSeen;
+	delete tw.fold;
+	tw.fold = new TraceFold;
+
+	TraceFold &f = *tw.fold;
+
+	f.pendStart = f.pendEnd = 0;
+	f.lastSeen = new long[words];
+	for( long pc = 0; pc < words; pc++ )
+		f.lastSeen[pc] = -1;
+	f.period = f.run = 0;
+	f.ac = 0;
+	f.folding = false;
+}
+
+//
+// trace_off() - print nothing, not even the halt messages.
+//
+
+void trace_off( TraceWriter &tw ) {
+	tw.off = true;
+}
+
+//
+// trace_end() - the run is over; print whatever loop folding is holding
+// back and write out the buffer.
+//
+
+void trace_end( TraceWriter &tw ) {
+	if( tw.fold != NULL )
+		fold_drain( tw );
+	trace_flush( tw );
+}
+
+//
+// trace_start() - the fast engine has loaded a program that starts at
+// entry; print the line Memory::load() prints for the RTL model.
+//
+
+void trace_start( TraceWriter &tw, long entry ) {
+	if( tw.off )
+		return;
+
+	trace_str( tw, "Memory sets starting address to " );
+	trace_hex( tw, entry, 1 );
+	trace_char( tw, '\n' );
+}
+
+//
+// trace_retire() - the instruction in tw.rec is finished, leaving ac in
+// AC; print its line, put it in the ring or hand it to loop folding.
+//
+
+void trace_retire( TraceWriter &tw, long ac ) {
+	if( tw.off )
+		return;
+
+	if( tw.ring != NULL ) {
+		tw.ring[tw.ringNext] = tw.rec;
+		if( ++tw.ringNext == tw.ringSize )
+			tw.ringNext = 0;
+		tw.ringCount++;
+		return;
+	}
+
+	if( tw.fold != NULL ) {
+		FoldEntry e;
+
+		e.rec = tw.rec;
+		e.ac = ac;
+		fold_push( tw, e );
+		return;
+	}
+
+	trace_line( tw, tw.rec );
+	trace_char( tw, '\n' );
+}
+
+//
+// trace_halt() - the instruction in tw.rec is a HALT; print its line and
+// the halt message.  A flight recorder has nothing to print.
+//
+
+void trace_halt( TraceWriter &tw ) {
+	if( tw.off || tw.ring != NULL )
+		return;
+	if( tw.fold != NULL )
+		fold_drain( tw );
+
+	trace_line( tw, tw.rec );
+	trace_str( tw, "\n\nMACHINE HALTED due to halt instruction\n\n" );
+}
+
+//
+// trace_overflow() - the machine halted because PC ran off the end of
+// memory.
+//
+
+void trace_overflow( TraceWriter &tw ) {
+	if( tw.off )
+		return;
+	if( tw.ring != NULL )
+		trace_ring_dump( tw );
+	if( tw.fold != NULL )
+		fold_drain( tw );
+	trace_str( tw, "\nMACHINE HALTED due to PC overflow\n\n" );
+}
+
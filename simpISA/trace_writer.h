@@ -0,0 +1,131 @@
+// trace_writer.h
+//
+// Buffered trace output for simpISA.
+//
+// The trace is built up in a large buffer with the inline routines
+// below, which format hex fields with table lookups instead of printf,
+// and is written out only when the buffer fills, at halt, or when the
+// writer is destroyed (so an ArchLibError that unwinds the machine still
+// gets the trace out before main() prints the cause).  The text is the
+// same as the printf calls it replaces produced.
+//
+// The run loop fills in the writer's TraceRecord as an instruction is
+// fetched and executed, and trace_retire() prints its line.  With
+// --flight=N the writer is a flight recorder instead: it keeps the raw
+// records of the last N instructions in a ring and formats nothing until
+// the machine halts on an error (PC overflow), when it prints the ring
+// as the trace would have shown it.
+// A run that ends at HALT prints no trace at all.
+//
+// With --fold the writer folds loops.  When the same run of instructions
+// (the same addresses and instructions) comes round three times or more,
+// it prints the first pass once, between a line giving the length of the
+// loop, how many times it went round and AC on entry, and a line giving
+// AC on exit and how much each AC shown grows per iteration (mod 2^15).
+// Every line of the full trace can be rebuilt from that.
+
+#ifndef _TRACE_WRITER_H
+#define _TRACE_WRITER_H
+
+const unsigned int TRACE_BUFFER_SIZE( 1 << 16 );
+
+// What the trace line of an instruction shows.
+struct TraceRecord {
+	long pc;				// where it was fetched from
+	long ir;				// the instruction
+	long addr;				// its address field
+	long ac;				// AC when it was traced
+	const char *mnemonic;
+};
+
+struct TraceFold;				// loop folding state; see trace_writer.C
+
+struct TraceWriter {
+	TraceWriter();
+	~TraceWriter();
+
+	FILE *out;					// where the trace goes
+	TraceRecord rec;			// the instruction being executed
+	TraceRecord *ring;			// flight recorder, ringSize entries, or NULL
+	long ringSize;
+	long ringNext;				// where the next entry goes
+	long ringCount;				// instructions recorded so far
+	TraceFold *fold;			// --fold state, or NULL
+	bool off;					// print nothing at all?
+	unsigned int used;			// bytes waiting in buf
+	char buf[TRACE_BUFFER_SIZE];
+};
+
+extern const char hex_pairs[2 * 256 + 1];	// "000102...feff"
+
+void trace_flush( TraceWriter & );
+void trace_open_ring( TraceWriter &, long );
+void trace_open_fold( TraceWriter & );
+void trace_off( TraceWriter & );
+void trace_end( TraceWriter & );
+void trace_start( TraceWriter &, long );
+void trace_retire( TraceWriter &, long );
+void trace_halt( TraceWriter & );
+void trace_overflow( TraceWriter & );
+
+//
+// trace_room() - make sure n more bytes fit in the buffer.
+//
+
+inline void trace_room( TraceWriter &tw, unsigned int n ) {
+	if( tw.used + n > TRACE_BUFFER_SIZE )
+		trace_flush( tw );
+}
+
+//
+// trace_char() - append c.
+//
+
+inline void trace_char( TraceWriter &tw, char c ) {
+	trace_room( tw, 1 );
+	tw.buf[tw.used++] = c;
+}
+
+//
+// trace_str() - append s, right-justified in width columns ("%*s").
+//
+
+inline void trace_str( TraceWriter &tw, const char *s, unsigned int width = 0 ) {
+	unsigned int n = strlen( s );
+
+	trace_room( tw, ( n < width ? width : n ) );
+	while( n < width ) {
+		tw.buf[tw.used++] = ' ';
+		width--;
+	}
+	memcpy( tw.buf + tw.used, s, n );
+	tw.used += n;
+}
+
+//
+// trace_hex() - append v in hex, at least digits long ("%0*lx").
+//
+
+inline void trace_hex( TraceWriter &tw, unsigned long v, unsigned int digits ) {
+	char tmp[2 * sizeof( v )];
+	unsigned int n = 0;
+
+	// two digits per byte from the pair table, least significant first
+	do {
+		tmp[n++] = hex_pairs[2 * ( v & 0xff ) + 1];
+		tmp[n++] = hex_pairs[2 * ( v & 0xff )];
+		v >>= 8;
+	} while( v != 0 );
+
+	// the top byte may have only one significant digit
+	if( n > 1 && tmp[n - 1] == '0' )
+		n--;
+	while( n < digits )
+		tmp[n++] = '0';
+
+	trace_room( tw, n );
+	while( n > 0 )
+		tw.buf[tw.used++] = tmp[--n];
+}
+
+#endif